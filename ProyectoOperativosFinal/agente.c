@@ -26,6 +26,7 @@
 #include <sys/stat.h> //Libreria para archivos y permisos
 #include <sys/types.h> //Libreria para syscalls
 #include <errno.h> //Libreria para manejo de errores
+#include <signal.h> // Libreria para manejo de senales
 
 #include "agente_funciones.h"   
 
@@ -34,22 +35,25 @@
 
 int main(int argc, char* argv[]) {
     char nombre_agente[MAX_NOMBRE] = ""; //Nombre del agente
-    char archivo_solicitudes[MAX_NOMBRE] = ""; //Nombre del archivo con las solicitudes
+    char archivo_solicitudes[MAX_RUTA] = ""; //Ruta del archivo con las solicitudes
     char pipe_entrada[MAX_NOMBRE] = ""; //Nombre del pipe de entrada
     char pipe_propio[MAX_NOMBRE] = ""; //Nombre del pipe del agente
 
     // Recibe los argumentos, guarda el nombre del agente, el nombre del archivo de las solicitudes y el nombre del pipe
     parsear_argumentos(argc, argv, nombre_agente, archivo_solicitudes, pipe_entrada);
+    //Si el controlador ya cerro su pipe, write retorna EPIPE en vez de matar al agente
+    signal(SIGPIPE, SIG_IGN);
     // Crea un pipe para que el controlador envia los datos
     crear_pipe_propio(pipe_propio, nombre_agente);
+    //Abre su pipe antes de registrarse, asi el controlador lo puede abrir sin bloquear
+    int fd_propio = abrir_pipe_propio(pipe_propio);
     // Le indica al controlador un mensaje con el nombre del agente y el pipe a utilizar
     int fd_entrada = registrar_agente_controlador(nombre_agente, pipe_propio, pipe_entrada);
-    //Abre el pipe ya sea para lectura o escritura
-    int fd_propio = abrir_pipe_propio(pipe_propio);
     //recibe la hora inicial y verifica que el mensaje sea para ese agente
-    int hora_actual = recibir_hora_inicial(fd_propio, nombre_agente);
+    uint32_t id_agente = 0; //Id que le asigna el controlador
+    int hora_actual = recibir_hora_inicial(fd_propio, nombre_agente, &id_agente);
     //Recibe todos los datos de la solictud y espera las respuestas que les va a devolver
-    procesar_solicitudes(fd_entrada, fd_propio, archivo_solicitudes, nombre_agente, hora_actual);
+    procesar_solicitudes(fd_entrada, fd_propio, archivo_solicitudes, id_agente, hora_actual);
     // Cierre los pipes que esten abiertos y los elimina de ser necesario
     cerrar_y_limpiar(fd_entrada, fd_propio, pipe_propio, nombre_agente);
 
@@ -22,13 +22,139 @@
 ******************************************************/
 
 #include "agente_funciones.h" //Donde se encuentran los prototipos
+
+static LectorTramas lector_propio; //Acumula los bytes que llegan por el pipe propio
+static int fd_escritura_propia = -1; //Extremo de escritura que el agente deja abierto sobre su pipe
+static AnilloShm* anillo_controlador = NULL; //Con -x shm, anillo de solicitudes del controlador
+static AnilloShm* anillo_propio = NULL; //Con -x shm, anillo donde el controlador deja las respuestas
+static uint8_t trama_recibida[MAX_TRAMA]; //Con -x shm, copia de la ultima trama: su ranura ya se devolvio al anillo
+static int fd_conexion = -1; //Con -x unix, la unica conexion con el controlador (solicitudes y respuestas)
+
+int transporte = TRANSPORTE_FIFO; //Mecanismo elegido con -x
+
+int ventana_envio = 1; //Solicitudes que pueden estar sin respuesta al mismo tiempo
+long pausa_ms = 2000; //Pausa entre envios en milisegundos, 0 si no hay pausa
+int tam_lote = 1; //Solicitudes que se agrupan en cada trama, 1 para no usar lotes
+
+//Una solicitud enviada que todavia espera respuesta
+typedef struct {
+    int ocupada; //1 si la ranura tiene una solicitud en vuelo
+    uint32_t id; //Id con el que se envio
+    int tipo; //MSG_SOLICITUD, MSG_CANCELAR, MSG_MODIFICAR o MSG_DISPONIBILIDAD; las consultas no se encolan y nunca vuelven OCUPADO
+    MsgSolicitud sol; //Copia de lo que se envio
+    int intentos; //Respuestas OCUPADO que ya recibio
+    uint64_t reintentar_ns; //Momento (CLOCK_MONOTONIC) en que se reenvia tras un OCUPADO, 0 si no espera reenvio
+} SolicitudEnVuelo;
+
+static SolicitudEnVuelo en_vuelo[MAX_VENTANA]; //Ranuras de la ventana
+static int ranuras_libres[MAX_VENTANA]; //Pila de ranuras disponibles
+static int num_libres = 0; //Ranuras en la pila
+static int pendientes = 0; //Solicitudes enviadas sin respuesta
+static int terminado = 0; //1 cuando el controlador termino o cerro el pipe
+static pthread_mutex_t cerrojo_envio = PTHREAD_MUTEX_INITIALIZER; //Protege el estado de la ventana
+static pthread_cond_t cambio_envio; //Avisa que se libero una ranura o que la simulacion acabo
+static int por_reintentar = 0; //Ranuras que esperan reenviarse tras un OCUPADO
+static uint64_t pausa_ocupado_ns = 0; //Tras un OCUPADO no sale nada nuevo antes de este momento
+static long respuestas_ocupado = 0; //OCUPADO recibidos, se muestran al final
+static unsigned int semilla_espera; //Azar de las esperas entre reintentos, protegida por cerrojo_envio
+
+//Ultima reserva confirmada de una familia, para poder cancelarla o modificarla desde el archivo
+typedef struct {
+    char familia[MAX_NOMBRE]; //"" si el espacio esta vacio
+    uint32_t reserva; //Id que dio el controlador, SIN_ID_RESERVA si ya se cancelo
+} ReservaFamilia;
+
+static ReservaFamilia* familias = NULL; //Tabla hash de direccionamiento abierto, protegida por cerrojo_envio
+static uint32_t capacidad_familias = 0; //Espacios de la tabla (potencia de 2)
+static uint32_t num_familias = 0; //Familias guardadas
+
+//Hash FNV-1a del nombre, igual al de la tabla de agentes del controlador
+static uint32_t hash_familia(const char* familia) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)familia; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+//Espacio de la familia en la tabla; con crear la agrega si no esta (duplica la tabla a la mitad de llena)
+//Retorna NULL si no esta y no se pidio crear, o si no hay memoria. Se llama con cerrojo_envio tomado
+static ReservaFamilia* reserva_de_familia(const char* familia, int crear) {
+    if (crear && (num_familias + 1) * 2 > capacidad_familias) {
+        uint32_t capacidad = capacidad_familias ? capacidad_familias * 2 : 256;
+        ReservaFamilia* nuevas = calloc(capacidad, sizeof(ReservaFamilia));
+        if (!nuevas) return NULL;
+        for (uint32_t k = 0; k < capacidad_familias; k++) { //Vuelve a ubicar las que ya estaban
+            if (familias[k].familia[0] == '\0') continue;
+            uint32_t i = hash_familia(familias[k].familia) & (capacidad - 1);
+            while (nuevas[i].familia[0] != '\0') i = (i + 1) & (capacidad - 1);
+            nuevas[i] = familias[k];
+        }
+        free(familias);
+        familias = nuevas;
+        capacidad_familias = capacidad;
+    }
+    if (capacidad_familias == 0) return NULL;
+    for (uint32_t i = hash_familia(familia) & (capacidad_familias - 1);; i = (i + 1) & (capacidad_familias - 1)) {
+        if (strcmp(familias[i].familia, familia) == 0) return &familias[i];
+        if (familias[i].familia[0] != '\0') continue;
+        if (!crear) return NULL; //Espacio vacio: la familia no esta
+        strcpy(familias[i].familia, familia);
+        num_familias++;
+        return &familias[i];
+    }
+}
+
+//Espera la siguiente trama del controlador, retorna 1 si llego o 0 si el pipe se cerro
+static int esperar_trama(int fd_propio, CabeceraTrama* cab, const uint8_t** cuerpo) {
+    if (transporte == TRANSPORTE_SHM) {
+        for (;;) {
+            const uint8_t* trama;
+            int len = anillo_esperar(anillo_propio, &trama);
+            if (len == 0) return 0; //El anillo se cerro
+            //Se copia y la ranura se devuelve antes de liberar la de la ventana: si no, con la ventana del mismo
+            //tamano que el anillo el controlador tendria una respuesta mas en vuelo que ranuras donde dejarla
+            memcpy(trama_recibida, trama, (size_t)len);
+            anillo_avanzar(anillo_propio);
+            if (trama_abrir(trama_recibida, (size_t)len, cab, cuerpo) == 1) return 1;
+            fprintf(stderr, "Error: trama invalida del controlador.\n");
+        }
+    }
+    for (;;) {
+        int r = lector_siguiente(&lector_propio, cab, cuerpo);
+        if (r == 1) return 1; //Ya habia una trama completa en el buffer
+        if (r == -1) fprintf(stderr, "Error: trama invalida del controlador.\n");
+        //Con -x unix cada read entrega un registro completo de la conexion
+        if (lector_llenar(&lector_propio, transporte == TRANSPORTE_UNIX ? fd_conexion : fd_propio) <= 0)
+            return 0; //El controlador cerro el pipe
+    }
+}
+//Envia una trama al controlador; con -x shm espera si el anillo esta lleno, igual que un write bloqueante
+static int enviar_trama(int fd_entrada, const uint8_t* trama, int len) {
+    if (transporte != TRANSPORTE_SHM) return escribir_trama(fd_entrada, trama, len); //Pipe o conexion unix
+    while (anillo_meter(anillo_controlador, trama, len) == -1) {
+        if (errno != EAGAIN) return -1; //EPIPE: el controlador cerro el anillo
+        struct timespec espera = { 0, 50000 }; //Deja que el controlador libere ranuras
+        nanosleep(&espera, NULL);
+    }
+    return 0;
+}
 // Recibe los argumentos, guarda el nombre del agente, el nombre del archivo de las solicitudes y el nombre del pipe
 void parsear_argumentos(int argc, char* argv[], char* nombre, char* archivo, char* pipe) {
     int i = 1; //Variable para moverse entre los argumentos
     while (i < argc) {
-        if (strcmp(argv[i], "-s") == 0) { i++; strcpy(nombre, argv[i]); } //Guarda el nombre del agente que recibio como parametro
-        else if (strcmp(argv[i], "-a") == 0) { i++; strcpy(archivo, argv[i]); } //Guarda el nombre del archivo con las solicitudes que recibio como parametro
-        else if (strcmp(argv[i], "-p") == 0) { i++; strcpy(pipe, argv[i]); } //Guarda el nombre del pipe del controlador que recibio como parametro
+        //El nombre deja lugar para el prefijo "Pipe" de su pipe propio
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) { i++; snprintf(nombre, MAX_NOMBRE - 4, "%s", argv[i]); } //Guarda el nombre del agente que recibio como parametro
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) { i++; snprintf(archivo, MAX_RUTA, "%s", argv[i]); } //Guarda el nombre del archivo con las solicitudes que recibio como parametro
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) { i++; snprintf(pipe, MAX_NOMBRE, "%s", argv[i]); } //Guarda el nombre del pipe del controlador que recibio como parametro
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) { i++; ventana_envio = atoi(argv[i]); } //Solicitudes en vuelo a la vez
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) { i++; tam_lote = atoi(argv[i]); } //Solicitudes por lote
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) { //Pausa entre envios en milisegundos o "none"
+            i++;
+            pausa_ms = strcmp(argv[i], "none") == 0 ? 0 : atol(argv[i]);
+        }
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) { i++; transporte = transporte_desde_texto(argv[i]); } //fifo, shm o unix
         i++;
     }
     //Revisa si tiene los 3 parametros (nombre agente, nombre archivo de solicitudes y el nombre del pipe)
@@ -36,10 +162,35 @@ void parsear_argumentos(int argc, char* argv[], char* nombre, char* archivo, cha
         fprintf(stderr, "Error: faltan parámetros.\n");
         exit(1);
     }
+    if (transporte == -1) {
+        fprintf(stderr, "Error: el transporte debe ser fifo, shm o unix.\n");
+        exit(1);
+    }
+    //La ventana no puede tener mas respuestas pendientes que las que guarda el canal de respuestas del transporte
+    int ventana_maxima = transporte == TRANSPORTE_SHM ? MAX_VENTANA_SHM
+                       : transporte == TRANSPORTE_UNIX ? MAX_VENTANA_UNIX : MAX_VENTANA_FIFO;
+    if (ventana_envio < 1 || ventana_envio > ventana_maxima || pausa_ms < 0) { //Revisa las opciones de envio
+        fprintf(stderr, "Error: la ventana debe estar entre 1 y %d con -x %s y la pausa no puede ser negativa.\n",
+                ventana_maxima, transporte == TRANSPORTE_SHM ? "shm" : transporte == TRANSPORTE_UNIX ? "unix" : "fifo");
+        exit(1);
+    }
+    if (tam_lote < 1 || tam_lote > MAX_LOTE) {
+        fprintf(stderr, "Error: el lote debe estar entre 1 y %d.\n", MAX_LOTE);
+        exit(1);
+    }
 }
 // Crea un pipe para que el controlador envia los datos
 void crear_pipe_propio(char* pipe_propio, char* nombre_agente) {
-    sprintf(pipe_propio, "Pipe%s", nombre_agente); //Le da un nombre al pipe
+    snprintf(pipe_propio, MAX_NOMBRE, "Pipe%s", nombre_agente); //Le da un nombre al pipe
+    if (transporte == TRANSPORTE_UNIX) return; //Las respuestas llegan por la misma conexion, no hay pipe propio
+    if (transporte == TRANSPORTE_SHM) { //Con memoria compartida el mismo nombre es el de su anillo de respuestas
+        anillo_propio = anillo_crear(pipe_propio, RANURAS_RESPUESTA);
+        if (!anillo_propio) {
+            perror("anillo_crear pipe_propio");
+            exit(1);
+        }
+        return;
+    }
     if (mkfifo(pipe_propio, 0666) == -1 && errno != EEXIST) { //Crea el FIFO solo si aun no existe
         perror("mkfifo pipe_propio"); //Muestra un mensaje de error si no logra crearlo
         exit(1);
@@ -47,74 +198,471 @@ void crear_pipe_propio(char* pipe_propio, char* nombre_agente) {
 }
 // Le indica al controlador un mensaje con el nombre del agente y el pipe a utilizar
 int registrar_agente_controlador(char* nombre_agente, char* pipe_propio, char* pipe_entrada) {
-    int fd_entrada = open(pipe_entrada, O_WRONLY); //abre el pipe para escritura
-    if (fd_entrada == -1) {
-        perror("open pipe_entrada"); //Si no logra abrirlo muestra el mensaje de error
+    int fd_entrada = -1;
+    if (transporte == TRANSPORTE_UNIX) { //Se conecta una sola vez; el controlador lo identifica por la conexion
+        fd_conexion = unix_conectar(pipe_entrada);
+        if (fd_conexion == -1) {
+            perror("unix_conectar pipe_entrada");
+            exit(1);
+        }
+        fd_entrada = fd_conexion; //El pipe_respuesta del registro se ignora en este modo
+    } else if (transporte == TRANSPORTE_SHM) { //Mapea el anillo de solicitudes que creo el controlador
+        anillo_controlador = anillo_abrir(pipe_entrada);
+        if (!anillo_controlador) {
+            perror("anillo_abrir pipe_entrada");
+            exit(1);
+        }
+    } else {
+        fd_entrada = open(pipe_entrada, O_WRONLY); //abre el pipe para escritura
+        if (fd_entrada == -1) {
+            perror("open pipe_entrada"); //Si no logra abrirlo muestra el mensaje de error
+            exit(1);
+        }
+    }
+    MsgRegistro reg; //Datos del mensaje de registro
+    strncpy(reg.nombre, nombre_agente, MAX_NOMBRE - 1);
+    reg.nombre[MAX_NOMBRE - 1] = '\0';
+    strncpy(reg.pipe_respuesta, pipe_propio, MAX_NOMBRE - 1);
+    reg.pipe_respuesta[MAX_NOMBRE - 1] = '\0';
+    uint8_t trama[MAX_TRAMA];
+    int len = codificar_registro(trama, 0, &reg); //Crea la trama
+    if (len < 0 || enviar_trama(fd_entrada, trama, len) == -1) { //La escribe para el controlador
+        perror("write registro");
         exit(1);
     }
-    char msg_registro[256]; //Espacio para el mensaje de registro
-    sprintf(msg_registro, "REGISTRO|%s|%s", nombre_agente, pipe_propio); //Crea el mensaje
-    write(fd_entrada, msg_registro, strlen(msg_registro)); //Lo escribe para el controlador
     return fd_entrada; //Retorna el descriptor (la primera parte del mensaje), para ubicarlo
 }
 //Abre el pipe ya sea para lectura o escritura
 int abrir_pipe_propio(char* pipe_propio) {
-    int fd_propio = open(pipe_propio, O_RDONLY); //abre el pipe del agente
+    //El anillo ya quedo mapeado al crearlo, y con la conexion unix no hay pipe propio
+    if (transporte != TRANSPORTE_FIFO) return -1;
+    int fd_propio = open(pipe_propio, O_RDONLY | O_NONBLOCK); //abre el pipe del agente sin esperar al controlador
     if (fd_propio == -1) {
         perror("open pipe_propio"); //Muestra un mensaje de error si no logra abrirlo
         exit(1);
     }
+    //Mantiene su propio extremo de escritura para que read no vea fin de archivo
+    //mientras el controlador todavia no ha abierto el pipe
+    fd_escritura_propia = open(pipe_propio, O_WRONLY);
+    if (fd_escritura_propia == -1) {
+        perror("open pipe_propio escritura");
+        exit(1);
+    }
+    fcntl(fd_propio, F_SETFL, fcntl(fd_propio, F_GETFL) & ~O_NONBLOCK); //Las lecturas vuelven a ser bloqueantes
+    lector_iniciar(&lector_propio); //Empieza sin bytes pendientes
     return fd_propio; //retorna el descriptor
 }
 //recibe la hora inicial y verifica que el mensaje sea para ese agente
-int recibir_hora_inicial(int fd_propio, char* nombre_agente) {
-    char buffer[MAX_BUFFER]; //Tamano maximo del buffer que se usa para leer el mensaje
-    int n = read(fd_propio, buffer, sizeof(buffer) - 1); //Le indica que el pipe esta en lectura
-    int hora_actual = 0; //Inicializa la variable en donde se guarda la hora
-    if (n > 0) {
-        buffer[n] = '\0';
-        sscanf(buffer, "HORA|%d", &hora_actual); //Obtiene la hora
-        printf("Agente %s registrado. Hora actual: %d\n", nombre_agente, hora_actual);
+//El mismo mensaje trae el id con el que el agente debe marcar sus solicitudes
+int recibir_hora_inicial(int fd_propio, char* nombre_agente, uint32_t* id_agente) {
+    CabeceraTrama cab;
+    const uint8_t* cuerpo;
+    int hora_actual = 0; //Inicializa la variable en donde se guarda el instante, en minutos desde el dia 0
+    if (esperar_trama(fd_propio, &cab, &cuerpo) && cab.tipo == MSG_HORA &&
+        decodificar_hora(cuerpo, cab.longitud, &hora_actual, id_agente) == 0) { //Obtiene la hora y el id
+        char texto[TAM_INSTANTE];
+        texto_instante(hora_actual, texto, sizeof(texto));
+        printf("Agente %s registrado con id %u. Hora actual: %s\n", nombre_agente, *id_agente, texto);
     } else {
         fprintf(stderr, "Error: no se recibió hora inicial del controlador.\n"); //Muestra un mensaje de error si no pudo obtenerla
     }
     return hora_actual;
 }
+
+//Instante actual del reloj monotonico en nanosegundos, el mismo de las esperas de cambio_envio
+static uint64_t reloj_ns(void) {
+    struct timespec ahora;
+    clock_gettime(CLOCK_MONOTONIC, &ahora);
+    return (uint64_t)ahora.tv_sec * 1000000000ULL + (uint64_t)ahora.tv_nsec;
+}
+
+//Espera antes de reenviar tras un OCUPADO: la sugerida por el controlador, doblada en cada intento hasta
+//MAX_ESPERA_OCUPADO_MS, y de ella se toma al azar entre la mitad y el total para que los agentes rechazados
+//a la vez no vuelvan todos juntos. Se llama con cerrojo_envio tomado
+static uint64_t espera_ocupado_ns(int sugerida_ms, int intentos) {
+    uint64_t ms = sugerida_ms > 0 ? (uint64_t)sugerida_ms : 1;
+    for (int i = 1; i < intentos && ms < MAX_ESPERA_OCUPADO_MS; i++) ms *= 2;
+    if (ms > MAX_ESPERA_OCUPADO_MS) ms = MAX_ESPERA_OCUPADO_MS;
+    uint64_t ns = ms * 1000000ULL;
+    return ns / 2 + (uint64_t)rand_r(&semilla_espera) % (ns / 2 + 1);
+}
+
+//Empareja una respuesta con su solicitud por el id, libera su ranura y la muestra
+//Una reserva confirmada queda anotada con su familia; una cancelada se borra
+static void entregar_respuesta(uint32_t id, const MsgRespuesta* resp) {
+    uint32_t ranura = id & (MAX_VENTANA - 1); //Los bits bajos del id son la ranura
+    char familia[MAX_NOMBRE];
+    pthread_mutex_lock(&cerrojo_envio);
+    if (!en_vuelo[ranura].ocupada || en_vuelo[ranura].id != id || en_vuelo[ranura].reintentar_ns != 0) { //Desconocida o repetida
+        pthread_mutex_unlock(&cerrojo_envio);
+        return;
+    }
+    if (resp->codigo == RESP_OCUPADO) { //No se decidio: la ranura sigue ocupada y el hilo principal la reenvia despues
+        SolicitudEnVuelo* v = &en_vuelo[ranura];
+        v->intentos++;
+        uint64_t ahora = reloj_ns();
+        v->reintentar_ns = ahora + espera_ocupado_ns(resp->inicio, v->intentos);
+        //Lo nuevo solo espera lo sugerido: cuanto mas falla una solicitud mas tarda ella, no todo el agente
+        uint64_t pausa = ahora + espera_ocupado_ns(resp->inicio, 1);
+        if (pausa > pausa_ocupado_ns) pausa_ocupado_ns = pausa;
+        por_reintentar++;
+        respuestas_ocupado++;
+        pthread_cond_broadcast(&cambio_envio);
+        pthread_mutex_unlock(&cerrojo_envio);
+        return;
+    }
+    strcpy(familia, resp->familia[0] != '\0' ? resp->familia : en_vuelo[ranura].sol.familia); //Un cambio negado viene sin familia
+    if (resp->codigo == RESP_OK || resp->codigo == RESP_REPROGRAMADA || resp->codigo == RESP_CANCELADA) {
+        ReservaFamilia* anotada = reserva_de_familia(familia, resp->codigo != RESP_CANCELADA);
+        if (anotada) anotada->reserva = resp->codigo == RESP_CANCELADA ? SIN_ID_RESERVA : resp->reserva;
+    }
+    en_vuelo[ranura].ocupada = 0; //Libera la ranura para la siguiente solicitud
+    ranuras_libres[num_libres++] = (int)ranura;
+    pendientes--;
+    pthread_cond_broadcast(&cambio_envio);
+    pthread_mutex_unlock(&cerrojo_envio);
+    if (resp->codigo == RESP_OK || resp->codigo == RESP_REPROGRAMADA) { //Muestra la respuesta por pantalla, con el id de la reserva
+        char texto[TAM_INSTANTE];
+        texto_instante(resp->inicio, texto, sizeof(texto));
+        printf("Respuesta: %s|%s|%s|%u\n", nombre_respuesta(resp->codigo), familia, texto, resp->reserva);
+    } else if (resp->codigo == RESP_CANCELADA)
+        printf("Respuesta: %s|%s|%u\n", nombre_respuesta(resp->codigo), familia, resp->reserva);
+    else
+        printf("Respuesta: %s|%s\n", nombre_respuesta(resp->codigo), familia);
+}
+
+//Empareja la respuesta de una consulta con su ranura, la libera y muestra una linea por franja
+static void entregar_disponibilidad(uint32_t id, const MsgDisponibilidad* disp) {
+    uint32_t ranura = id & (MAX_VENTANA - 1);
+    pthread_mutex_lock(&cerrojo_envio);
+    if (!en_vuelo[ranura].ocupada || en_vuelo[ranura].id != id) {
+        pthread_mutex_unlock(&cerrojo_envio);
+        return;
+    }
+    int personas = en_vuelo[ranura].sol.personas; //Sin grupo no se dice si cabe
+    en_vuelo[ranura].ocupada = 0;
+    ranuras_libres[num_libres++] = (int)ranura;
+    pendientes--;
+    pthread_cond_broadcast(&cambio_envio);
+    pthread_mutex_unlock(&cerrojo_envio);
+    if (disp->cantidad == 0) printf("Disponibilidad: ninguna franja abierta en el rango\n");
+    for (int i = 0; i < disp->cantidad; i++) {
+        char texto[TAM_INSTANTE];
+        texto_instante(disp->franjas[i].minuto, texto, sizeof(texto));
+        if (personas > 0)
+            printf("Disponibilidad: %s|%d|%s\n", texto, disp->franjas[i].libres, disp->franjas[i].cabe ? "CABE" : "NO_CABE");
+        else
+            printf("Disponibilidad: %s|%d\n", texto, disp->franjas[i].libres);
+    }
+}
+
+//Hilo receptor: entrega cada respuesta, sola o dentro de un lote
+static void* recibir_respuestas(void* arg) {
+    int fd_propio = *(int*)arg;
+    CabeceraTrama cab;
+    const uint8_t* cuerpo;
+    MsgRespuesta resps[MAX_LOTE];
+    uint32_t ids[MAX_LOTE];
+    MsgDisponibilidad disp;
+    while (esperar_trama(fd_propio, &cab, &cuerpo)) { //Espera a que haya una respuesta que leer
+        if (cab.tipo == MSG_TERMINAR) break; //La simulacion ya acabo (o el propio agente pidio salir)
+        if (cab.tipo == MSG_RESPUESTA && decodificar_respuesta(cuerpo, cab.longitud, &resps[0]) == 0) {
+            entregar_respuesta(cab.id_solicitud, &resps[0]);
+        } else if (cab.tipo == MSG_RESPUESTA_LOTE) {
+            int n = decodificar_respuesta_lote(cuerpo, cab.longitud, resps, ids);
+            for (int i = 0; i < n; i++) entregar_respuesta(ids[i], &resps[i]);
+        } else if (cab.tipo == MSG_RESPUESTA_DISPONIBILIDAD && decodificar_disponibilidad(cuerpo, cab.longitud, &disp) == 0) {
+            entregar_disponibilidad(cab.id_solicitud, &disp);
+        }
+    }
+    pthread_mutex_lock(&cerrojo_envio);
+    terminado = 1; //Ya no llegaran mas respuestas
+    pthread_cond_broadcast(&cambio_envio);
+    pthread_mutex_unlock(&cerrojo_envio);
+    return NULL;
+}
+
+//Espera un aviso del receptor con cerrojo_envio tomado, a lo sumo hasta limite_ns (0 sin limite)
+//Si hay solicitudes esperando su reintento despierta a tiempo y reenvia una, soltando el cerrojo mientras
+//escribe; quien llama vuelve a revisar su condicion. Retorna -1 si el controlador ya no recibe
+static int esperar_aviso(int fd_entrada, uint64_t limite_ns) {
+    int vencida = -1;
+    if (por_reintentar > 0) { //Solo con reintentos pendientes se recorre la ventana
+        uint64_t ahora = reloj_ns();
+        for (int i = 0; i < ventana_envio && vencida == -1; i++) {
+            uint64_t cuando = en_vuelo[i].reintentar_ns;
+            if (!en_vuelo[i].ocupada || cuando == 0) continue;
+            if (cuando <= ahora) vencida = i;
+            else if (limite_ns == 0 || cuando < limite_ns) limite_ns = cuando;
+        }
+    }
+    if (vencida == -1) {
+        if (limite_ns == 0) {
+            pthread_cond_wait(&cambio_envio, &cerrojo_envio);
+        } else {
+            struct timespec limite = { (time_t)(limite_ns / 1000000000ULL), (long)(limite_ns % 1000000000ULL) };
+            pthread_cond_timedwait(&cambio_envio, &cerrojo_envio, &limite);
+        }
+        return 0;
+    }
+    SolicitudEnVuelo v = en_vuelo[vencida]; //Se reenvia con el mismo id, asi la respuesta vuelve a esta ranura
+    en_vuelo[vencida].reintentar_ns = 0;
+    por_reintentar--;
+    pthread_mutex_unlock(&cerrojo_envio);
+    uint8_t trama[MAX_TRAMA];
+    int len = v.tipo == MSG_SOLICITUD ? codificar_solicitud(trama, v.id, &v.sol)
+                                      : codificar_cambio(trama, (uint16_t)v.tipo, v.id, &v.sol);
+    int r = 0;
+    if (len < 0 || enviar_trama(fd_entrada, trama, len) == -1) {
+        if (errno == EPIPE) printf("El controlador ya termino, no se envian mas solicitudes.\n");
+        else perror("write reintento");
+        r = -1;
+    }
+    pthread_mutex_lock(&cerrojo_envio);
+    return r;
+}
+
+//Despues de un OCUPADO no envia nada nuevo hasta que pase la espera, reenviando mientras tanto lo que venza
+//Retorna -1 si el controlador ya no recibe
+static int respetar_ocupado(int fd_entrada) {
+    int r = 0;
+    pthread_mutex_lock(&cerrojo_envio);
+    while (r == 0 && !terminado && reloj_ns() < pausa_ocupado_ns)
+        r = esperar_aviso(fd_entrada, pausa_ocupado_ns);
+    pthread_mutex_unlock(&cerrojo_envio);
+    return r;
+}
+
+//Ocupa la ranura libre de arriba de la pila con lo que se va a enviar y retorna su id; con cerrojo_envio tomado
+static uint32_t ocupar_ranura(int tipo, const MsgSolicitud* sol, uint32_t* secuencia) {
+    int ranura = ranuras_libres[--num_libres];
+    uint32_t id = (++*secuencia << BITS_RANURA) | (uint32_t)ranura; //Id unico mientras la solicitud este en vuelo
+    en_vuelo[ranura].ocupada = 1;
+    en_vuelo[ranura].id = id;
+    en_vuelo[ranura].tipo = tipo;
+    en_vuelo[ranura].sol = *sol;
+    en_vuelo[ranura].intentos = 0;
+    en_vuelo[ranura].reintentar_ns = 0;
+    pendientes++;
+    return id;
+}
+
+//Espera la pausa configurada entre envios; se corta antes si la simulacion termina
+static void pausar_envio(void) {
+    if (pausa_ms <= 0) return; //Sin pausa: se envia a la velocidad del controlador
+    struct timespec limite;
+    clock_gettime(CLOCK_MONOTONIC, &limite);
+    limite.tv_sec += pausa_ms / 1000;
+    limite.tv_nsec += (pausa_ms % 1000) * 1000000L;
+    if (limite.tv_nsec >= 1000000000L) { limite.tv_sec++; limite.tv_nsec -= 1000000000L; }
+    pthread_mutex_lock(&cerrojo_envio);
+    while (!terminado && pthread_cond_timedwait(&cambio_envio, &cerrojo_envio, &limite) != ETIMEDOUT);
+    pthread_mutex_unlock(&cerrojo_envio);
+}
+
+//Envia una trama ya codificada al controlador y hace la pausa, retorna 0 o -1 si ya no recibe
+static int enviar_y_pausar(int fd_entrada, const uint8_t* trama, int len) {
+    if (len < 0 || enviar_trama(fd_entrada, trama, len) == -1) { //Se la envia al controlador
+        if (errno == EPIPE) printf("El controlador ya termino, no se envian mas solicitudes.\n");
+        else perror("write solicitud");
+        return -1;
+    }
+    pausar_envio(); //Pausa
+    return 0;
+}
+
+//Envia las solicitudes acumuladas: una sola como MSG_SOLICITUD, varias como MSG_SOLICITUD_LOTE
+static int enviar_acumuladas(int fd_entrada, uint32_t id_agente, const MsgSolicitud* sols, const uint32_t* ids, int cantidad) {
+    uint8_t trama[MAX_TRAMA];
+    int len = cantidad == 1 ? codificar_solicitud(trama, ids[0], &sols[0])
+                            : codificar_lote(trama, id_agente, sols, ids, cantidad);
+    return enviar_y_pausar(fd_entrada, trama, len);
+}
+
+//Envia un CANCELAR o MODIFICAR de la ultima reserva confirmada de la familia de la fila
+//Primero espera todas las respuestas pendientes, asi la de la reserva que se quiere cambiar ya llego
+//Retorna 0 si se envio o se ignoro, 1 si la simulacion ya acabo o -1 si el controlador ya no recibe
+static int enviar_cambio(int fd_entrada, uint32_t id_agente, const FilaCsv* fila, uint32_t* secuencia) {
+    MsgSolicitud sol = { "", fila->inicio, fila->personas, id_agente, 0, SIN_ID_RESERVA };
+    memcpy(sol.familia, fila->familia, (size_t)fila->largo_familia);
+    sol.familia[fila->largo_familia] = '\0';
+    int r = 0;
+    pthread_mutex_lock(&cerrojo_envio);
+    while (r == 0 && !terminado && pendientes > 0)
+        r = esperar_aviso(fd_entrada, 0);
+    if (r == -1 || terminado) { pthread_mutex_unlock(&cerrojo_envio); return r == -1 ? -1 : 1; }
+    ReservaFamilia* anotada = reserva_de_familia(sol.familia, 0);
+    if (anotada) sol.reserva = anotada->reserva;
+    if (sol.reserva == SIN_ID_RESERVA) {
+        pthread_mutex_unlock(&cerrojo_envio);
+        printf("Cambio ignorado: la familia %s no tiene una reserva confirmada\n", sol.familia);
+        return 0;
+    }
+    uint32_t id = ocupar_ranura(fila->operacion, &sol, secuencia); //Sin pendientes todas las ranuras estan libres
+    pthread_mutex_unlock(&cerrojo_envio);
+    uint8_t trama[MAX_TRAMA];
+    return enviar_y_pausar(fd_entrada, trama, codificar_cambio(trama, (uint16_t)fila->operacion, id, &sol));
+}
+
+//Envia una consulta de disponibilidad en su propia trama; ocupa una ranura de la ventana como una solicitud
+//Retorna 0 si se envio, 1 si la simulacion ya acabo o -1 si el controlador ya no recibe
+static int enviar_consulta(int fd_entrada, uint32_t id_agente, const FilaCsv* fila, uint32_t* secuencia) {
+    MsgConsulta consulta = { id_agente, fila->parque, fila->inicio, fila->hasta, fila->personas };
+    MsgSolicitud sol = { "", fila->inicio, fila->personas, id_agente, fila->parque, SIN_ID_RESERVA }; //Lo que se recuerda en vuelo
+    int r = 0;
+    pthread_mutex_lock(&cerrojo_envio);
+    while (r == 0 && !terminado && pendientes == ventana_envio)
+        r = esperar_aviso(fd_entrada, 0);
+    if (r == -1 || terminado) { pthread_mutex_unlock(&cerrojo_envio); return r == -1 ? -1 : 1; }
+    uint32_t id = ocupar_ranura(MSG_DISPONIBILIDAD, &sol, secuencia);
+    pthread_mutex_unlock(&cerrojo_envio);
+    uint8_t trama[MAX_TRAMA];
+    return enviar_y_pausar(fd_entrada, trama, codificar_consulta(trama, id, &consulta));
+}
+
 //Recibe todos los datos de la solictud y espera las respuestas que les va a devolver
-void procesar_solicitudes(int fd_entrada, int fd_propio, char* archivo_solicitudes, char* nombre_agente, int hora_actual) {
-    FILE* archivo = fopen(archivo_solicitudes, "r"); //Abre el archivo con las solicitudes
-    if (!archivo) {
-        perror("fopen archivo_solicitudes"); //Muestra un error sino logra abrirlo
+//Mantiene hasta ventana_envio solicitudes sin respuesta; el hilo receptor las va liberando
+void procesar_solicitudes(int fd_entrada, int fd_propio, char* archivo_solicitudes, uint32_t id_agente, int hora_actual) {
+    LectorCsv archivo; //El archivo con las solicitudes, mapeado en memoria
+    if (csv_abrir(&archivo, archivo_solicitudes) == -1) {
+        perror("abrir archivo_solicitudes"); //Muestra un error sino logra abrirlo
+        exit(1);
+    }
+    //La pausa usa el reloj monotonico para no depender de cambios en la hora del sistema
+    pthread_condattr_t atributos;
+    pthread_condattr_init(&atributos);
+    pthread_condattr_setclock(&atributos, CLOCK_MONOTONIC);
+    pthread_cond_init(&cambio_envio, &atributos);
+    pthread_condattr_destroy(&atributos);
+    for (int i = 0; i < ventana_envio; i++) ranuras_libres[i] = ventana_envio - 1 - i; //Todas las ranuras libres
+    num_libres = ventana_envio;
+    semilla_espera = (unsigned int)getpid() ^ (unsigned int)reloj_ns(); //Cada agente espera distinto
+
+    pthread_t receptor;
+    if (pthread_create(&receptor, NULL, recibir_respuestas, &fd_propio) != 0) {
+        perror("pthread_create receptor");
         exit(1);
     }
-    char linea[256]; //buffer para el contenido del csv
-    char buffer[MAX_BUFFER]; //buffer para respuestas
-    while (fgets(linea, sizeof(linea), archivo)) { //hasta que no lo lea todo no para
-        char familia[MAX_NOMBRE], hora_str[10], personas_str[10]; 
-        if (sscanf(linea, "%[^,],%[^,],%s", familia, hora_str, personas_str) != 3) continue; //Revisa la estructura de la solicitud
-        int hora = atoi(hora_str); //Hace que la hora pase a ser un entero
-        int personas = atoi(personas_str); //Cantidad de personas a entero
-        if (hora < hora_actual) { //Si la hora de la solicitud es menor a la actual, ignora la solicitud
-            printf("Solicitud ignorada: %s, hora %d (anterior a %d)\n", familia, hora, hora_actual);
+
+    uint32_t secuencia = 0; //Cuenta las solicitudes enviadas, forma la parte alta del id
+    MsgSolicitud acumuladas[MAX_LOTE]; //Solicitudes que todavia no se han enviado
+    uint32_t ids[MAX_LOTE];
+    int num_acumuladas = 0;
+    int bytes_lote = TAM_BASE_LOTE; //Lo que ocuparia la trama del lote con las acumuladas
+    int fallo = 0; //1 si el controlador ya no recibe
+    FilaCsv fila;
+    const char* error;
+    int r;
+    while (!fallo && (r = csv_siguiente(&archivo, &fila, &error)) != 0) { //hasta que no lo lea todo no para
+        if (r == -1) { //La linea no tiene la estructura de una solicitud
+            fprintf(stderr, "Linea %ld de %s ignorada: %s\n", archivo.linea, archivo_solicitudes, error);
+            continue;
+        }
+        if ((fila.operacion == MSG_SOLICITUD || fila.operacion == MSG_MODIFICAR) && fila.inicio < hora_actual) { //Si la hora de la solicitud es menor a la actual, ignora la solicitud
+            char pedida[TAM_INSTANTE], actual[TAM_INSTANTE];
+            texto_instante(fila.inicio, pedida, sizeof(pedida));
+            texto_instante(hora_actual, actual, sizeof(actual));
+            printf("Solicitud ignorada: %.*s, hora %s (anterior a %s)\n", fila.largo_familia, fila.familia, pedida, actual);
+            continue;
+        }
+        if (respetar_ocupado(fd_entrada) == -1) { fallo = 1; break; } //El controlador pidio esperar
+        if (fila.operacion != MSG_SOLICITUD) { //Un cambio o una consulta sale solo, despues de lo acumulado
+            if (num_acumuladas > 0 && enviar_acumuladas(fd_entrada, id_agente, acumuladas, ids, num_acumuladas) == -1) { fallo = 1; break; }
+            num_acumuladas = 0;
+            bytes_lote = TAM_BASE_LOTE;
+            int r_cambio = fila.operacion == MSG_DISPONIBILIDAD ? enviar_consulta(fd_entrada, id_agente, &fila, &secuencia)
+                                                                : enviar_cambio(fd_entrada, id_agente, &fila, &secuencia);
+            if (r_cambio == -1) fallo = 1;
+            if (r_cambio != 0) break;
             continue;
         }
-        char msg_solicitud[256];
-        sprintf(msg_solicitud, "SOLICITUD|%s|%d|%d|%s", familia, hora, personas, nombre_agente);
-        write(fd_entrada, msg_solicitud, strlen(msg_solicitud)); //Se la envia al controlador
+        MsgSolicitud sol = { "", fila.inicio, fila.personas, id_agente, fila.parque, SIN_ID_RESERVA };
+        memcpy(sol.familia, fila.familia, (size_t)fila.largo_familia); //El lector ya garantizo que cabe
+        sol.familia[fila.largo_familia] = '\0';
+
+        //Si la solicitud ya no cabe en la trama del lote o es de otro parque, se envia lo acumulado primero
+        int bytes_sol = TAM_FIJO_EN_LOTE + fila.largo_familia;
+        if (num_acumuladas > 0 && (bytes_lote + bytes_sol > MAX_TRAMA || acumuladas[0].parque != sol.parque)) {
+            if (enviar_acumuladas(fd_entrada, id_agente, acumuladas, ids, num_acumuladas) == -1) { fallo = 1; break; }
+            num_acumuladas = 0;
+            bytes_lote = TAM_BASE_LOTE;
+        }
+
+        pthread_mutex_lock(&cerrojo_envio);
+        if (!terminado && pendientes == ventana_envio && num_acumuladas > 0) {
+            //La ventana se lleno con solicitudes que aun no salen: hay que enviarlas antes de esperar
+            pthread_mutex_unlock(&cerrojo_envio);
+            if (enviar_acumuladas(fd_entrada, id_agente, acumuladas, ids, num_acumuladas) == -1) { fallo = 1; break; }
+            num_acumuladas = 0;
+            bytes_lote = TAM_BASE_LOTE;
+            pthread_mutex_lock(&cerrojo_envio);
+        }
+        int fallo_espera = 0;
+        while (!fallo_espera && !terminado && pendientes == ventana_envio) //Espera a que haya lugar en la ventana
+            fallo_espera = esperar_aviso(fd_entrada, 0) == -1;
+        if (fallo_espera) { pthread_mutex_unlock(&cerrojo_envio); fallo = 1; break; }
+        if (terminado) { pthread_mutex_unlock(&cerrojo_envio); num_acumuladas = 0; break; } //La simulacion ya acabo
+        uint32_t id = ocupar_ranura(MSG_SOLICITUD, &sol, &secuencia);
+        pthread_mutex_unlock(&cerrojo_envio);
 
-        int n = read(fd_propio, buffer, sizeof(buffer) - 1); //Espera a que haya una respuesta que leer
-        if (n > 0) {
-            buffer[n] = '\0';
-            printf("Respuesta: %s\n", buffer); //Muestra la respuesta por pantalla
+        acumuladas[num_acumuladas] = sol;
+        ids[num_acumuladas++] = id;
+        bytes_lote += bytes_sol;
+        if (num_acumuladas == tam_lote) { //El lote esta completo
+            fallo = enviar_acumuladas(fd_entrada, id_agente, acumuladas, ids, num_acumuladas) == -1;
+            num_acumuladas = 0;
+            bytes_lote = TAM_BASE_LOTE;
         }
-        sleep(2); //Pausa
     }
-    fclose(archivo); //Cierra el permiso para leer archivos
+    if (!fallo && num_acumuladas > 0) //Lo que quedo al final del archivo
+        fallo = enviar_acumuladas(fd_entrada, id_agente, acumuladas, ids, num_acumuladas) == -1;
+    csv_cerrar(&archivo); //Quita el mapeo del archivo
+
+    //Espera las respuestas que faltan, reenviando las que volvieron OCUPADO; si el envio fallo ya no van a llegar
+    pthread_mutex_lock(&cerrojo_envio);
+    while (!fallo && !terminado && pendientes > 0)
+        fallo = esperar_aviso(fd_entrada, 0) == -1;
+    int despertar = !terminado;
+    pthread_mutex_unlock(&cerrojo_envio);
+    if (!fallo && despertar) { //Le avisa que ya no hay mas solicitudes; con reloj virtual el controlador espera este aviso
+        uint8_t trama[MAX_TRAMA]; //Sale despues de los reintentos, asi el reloj virtual no avanza con alguno pendiente
+        int len = codificar_fin_solicitudes(trama, id_agente);
+        enviar_trama(fd_entrada, trama, len);
+    }
+    if (despertar && transporte == TRANSPORTE_SHM) { //El receptor duerme en el futex: cerrar el anillo lo despierta
+        anillo_cerrar(anillo_propio);
+    } else if (despertar && transporte == TRANSPORTE_UNIX) { //Cerrar la lectura hace que su read retorne 0
+        shutdown(fd_conexion, SHUT_RD);
+    } else if (despertar) { //El receptor sigue bloqueado en read: se le escribe un TERMINAR por el propio pipe
+        uint8_t trama[MAX_TRAMA];
+        int len = codificar_vacio(trama, MSG_TERMINAR, 0);
+        escribir_trama(fd_escritura_propia, trama, len);
+    }
+    pthread_join(receptor, NULL);
+    pthread_cond_destroy(&cambio_envio);
+    free(familias);
+    familias = NULL;
+    if (respuestas_ocupado > 0)
+        printf("El controlador respondio OCUPADO %ld veces; esas solicitudes se reenviaron\n", respuestas_ocupado);
 }
 // Cierre los pipes que esten abiertos y los elimina de ser necesario
 void cerrar_y_limpiar(int fd_entrada, int fd_propio, char* pipe_propio, char* nombre_agente) {
+    if (transporte == TRANSPORTE_UNIX) {
+        close(fd_conexion); //El controlador ve el fin de la conexion y desactiva al agente
+        printf("Agente %s termina.\n", nombre_agente);
+        return;
+    }
+    if (transporte == TRANSPORTE_SHM) {
+        anillo_cerrar(anillo_propio); //El controlador ve EPIPE si intenta responder despues
+        anillo_liberar(anillo_propio);
+        anillo_liberar(anillo_controlador);
+        anillo_borrar(pipe_propio); //Elimina el objeto compartido
+        printf("Agente %s termina.\n", nombre_agente);
+        return;
+    }
     close(fd_entrada); //Cierra el pipe hacia el controlador
     close(fd_propio); //Cierra su pipe
+    if (fd_escritura_propia != -1) close(fd_escritura_propia);
     unlink(pipe_propio); //Elimina el FIFO
     printf("Agente %s termina.\n", nombre_agente); //Mensaje confirmando que lo termino
 }
@@ -1,9 +1,9 @@
-/******************************************************
-* Fecha 11/11/2025
-* Pontificia Universidad Javeriana
-* Profesor: J. Corredor, PhD
-* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
-* Materia: Sistemas opertivos
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
 * Temas: Proyecto agente_funciones.h
 *
 * Descripción:
@@ -15,43 +15,66 @@
 * y recibir respuestas. Además, se incluyen funciones de manejo de
 * archivos, comunicación por pipes y limpieza de recursos. Este módulo
 * estructura la interfaz del agente, permitiendo su correcta interacción
-* con el controlador en un entorno concurrente.
-******************************************************/
-
-#ifndef AGENTE_FUNCIONES_H
-#define AGENTE_FUNCIONES_H
-
-#include <stdio.h> //Libreria para mostrar informacion por pantalla
-#include <stdlib.h> //Libreria de memoria dinamica
-#include <string.h> //libreria para cadenas de caracteres
-#include <unistd.h> //Libreria para funciones relacionadas con posix
-#include <fcntl.h> // Libreria para constantes y flags para open
-#include <sys/stat.h> //Libreria para archivos y permisos
-#include <sys/types.h> //Libreria para syscalls
-#include <errno.h> //Libreria para manejo de errores
-
-#define MAX_NOMBRE 50 //Cantidad maxima de caracteres en un nombre
-#define MAX_BUFFER 256 //Cantidad maxima de caracteres para el buffer (lectura y escritura)
-
-//Prototipos de las funciones 
-
-// Recibe los argumentos, guarda el nombre del agente, el nombre del archivo de las solicitudes y el nombre del pipe
-void parsear_argumentos(int argc, char* argv[], char* nombre_agente, char* archivo_solicitudes, char* pipe_entrada);
-
-// Crea un pipe para que el controlador envia los datos
-void crear_pipe_propio(char* pipe_propio, char* nombre_agente);
-// Le indica al controlador un mensaje con el nombre del agente y el pipe a utilizar
-int registrar_agente_controlador(char* nombre_agente, char* pipe_propio, char* pipe_entrada);
-//Abre el pipe ya sea para lectura o escritura
-int abrir_pipe_propio(char* pipe_propio);
-//recibe la hora inicial y verifica que el mensaje sea para ese agente
-int recibir_hora_inicial(int fd_propio, char* nombre_agente);
-//Recibe todos los datos de la solictud y espera las respuestas que les va a devolver
-void procesar_solicitudes(int fd_entrada, int fd_propio, char* archivo_solicitudes, char* nombre_agente, int hora_actual);
-// Cierre los pipes que esten abiertos y los elimina de ser necesario
-void cerrar_y_limpiar(int fd_entrada, int fd_propio, char* pipe_propio, char* nombre_agente);
-
-#endif
+* con el controlador en un entorno concurrente.
+******************************************************/
+
+#ifndef AGENTE_FUNCIONES_H
+#define AGENTE_FUNCIONES_H
+
+#include <stdio.h> //Libreria para mostrar informacion por pantalla
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <string.h> //libreria para cadenas de caracteres
+#include <unistd.h> //Libreria para funciones relacionadas con posix
+#include <fcntl.h> // Libreria para constantes y flags para open
+#include <sys/stat.h> //Libreria para archivos y permisos
+#include <sys/types.h> //Libreria para syscalls
+#include <errno.h> //Libreria para manejo de errores
+#include <sys/socket.h> //Libreria para shutdown
+#include <pthread.h> // Libreria para el hilo receptor
+#include <time.h> //Libreria para clock_gettime
+
+#include "protocolo.h" //Formato de las tramas y MAX_NOMBRE
+#include "transporte_shm.h" //Anillos en memoria compartida para -x shm
+#include "transporte_unix.h" //Conexion SOCK_SEQPACKET para -x unix
+#include "lector_csv.h" //Lectura del archivo de solicitudes mapeado en memoria
+
+#define MAX_BUFFER 256 //Cantidad maxima de caracteres para el buffer (lectura y escritura)
+#define MAX_RUTA 256 //Cantidad maxima de caracteres en la ruta del archivo de solicitudes
+#define BITS_RANURA 12 //Bits bajos del id de solicitud que indican la ranura de la ventana
+#define MAX_VENTANA (1 << BITS_RANURA) //Solicitudes en vuelo que distinguen los ids; cada transporte permite menos
+//Cada solicitud en vuelo puede volver en su propia trama (una consulta trae casi MAX_TRAMA), y todas deben caber a la
+//vez en el canal de respuestas mientras el agente no las lee: si no, el controlador tiene que guardarlas
+#define TAM_PIPE_RESPUESTA 65536 //Capacidad por defecto de un pipe en Linux
+#define MAX_VENTANA_FIFO (TAM_PIPE_RESPUESTA / MAX_TRAMA) //Tramas del peor tamano que caben en el pipe propio
+#define MAX_VENTANA_SHM RANURAS_RESPUESTA //Una trama por ranura del anillo propio
+#define MAX_VENTANA_UNIX 128 //La conexion guarda unas 160 tramas del peor tamano con el buffer por defecto
+#define MAX_ESPERA_OCUPADO_MS 2000 //Tope de la espera entre reintentos cuando el controlador responde OCUPADO
+
+extern int ventana_envio; //Solicitudes que pueden estar sin respuesta al mismo tiempo (-v)
+extern long pausa_ms; //Pausa entre envios en milisegundos (-d), 0 si no hay pausa
+extern int tam_lote; //Solicitudes que se agrupan en cada trama (-b)
+extern int transporte; //TRANSPORTE_FIFO, TRANSPORTE_SHM o TRANSPORTE_UNIX (-x)
+
+//Prototipos de las funciones 
+
+// Recibe los argumentos, guarda el nombre del agente, el nombre del archivo de las solicitudes y el nombre del pipe
+//Tambien lee las opciones -v (ventana), -b (lote), -d (pausa) y -x (transporte) si vienen
+void parsear_argumentos(int argc, char* argv[], char* nombre_agente, char* archivo_solicitudes, char* pipe_entrada);
+
+// Crea un pipe para que el controlador envia los datos
+void crear_pipe_propio(char* pipe_propio, char* nombre_agente);
+// Le indica al controlador un mensaje con el nombre del agente y el pipe a utilizar
+int registrar_agente_controlador(char* nombre_agente, char* pipe_propio, char* pipe_entrada);
+//Abre el pipe ya sea para lectura o escritura
+int abrir_pipe_propio(char* pipe_propio);
+//recibe la hora inicial y verifica que el mensaje sea para ese agente
+int recibir_hora_inicial(int fd_propio, char* nombre_agente, uint32_t* id_agente);
+//Recibe todos los datos de la solictud y espera las respuestas que les va a devolver
+void procesar_solicitudes(int fd_entrada, int fd_propio, char* archivo_solicitudes, uint32_t id_agente, int hora_actual);
+// Cierre los pipes que esten abiertos y los elimina de ser necesario
+void cerrar_y_limpiar(int fd_entrada, int fd_propio, char* pipe_propio, char* nombre_agente);
+
+#endif
 
 /******************************************************
 * CONCLUSIÓN
@@ -68,6 +91,6 @@ void cerrar_y_limpiar(int fd_entrada, int fd_propio, char* pipe_propio, char* no
 * de forma independiente mientras mantienen sincronización
 * con el controlador, permitiendo así el funcionamiento
 * distribuido y estable de la simulación.
-******************************************************/
-
-
+******************************************************/
+
+
@@ -0,0 +1,211 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto almacen_reservas.c
+*
+* Descripción:
+* Este archivo implementa la tabla de reservas por bloques. Los indices
+* se reparten con un contador atomico, de modo que varios trabajadores
+* pueden guardar reservas al mismo tiempo; el cerrojo solo se toma
+* cuando un indice cae en un bloque que todavia no existe. La tabla de
+* ids usa sondeo lineal y, al quitar, corre hacia atras los que siguen,
+* asi nunca quedan marcas de borrado que alarguen las busquedas.
+******************************************************/
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <string.h> //libreria para memset
+
+#include "almacen_reservas.h"
+
+// Prepara un almacen vacio
+void almacen_iniciar(AlmacenReservas* a) {
+    for (int i = 0; i < MAX_BLOQUES_RESERVAS; i++)
+        atomic_init(&a->bloques[i], NULL);
+    atomic_init(&a->siguiente, 0);
+    pthread_mutex_init(&a->cerrojo, NULL);
+}
+
+//Retorna el bloque pedido, creandolo si es el primero en usarlo
+static Reserva* bloque(AlmacenReservas* a, uint32_t b) {
+    Reserva* blq = atomic_load(&a->bloques[b]);
+    if (blq) return blq;
+    pthread_mutex_lock(&a->cerrojo);
+    blq = atomic_load(&a->bloques[b]); //Otro hilo pudo crearlo mientras se esperaba el cerrojo
+    if (!blq) {
+        blq = malloc(sizeof(Reserva) * RESERVAS_POR_BLOQUE);
+        if (blq) atomic_store(&a->bloques[b], blq);
+    }
+    pthread_mutex_unlock(&a->cerrojo);
+    return blq;
+}
+
+// Guarda una copia de la reserva y retorna su indice, o SIN_RESERVA si la tabla esta llena
+uint32_t almacen_guardar(AlmacenReservas* a, const Reserva* r) {
+    uint32_t i = atomic_fetch_add(&a->siguiente, 1);
+    if (i / RESERVAS_POR_BLOQUE >= MAX_BLOQUES_RESERVAS) return SIN_RESERVA;
+    Reserva* blq = bloque(a, i / RESERVAS_POR_BLOQUE);
+    if (!blq) return SIN_RESERVA;
+    blq[i % RESERVAS_POR_BLOQUE] = *r;
+    return i;
+}
+
+// Retorna la reserva guardada en un indice
+Reserva* almacen_obtener(AlmacenReservas* a, uint32_t indice) {
+    return &atomic_load(&a->bloques[indice / RESERVAS_POR_BLOQUE])[indice % RESERVAS_POR_BLOQUE];
+}
+
+// Libera todos los bloques
+void almacen_destruir(AlmacenReservas* a) {
+    for (int i = 0; i < MAX_BLOQUES_RESERVAS; i++) {
+        free(atomic_load(&a->bloques[i]));
+        atomic_store(&a->bloques[i], NULL);
+    }
+    pthread_mutex_destroy(&a->cerrojo);
+}
+
+//Hash de Fibonacci: los bits bajos del id son el parque, iguales en toda la tabla, por eso se usan los altos
+static uint32_t espacio_de(const TablaReservas* t, uint32_t id) {
+    return (uint32_t)(id * 2654435769u) >> (32 - t->bits);
+}
+
+//Pide un arreglo vacio de 2^bits espacios y lo deja en la tabla, retorna 0 o -1
+static int preparar_espacios(TablaReservas* t, int bits) {
+    EntradaTabla* espacios = calloc((size_t)1 << bits, sizeof(EntradaTabla)); //Id 0 es espacio vacio
+    if (!espacios) return -1;
+    t->espacios = espacios;
+    t->bits = bits;
+    t->capacidad = 1u << bits;
+    return 0;
+}
+
+//Pone una entrada en el primer espacio libre desde su hash, sin revisar si ya estaba
+static void colocar(TablaReservas* t, const EntradaTabla* e) {
+    uint32_t i = espacio_de(t, e->id);
+    while (t->espacios[i].id != 0) i = (i + 1) & (t->capacidad - 1);
+    t->espacios[i] = *e;
+}
+
+//Posicion del id en la tabla, o -1 si no esta; se llama con el cerrojo tomado
+static int64_t posicion_de(const TablaReservas* t, uint32_t id) {
+    for (uint32_t i = espacio_de(t, id);; i = (i + 1) & (t->capacidad - 1)) {
+        if (t->espacios[i].id == 0) return -1; //Espacio vacio: el id no esta
+        if (t->espacios[i].id == id) return i;
+    }
+}
+
+// Prepara una tabla vacia, retorna 0 o -1 si no hay memoria
+int tabla_iniciar(TablaReservas* t) {
+    int bits = 0;
+    while ((1u << bits) < CAPACIDAD_INICIAL_TABLA) bits++;
+    t->cantidad = 0;
+    pthread_mutex_init(&t->cerrojo, NULL);
+    return preparar_espacios(t, bits);
+}
+
+// Guarda o reemplaza el lugar de un id, retorna 0 o -1 si no hay memoria para crecer
+int tabla_poner(TablaReservas* t, uint32_t id, int franja, uint32_t indice) {
+    EntradaTabla e = { id, franja, indice };
+    pthread_mutex_lock(&t->cerrojo);
+    int64_t i = posicion_de(t, id);
+    if (i >= 0) { //Una reserva que se modifico cambia de lugar con el mismo id
+        t->espacios[i] = e;
+        pthread_mutex_unlock(&t->cerrojo);
+        return 0;
+    }
+    if ((t->cantidad + 1) * 2 > t->capacidad) { //A la mitad se duplica, asi las busquedas siguen cortas
+        EntradaTabla* viejos = t->espacios;
+        uint32_t capacidad = t->capacidad;
+        if (preparar_espacios(t, t->bits + 1) == -1) {
+            pthread_mutex_unlock(&t->cerrojo);
+            return -1;
+        }
+        for (uint32_t k = 0; k < capacidad; k++)
+            if (viejos[k].id != 0) colocar(t, &viejos[k]);
+        free(viejos);
+    }
+    colocar(t, &e);
+    t->cantidad++;
+    pthread_mutex_unlock(&t->cerrojo);
+    return 0;
+}
+
+// Busca el lugar de un id, retorna 1 si esta o 0 si no
+int tabla_buscar(TablaReservas* t, uint32_t id, int* franja, uint32_t* indice) {
+    if (id == 0) return 0;
+    pthread_mutex_lock(&t->cerrojo);
+    int64_t i = posicion_de(t, id);
+    if (i >= 0) {
+        *franja = t->espacios[i].franja;
+        *indice = t->espacios[i].indice;
+    }
+    pthread_mutex_unlock(&t->cerrojo);
+    return i >= 0;
+}
+
+// Quita un id si esta
+//Los que siguen en la misma racha se corren hacia atras si su hash lo permite, asi ninguna busqueda se corta antes
+void tabla_quitar(TablaReservas* t, uint32_t id) {
+    pthread_mutex_lock(&t->cerrojo);
+    int64_t encontrado = posicion_de(t, id);
+    if (encontrado >= 0) {
+        uint32_t mascara = t->capacidad - 1;
+        uint32_t hueco = (uint32_t)encontrado;
+        for (uint32_t i = (hueco + 1) & mascara; t->espacios[i].id != 0; i = (i + 1) & mascara) {
+            uint32_t propio = espacio_de(t, t->espacios[i].id);
+            if (((i - propio) & mascara) >= ((i - hueco) & mascara)) { //Su espacio propio no esta entre el hueco y el
+                t->espacios[hueco] = t->espacios[i];
+                hueco = i;
+            }
+        }
+        t->espacios[hueco].id = 0;
+        t->cantidad--;
+    }
+    pthread_mutex_unlock(&t->cerrojo);
+}
+
+// Reservas guardadas en la tabla
+uint32_t tabla_cantidad(TablaReservas* t) {
+    pthread_mutex_lock(&t->cerrojo);
+    uint32_t n = t->cantidad;
+    pthread_mutex_unlock(&t->cerrojo);
+    return n;
+}
+
+// Libera la tabla
+void tabla_destruir(TablaReservas* t) {
+    free(t->espacios);
+    t->espacios = NULL;
+    t->capacidad = t->cantidad = 0;
+    pthread_mutex_destroy(&t->cerrojo);
+}
+
+// Agrega un indice al final de la lista, retorna 0 o -1 si no hay memoria
+int lista_agregar(ListaIndices* l, uint32_t indice) {
+    if (l->cantidad == l->capacidad) { //Duplica el espacio cuando se llena
+        int nueva = l->capacidad > 0 ? l->capacidad * 2 : 16;
+        uint32_t* items = realloc(l->items, sizeof(uint32_t) * nueva);
+        if (!items) return -1;
+        l->items = items;
+        l->capacidad = nueva;
+    }
+    l->items[l->cantidad++] = indice;
+    return 0;
+}
+
+// Libera la memoria de la lista
+void lista_liberar(ListaIndices* l) {
+    free(l->items);
+    memset(l, 0, sizeof(*l));
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* La tabla crece sin mover las reservas ya guardadas, por
+* lo que un indice sigue siendo valido hasta que se vacia el
+* almacen, y las franjas pueden referirse a el sin copias.
+* Cancelar o mover una reserva cuesta una busqueda en la
+* tabla de ids en lugar de recorrer las listas del dia.
+******************************************************/
@@ -0,0 +1,106 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto almacen_reservas.h
+*
+* Descripción:
+* Este archivo define la tabla unica donde se guardan todas las reservas
+* del parque. Cada reserva se guarda una sola vez en bloques grandes que
+* se piden a medida que se necesitan, y cada hora solo guarda la lista
+* compacta de los indices de las reservas que empiezan en ella. Una tabla
+* hash lleva del id que se le devolvio al agente a la reserva guardada,
+* para cancelarla o moverla sin recorrer nada.
+******************************************************/
+#ifndef ALMACEN_RESERVAS_H
+#define ALMACEN_RESERVAS_H
+
+#include <stdint.h> //Libreria para enteros de tamano fijo
+#include <stdatomic.h> //Libreria para el contador compartido entre hilos
+#include <pthread.h> // Libreria para el cerrojo de creacion de bloques
+
+#include "protocolo.h" //MAX_NOMBRE
+
+#define RESERVAS_POR_BLOQUE 1024 //Reservas que caben en cada bloque de la tabla
+#define MAX_BLOQUES_RESERVAS 4096 //Bloques maximos: mas de cuatro millones de reservas
+#define SIN_RESERVA UINT32_MAX //Indice invalido
+#define CAPACIDAD_INICIAL_TABLA 1024 //Espacios con los que arranca la tabla de ids (potencia de 2), crece al llenarse a la mitad
+
+typedef struct {
+    char familia[MAX_NOMBRE]; //Nombre de la familia que realizo la reserva
+    int franja_inicio; //Franja del calendario en que empieza
+    int personas; //Cantidad de integrantes de la familia
+    uint32_t agente; //Id del agente que la pidio
+    uint32_t id; //Id que se le devolvio al agente, el mismo aunque se modifique
+    int cancelada; //1 si se cancelo o se movio a otra franja: las listas de las franjas la saltan
+} Reserva;
+
+typedef struct {
+    _Atomic(Reserva*) bloques[MAX_BLOQUES_RESERVAS]; //Bloques ya pedidos, nunca se mueven
+    atomic_uint siguiente; //Siguiente indice libre
+    pthread_mutex_t cerrojo; //Solo se toma al pedir un bloque nuevo
+} AlmacenReservas;
+
+//Lista de indices de reservas que crece duplicando su tamano
+typedef struct {
+    uint32_t* items; //Indices en la tabla de reservas
+    int cantidad; //Indices guardados
+    int capacidad; //Espacio reservado
+} ListaIndices;
+
+//Donde esta guardada una reserva: su franja de inicio (que dice su dia y su almacen) y su indice en ese almacen
+//La franja se guarda aqui para poder tomar los cerrojos de la estadia sin leer el almacen, que se recicla con el dia
+typedef struct {
+    uint32_t id; //Id de la reserva, 0 si el espacio esta vacio
+    int franja; //Franja del calendario en que empieza
+    uint32_t indice; //Indice en el almacen de su dia
+} EntradaTabla;
+
+//Tabla hash de direccionamiento abierto del id de cada reserva viva a su lugar en los almacenes
+typedef struct {
+    EntradaTabla* espacios; //Arreglo de capacidad espacios
+    uint32_t capacidad; //Potencia de 2
+    int bits; //log2 de la capacidad, el hash usa los bits altos del producto
+    uint32_t cantidad; //Reservas guardadas
+    pthread_mutex_t cerrojo; //Los trabajadores del parque la usan a la vez; nunca se toma un cerrojo de franja con el tomado
+} TablaReservas;
+
+// Prepara un almacen vacio
+void almacen_iniciar(AlmacenReservas* a);
+// Guarda una copia de la reserva y retorna su indice, o SIN_RESERVA si la tabla esta llena
+uint32_t almacen_guardar(AlmacenReservas* a, const Reserva* r);
+// Retorna la reserva guardada en un indice
+Reserva* almacen_obtener(AlmacenReservas* a, uint32_t indice);
+// Libera todos los bloques
+void almacen_destruir(AlmacenReservas* a);
+
+// Prepara una tabla vacia, retorna 0 o -1 si no hay memoria
+int tabla_iniciar(TablaReservas* t);
+// Guarda o reemplaza el lugar de un id, retorna 0 o -1 si no hay memoria para crecer
+int tabla_poner(TablaReservas* t, uint32_t id, int franja, uint32_t indice);
+// Busca el lugar de un id, retorna 1 si esta o 0 si no
+int tabla_buscar(TablaReservas* t, uint32_t id, int* franja, uint32_t* indice);
+// Quita un id si esta
+void tabla_quitar(TablaReservas* t, uint32_t id);
+// Reservas guardadas en la tabla
+uint32_t tabla_cantidad(TablaReservas* t);
+// Libera la tabla
+void tabla_destruir(TablaReservas* t);
+
+// Agrega un indice al final de la lista, retorna 0 o -1 si no hay memoria
+int lista_agregar(ListaIndices* l, uint32_t indice);
+// Libera la memoria de la lista
+void lista_liberar(ListaIndices* l);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Guardar cada reserva una sola vez elimina las copias por
+* hora y el limite fijo de reservas por hora, y como los
+* bloques se piden de a miles, aceptar una reserva casi
+* nunca implica llamar a malloc.
+******************************************************/
@@ -0,0 +1,109 @@
+#!/bin/sh
+# ******************************************************
+# Fecha: 11/11/2025
+# Pontificia Universidad Javeriana
+# Profesor: J. Corredor, PhD
+# Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+# Materia: Sistemas Operativos
+# Temas: Pruebas de rendimiento
+#
+# Descripción:
+# Este script corre los escenarios estandar de rendimiento: para cada
+# transporte, cada cantidad de hilos trabajadores y cada cantidad de
+# parques levanta un controlador,
+# lo somete a la carga del cargador con semilla fija y lo apaga con
+# SIGTERM. Cada escenario agrega una fila a bench/resultados.csv
+# (respuestas por segundo y percentiles de latencia del histograma) y al
+# final se genera bench/resultados.json con las mismas filas.
+#
+# Uso: ./bench.sh [-n agentes] [-m solicitudes] [-v ventana] [-e semilla]
+#                 [-x "fifo shm unix"] [-w "1 4"] [-a "1"] [-o directorio]
+# ******************************************************
+
+#Valores de los escenarios estandar
+AGENTES=200
+SOLICITUDES=500
+VENTANA=16
+SEMILLA=42
+TRANSPORTES="fifo shm unix"
+TRABAJADORES="1 4"
+PARQUES="1"
+DIRECTORIO=bench
+
+#Lee las opciones
+while [ $# -gt 1 ]; do
+    case "$1" in
+        -n) AGENTES=$2 ;;
+        -m) SOLICITUDES=$2 ;;
+        -v) VENTANA=$2 ;;
+        -e) SEMILLA=$2 ;;
+        -x) TRANSPORTES=$2 ;;
+        -w) TRABAJADORES=$2 ;;
+        -a) PARQUES=$2 ;;
+        -o) DIRECTORIO=$2 ;;
+        *) echo "Opcion desconocida: $1" >&2; exit 1 ;;
+    esac
+    shift 2
+done
+
+#Resultados nuevos en cada ejecucion
+mkdir -p "$DIRECTORIO"
+CSV="$DIRECTORIO/resultados.csv"
+JSON="$DIRECTORIO/resultados.json"
+rm -f "$CSV" "$JSON"
+
+for x in $TRANSPORTES; do
+    for w in $TRABAJADORES; do
+        for a in $PARQUES; do
+            #Todos los parques con el mismo aforo; la etiqueta solo lleva los parques si hay mas de uno
+            ESPEC=$(yes 1000000 | head -n "$a" | paste -sd, -)
+            ETIQUETA="${x}_w$w"
+            [ "$a" -gt 1 ] && ETIQUETA="${ETIQUETA}_a$a"
+            #Con sockets se usa un nombre abstracto para no dejar archivos
+            PIPE="bench_$$"
+            [ "$x" = unix ] && PIPE="@bench_$$"
+            echo "Escenario $x con $w trabajadores y $a parques..."
+            #Una hora simulada dura una hora real: el reloj no avanza durante la medicion
+            ./controlador -i 7 -f 19 -s 3600 -a "$ESPEC" -w "$w" -p "$PIPE" -x "$x" > /dev/null 2>&1 &
+            CONTROLADOR=$!
+            #Espera a que exista el canal del controlador
+            i=0
+            while [ $i -lt 50 ]; do
+                [ "$x" = fifo ] && [ -p "$PIPE" ] && break
+                [ "$x" = shm ] && [ -e "/dev/shm/$PIPE" ] && break
+                sleep 0.1
+                i=$((i + 1))
+                [ "$x" = unix ] && [ $i -ge 3 ] && break
+            done
+            ./cargador -p "$PIPE" -x "$x" -n "$AGENTES" -m "$SOLICITUDES" -v "$VENTANA" -e "$SEMILLA" \
+                -h pico -g zipf -a "$a" -l "$ETIQUETA" -r "$CSV" | tail -n 3
+            #SIGTERM y no SIGINT: un sh sin terminal lanza los procesos en segundo plano ignorando SIGINT
+            kill -TERM $CONTROLADOR
+            wait $CONTROLADOR
+        done
+    done
+done
+
+#Convierte las filas del CSV en un arreglo JSON; las dos primeras columnas son texto
+awk -F, '
+NR == 1 { for (i = 1; i <= NF; i++) campo[i] = $i; print "["; next }
+{
+    printf "%s  {", (NR > 2 ? ",\n" : "")
+    for (i = 1; i <= NF; i++) {
+        valor = (i <= 2) ? "\"" $i "\"" : $i
+        printf "%s\"%s\": %s", (i > 1 ? ", " : ""), campo[i], valor
+    }
+    printf "}"
+}
+END { print "\n]" }' "$CSV" > "$JSON"
+
+echo "Resultados en $CSV y $JSON"
+
+# ******************************************************
+# CONCLUSIÓN
+#
+# Con semilla, carga y escenarios fijos, dos ejecuciones del
+# script sobre el mismo equipo son comparables, asi que un
+# cambio que empeore el rendimiento o la latencia de algun
+# transporte se nota antes de llevarlo a produccion.
+# ******************************************************
@@ -0,0 +1,95 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto bitacora.h
+*
+* Descripción:
+* Este archivo define la bitacora del controlador: un registro binario
+* donde se anota cada cambio del estado del parque (agentes nuevos,
+* reservas, negaciones y avances del reloj) antes de responderle al
+* agente. Un solo hilo escribe los registros y los sincroniza con el
+* disco en grupo, y cada cierto tamano guarda un punto de control
+* compacto con todo el estado, asi recuperar el controlador despues de
+* una caida solo exige leer ese punto y la cola corta del registro.
+******************************************************/
+#ifndef BITACORA_H
+#define BITACORA_H
+
+#include <stdint.h> //Libreria para enteros de tamano fijo
+#include <stddef.h> //Libreria para size_t
+
+#include "protocolo.h" //MAX_NOMBRE
+
+#define LIMITE_BITACORA (1 << 20) //Bytes del registro despues de los cuales se guarda un punto de control
+#define TAM_INICIAL_BITACORA 65536 //Capacidad inicial de cada buffer de registros
+#define TAM_CABECERA_REGISTRO 8 //Tipo, longitud y suma de verificacion de cada registro
+#define MAX_CUERPO_REGISTRO 128 //Bytes maximos del cuerpo de un registro
+
+//Cambios del estado que se anotan
+typedef enum {
+    BIT_AGENTE = 1, //Agente nuevo: id y nombre
+    BIT_RESERVA = 2, //Reserva aceptada o reprogramada: codigo, minuto de inicio, personas, agente, id y familia
+    BIT_NEGADA = 3, //Solicitud o cambio negado (codigo dice el tipo de mensaje), solo cuenta en su parque
+    BIT_HORA = 4, //El reloj avanzo: minuto en que empieza la nueva franja actual
+    BIT_CONTADORES = 5, //Solo en los puntos de control: contadores de un parque y siguiente id de reserva
+    BIT_CANCELADA = 6, //Se cancelo la reserva con ese id
+    BIT_MODIFICADA = 7 //La reserva con ese id paso a otro minuto de inicio o a otra cantidad de personas
+} TipoRegistro;
+
+typedef struct {
+    int tipo; //Uno de TipoRegistro
+    int codigo; //BIT_RESERVA: RESP_OK o RESP_REPROGRAMADA; BIT_NEGADA: MSG_SOLICITUD, MSG_CANCELAR o MSG_MODIFICAR
+    int minuto; //BIT_RESERVA y BIT_MODIFICADA: inicio; BIT_HORA: instante actual. Minutos desde las 00:00 del dia 0
+    int personas; //BIT_RESERVA y BIT_MODIFICADA: tamano del grupo
+    uint32_t agente; //BIT_AGENTE y BIT_RESERVA: id del agente
+    uint32_t reserva; //BIT_RESERVA, BIT_CANCELADA y BIT_MODIFICADA: id de la reserva; BIT_CONTADORES: siguiente id
+    int aceptadas, reprogramadas, negadas; //BIT_CONTADORES
+    int canceladas, modificadas, cambios_negados; //BIT_CONTADORES
+    int parque; //Todos menos BIT_AGENTE y BIT_HORA: parque al que pertenece el cambio
+    char nombre[MAX_NOMBRE]; //Familia de la reserva o nombre del agente
+} RegistroBitacora;
+
+//Registros codificados uno tras otro, crece duplicando su tamano
+typedef struct {
+    uint8_t* datos;
+    size_t largo; //Bytes usados
+    size_t capacidad; //Bytes reservados
+} BufferBitacora;
+
+// Escribe en el buffer todo el estado actual; se llama con el estado congelado (nadie dentro de bitacora_entrar)
+typedef void (*EscribirEstado)(BufferBitacora* b);
+// Aplica al estado un registro leido del disco
+typedef void (*AplicarRegistro)(const RegistroBitacora* r);
+
+// Codifica el registro al final del buffer, retorna 0 o -1 si no hay memoria o no cabe
+int bitacora_poner(BufferBitacora* b, const RegistroBitacora* r);
+// Aplica el punto de control de base y luego la cola del registro que lo sigue
+//Deja en generacion la mayor encontrada (0 si no habia nada) y retorna los registros aplicados, o -1 si hubo un error de lectura
+long bitacora_recuperar(const char* base, AplicarRegistro aplicar, uint64_t* generacion);
+// Guarda un punto de control con generacion, abre un registro nuevo y lanza el hilo que escribe; retorna 0 o -1
+int bitacora_iniciar(const char* base, uint64_t generacion, EscribirEstado estado);
+// Marcan una seccion que cambia el estado y anota sus registros; un punto de control espera a que no haya ninguna
+void bitacora_entrar(void);
+void bitacora_salir(void);
+// Anota un registro (dentro de una seccion) y retorna la posicion que hay que esperar, 0 si no hay bitacora
+uint64_t bitacora_anotar(const RegistroBitacora* r);
+// Espera a que todo lo anotado hasta la posicion este sincronizado con el disco
+void bitacora_esperar(uint64_t posicion);
+// Registros anotados, sincronizaciones con el disco y puntos de control guardados
+void bitacora_resumen(uint64_t* registros, uint64_t* sincronizaciones, uint64_t* puntos);
+// Escribe lo pendiente, guarda un ultimo punto de control y detiene el hilo
+void bitacora_cerrar(void);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con la bitacora una caida del controlador ya no borra el
+* parque: lo que se le confirmo a un agente esta en disco, y
+* como los puntos de control acotan el registro, recuperar
+* tarda lo mismo a las 8 que a las 19.
+******************************************************/
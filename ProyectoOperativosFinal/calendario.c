@@ -0,0 +1,83 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto calendario.c
+*
+* Descripción:
+* Este archivo implementa las conversiones entre minutos, franjas, dias y
+* posiciones de la ventana. Son solo divisiones y residuos enteros, por
+* lo que los trabajadores pueden llamarlas sin cerrojos en cada decision.
+******************************************************/
+#include "calendario.h"
+
+// Valida y guarda la configuracion; ventana 0 usa todos los dias que quepan. Retorna 0 o -1 si no es valida
+int calendario_configurar(Calendario* c, int minutos_franja, int apertura, int cierre, int dias, int ventana) {
+    if (minutos_franja < 1 || 60 % minutos_franja != 0) return -1; //Cada hora tiene un numero entero de franjas
+    if (apertura < 0 || cierre > 23 || apertura > cierre || dias < 1 || dias > MAX_DIAS || ventana < 0) return -1;
+    c->minutos_franja = minutos_franja;
+    c->hora_apertura = apertura;
+    c->hora_cierre = cierre;
+    c->franjas_dia = (cierre - apertura + 1) * 60 / minutos_franja;
+    c->dias = dias;
+    if (ventana == 0) { //Sin -v: todos los dias de la simulacion, hasta donde alcance el tope de franjas
+        ventana = dias < MAX_DIAS_VENTANA ? dias : MAX_DIAS_VENTANA;
+        while (ventana > 1 && ventana * c->franjas_dia > MAX_FRANJAS_VENTANA) ventana--;
+    }
+    if (ventana > dias) ventana = dias; //Mas dias que los simulados nunca se usarian
+    if (ventana > MAX_DIAS_VENTANA || ventana * c->franjas_dia > MAX_FRANJAS_VENTANA) return -1;
+    c->dias_ventana = ventana;
+    return 0;
+}
+
+// Franja (contada desde la primera del dia 0) que contiene el minuto, o -1 si cae fuera del horario del dia
+int calendario_franja(const Calendario* c, int minuto) {
+    if (minuto < 0) return -1;
+    int dia = minuto / MINUTOS_DIA;
+    int f = calendario_franja_del_dia(c, minuto % MINUTOS_DIA);
+    if (f < 0 || f >= c->franjas_dia) return -1;
+    return dia * c->franjas_dia + f;
+}
+
+// Minuto, contado desde las 00:00 del dia 0, en que empieza una franja
+int calendario_minuto(const Calendario* c, int franja) {
+    int dia = franja / c->franjas_dia;
+    return dia * MINUTOS_DIA + c->hora_apertura * 60 + (franja % c->franjas_dia) * c->minutos_franja;
+}
+
+// Dia al que pertenece una franja
+int calendario_dia(const Calendario* c, int franja) {
+    return franja / c->franjas_dia;
+}
+
+// Posicion de una franja en el arreglo circular de la ventana; las franjas de un mismo dia quedan seguidas
+int calendario_posicion(const Calendario* c, int franja) {
+    return franja % (c->franjas_dia * c->dias_ventana);
+}
+
+// Franja del dia (0 es la de la hora de apertura) en que empieza el minuto indicado de ese dia
+int calendario_franja_del_dia(const Calendario* c, int minuto_del_dia) {
+    int desde_apertura = minuto_del_dia - c->hora_apertura * 60;
+    if (desde_apertura < 0) return -1;
+    return desde_apertura / c->minutos_franja; //Un minuto a mitad de franja queda en la franja que lo contiene
+}
+
+// Franjas que ocupan esos minutos, redondeando hacia arriba
+int calendario_largo(const Calendario* c, int minutos) {
+    return (minutos + c->minutos_franja - 1) / c->minutos_franja;
+}
+
+// Franjas totales de la simulacion: cuando el reloj llega a esta, termina
+int calendario_total(const Calendario* c) {
+    return c->dias * c->franjas_dia;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Toda la aritmetica del calendario queda en un solo lugar,
+* asi el resto del controlador trabaja con franjas enteras
+* sin repetir en cada funcion como se cuentan las horas.
+******************************************************/
@@ -0,0 +1,61 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto calendario.h
+*
+* Descripción:
+* Este archivo define el calendario del controlador: cada dia se divide
+* en franjas de unos cuantos minutos entre la hora de apertura y la de
+* cierre, y las franjas de todos los dias se numeran seguidas. Cada
+* parque guarda solo una ventana de dias en un arreglo circular; cuando
+* un dia termina, su lugar se recicla para el dia que entra al final de
+* la ventana, asi la memoria depende de la ventana y no de cuantos dias
+* se simulen.
+******************************************************/
+#ifndef CALENDARIO_H
+#define CALENDARIO_H
+
+#include "protocolo.h" //MINUTOS_DIA y MAX_DIAS
+
+#define MAX_DIAS_VENTANA 62 //Dias maximos que guarda cada parque a la vez
+#define MAX_FRANJAS_VENTANA 65536 //Franjas maximas de la ventana de un parque (franjas del dia por dias)
+
+typedef struct {
+    int minutos_franja; //Minutos de cada franja (-m), divide a 60
+    int hora_apertura; //Primera hora de cada dia (-i)
+    int hora_cierre; //Ultima hora de cada dia (-f): el dia termina cuando ella termina
+    int franjas_dia; //Franjas de un dia
+    int dias; //Dias que dura la simulacion (-d)
+    int dias_ventana; //Dias que guarda cada parque a la vez (-v)
+} Calendario;
+
+// Valida y guarda la configuracion; ventana 0 usa todos los dias que quepan. Retorna 0 o -1 si no es valida
+int calendario_configurar(Calendario* c, int minutos_franja, int apertura, int cierre, int dias, int ventana);
+// Franja (contada desde la primera del dia 0) que contiene el minuto, o -1 si cae fuera del horario del dia
+int calendario_franja(const Calendario* c, int minuto);
+// Minuto, contado desde las 00:00 del dia 0, en que empieza una franja
+int calendario_minuto(const Calendario* c, int franja);
+// Dia al que pertenece una franja
+int calendario_dia(const Calendario* c, int franja);
+// Posicion de una franja en el arreglo circular de la ventana; las franjas de un mismo dia quedan seguidas
+int calendario_posicion(const Calendario* c, int franja);
+// Franja del dia (0 es la de la hora de apertura) en que empieza el minuto indicado de ese dia
+int calendario_franja_del_dia(const Calendario* c, int minuto_del_dia);
+// Franjas que ocupan esos minutos, redondeando hacia arriba
+int calendario_largo(const Calendario* c, int minutos);
+// Franjas totales de la simulacion: cuando el reloj llega a esta, termina
+int calendario_total(const Calendario* c);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con las franjas numeradas de corrido, una reserva de
+* cualquier dia es un rango de enteros, y la ventana
+* circular permite aceptar reservas con semanas de
+* anticipacion sin que la memoria crezca con los dias.
+******************************************************/
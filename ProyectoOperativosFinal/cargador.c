@@ -0,0 +1,51 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto cargador.c
+*
+* Descripción:
+* Este archivo implementa el programa principal del generador de carga.
+* Lee las opciones, lanza los agentes virtuales contra un controlador que
+* ya esta corriendo y, cuando todos terminan, muestra el resumen de
+* respuestas y tiempos y guarda el detalle de cada solicitud si se pidio.
+******************************************************/
+
+#include <signal.h> // Libreria para manejo de senales
+
+#include "cargador_funciones.h"
+
+int main(int argc, char* argv[]) {
+    ConfigCarga cfg; //Opciones de la carga
+    parsear_argumentos_carga(argc, argv, &cfg);
+    //Si el controlador termina antes, write retorna EPIPE en vez de matar al cargador
+    signal(SIGPIPE, SIG_IGN);
+
+    AgenteVirtual* agentes = calloc((size_t)cfg.agentes, sizeof(AgenteVirtual));
+    if (!agentes) {
+        perror("calloc agentes");
+        exit(1);
+    }
+    preparar_carga(&cfg); //Distribuciones y canal hacia el controlador
+    uint64_t duracion = ejecutar_carga(agentes); //Registra a todos y envia la carga
+    ResultadoCarga resultado;
+    resumir_carga(agentes, duracion, &resultado); //Histograma de latencias y contadores
+    imprimir_resumen_carga(&resultado);
+    if (cfg.archivo_resultados[0] != '\0' && guardar_resultado(&resultado, cfg.archivo_resultados) == -1)
+        perror("guardar_resultado");
+    if (cfg.archivo_tiempos[0] != '\0' && guardar_tiempos(agentes, cfg.archivo_tiempos) == -1)
+        perror("guardar_tiempos");
+    terminar_carga(agentes);
+    free(agentes);
+    return 0;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con un solo comando se puede someter al controlador a la
+* carga de miles de agentes y obtener el tiempo de respuesta
+* de cada solicitud, sin abrir una terminal por agente.
+******************************************************/
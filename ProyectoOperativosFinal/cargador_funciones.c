@@ -0,0 +1,491 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto cargador_funciones.c
+*
+* Descripción:
+* Este archivo implementa el generador de carga. Cada agente virtual es
+* un hilo que crea su pipe (o anillo, o conexion), se registra ante el
+* controlador igual que un agente real y luego envia sus solicitudes
+* manteniendo una ventana de solicitudes sin respuesta. Todos los
+* agentes empiezan a enviar al mismo tiempo despues de registrarse, y
+* cada respuesta se empareja con su solicitud por el id de la trama para
+* medir su tiempo de respuesta.
+******************************************************/
+
+#include "cargador_funciones.h" //Donde se encuentran los prototipos
+
+static ConfigCarga cfg; //Copia de la configuracion que leen todos los hilos
+static double acumulada_grupos[MAX_PERSONAS_CARGA]; //Probabilidad acumulada de cada tamano con Zipf
+static int fd_entrada = -1; //Con -x fifo, pipe del controlador compartido por todos los hilos
+static AnilloShm* anillo_controlador = NULL; //Con -x shm, anillo de solicitudes compartido por todos los hilos
+static pthread_barrier_t salida; //Los agentes empiezan a enviar juntos cuando todos se registraron
+static Histograma latencias; //Tiempos de respuesta de todas las solicitudes, se llena al final
+
+//Tiempo monotonico en nanosegundos
+static uint64_t ahora_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+//Generador xorshift64*: cada agente tiene el suyo, asi una semilla reproduce la misma carga
+static uint64_t siguiente_azar(uint64_t* estado) {
+    uint64_t x = *estado;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *estado = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+//Numero uniforme en [0, 1)
+static double azar_unitario(uint64_t* estado) {
+    return (double)(siguiente_azar(estado) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//Hora de una solicitud; nunca antes de hora_registro, la hora en que el agente se registro si es el mismo dia
+static int generar_hora(AgenteVirtual* a, int hora_registro) {
+    int desde = hora_registro > cfg.hora_min ? hora_registro : cfg.hora_min;
+    if (desde > cfg.hora_max) return desde; //Ya no quedan horas: el controlador la va a negar
+    int rango = cfg.hora_max - desde + 1;
+    if (cfg.dist_horas == HORAS_PICO) {
+        //Triangular centrada en la hora pico; lo que cae fuera del rango se vuelve a sortear
+        int ancho = cfg.hora_pico - desde > cfg.hora_max - cfg.hora_pico ? cfg.hora_pico - desde : cfg.hora_max - cfg.hora_pico;
+        if (ancho < 0) ancho = -ancho;
+        for (int intento = 0; intento < 64; intento++) {
+            double d = azar_unitario(&a->estado_azar) - azar_unitario(&a->estado_azar);
+            int h = cfg.hora_pico + (int)floor(d * (ancho + 1) + 0.5);
+            if (h >= desde && h <= cfg.hora_max) return h;
+        }
+    }
+    return desde + (int)(siguiente_azar(&a->estado_azar) % (uint64_t)rango);
+}
+
+//Instante pedido en minutos: un dia entre el del registro y los -j siguientes, una hora del rango y minutos en pasos de -u
+//Con un solo dia y horas en punto no se sortea nada extra, asi una semilla genera la misma carga que antes
+static int generar_inicio(AgenteVirtual* a) {
+    int dia_registro = a->hora_actual / MINUTOS_DIA;
+    int dia = dia_registro;
+    if (cfg.jornadas > 1) dia += (int)(siguiente_azar(&a->estado_azar) % (uint64_t)cfg.jornadas);
+    int hora = generar_hora(a, dia == dia_registro ? a->hora_actual % MINUTOS_DIA / 60 : 0);
+    int minutos = 0;
+    if (cfg.paso_minutos < 60) minutos = (int)(siguiente_azar(&a->estado_azar) % (uint64_t)(60 / cfg.paso_minutos)) * cfg.paso_minutos;
+    return dia * MINUTOS_DIA + hora * 60 + minutos;
+}
+
+//Tamano del grupo de una solicitud
+static int generar_personas(AgenteVirtual* a) {
+    if (cfg.dist_grupos == GRUPOS_UNIFORME)
+        return 1 + (int)(siguiente_azar(&a->estado_azar) % (uint64_t)cfg.max_personas);
+    double u = azar_unitario(&a->estado_azar);
+    int bajo = 0, alto = cfg.max_personas - 1; //Busca el primer tamano cuya acumulada supera u
+    while (bajo < alto) {
+        int medio = (bajo + alto) / 2;
+        if (acumulada_grupos[medio] < u) bajo = medio + 1;
+        else alto = medio;
+    }
+    return bajo + 1;
+}
+
+//Envia una trama al controlador por el canal del transporte elegido
+static int enviar_trama_virtual(AgenteVirtual* a, const uint8_t* trama, int len) {
+    if (cfg.transporte == TRANSPORTE_UNIX) return escribir_trama(a->fd_conexion, trama, len);
+    if (cfg.transporte == TRANSPORTE_FIFO) return escribir_trama(fd_entrada, trama, len); //Menos de PIPE_BUF: atomico entre hilos
+    while (anillo_meter(anillo_controlador, trama, len) == -1) { //Varios hilos producen en el mismo anillo
+        if (errno != EAGAIN) return -1;
+        struct timespec espera = { 0, 50000 }; //Deja que el controlador libere ranuras
+        nanosleep(&espera, NULL);
+    }
+    return 0;
+}
+
+//Espera la siguiente trama del controlador, retorna 1 si llego o 0 si el canal se cerro
+static int esperar_trama_virtual(AgenteVirtual* a, CabeceraTrama* cab, const uint8_t** cuerpo) {
+    if (cfg.transporte == TRANSPORTE_SHM) {
+        for (;;) {
+            if (a->frente_pendiente) anillo_avanzar(a->anillo); //Devuelve la ranura de la trama anterior
+            const uint8_t* trama;
+            int len = anillo_esperar(a->anillo, &trama);
+            a->frente_pendiente = len > 0;
+            if (len == 0) return 0;
+            if (trama_abrir(trama, (size_t)len, cab, cuerpo) == 1) return 1;
+        }
+    }
+    int fd = cfg.transporte == TRANSPORTE_UNIX ? a->fd_conexion : a->fd_propio;
+    for (;;) {
+        int r = lector_siguiente(a->lector, cab, cuerpo);
+        if (r == 1) return 1;
+        if (lector_llenar(a->lector, fd) <= 0) return 0;
+    }
+}
+
+//Crea el canal de respuestas del agente virtual, se registra y espera su hora y su id
+static int registrar_virtual(AgenteVirtual* a) {
+    if (cfg.transporte == TRANSPORTE_UNIX) {
+        a->fd_conexion = unix_conectar(cfg.pipe_entrada);
+        if (a->fd_conexion == -1) return -1;
+    } else if (cfg.transporte == TRANSPORTE_SHM) {
+        a->anillo = anillo_crear(a->pipe_propio, RANURAS_RESPUESTA);
+        if (!a->anillo) return -1;
+    } else {
+        if (mkfifo(a->pipe_propio, 0666) == -1 && errno != EEXIST) return -1;
+        //Igual que el agente: abre la lectura sin bloquear y deja su propio extremo de escritura
+        a->fd_propio = open(a->pipe_propio, O_RDONLY | O_NONBLOCK);
+        if (a->fd_propio == -1) return -1;
+        a->fd_escritura_propia = open(a->pipe_propio, O_WRONLY);
+        if (a->fd_escritura_propia == -1) return -1;
+        fcntl(a->fd_propio, F_SETFL, fcntl(a->fd_propio, F_GETFL) & ~O_NONBLOCK);
+    }
+    MsgRegistro reg;
+    strcpy(reg.nombre, a->nombre);
+    strcpy(reg.pipe_respuesta, a->pipe_propio);
+    uint8_t trama[MAX_TRAMA];
+    int len = codificar_registro(trama, 0, &reg);
+    if (len < 0 || enviar_trama_virtual(a, trama, len) == -1) return -1;
+    CabeceraTrama cab;
+    const uint8_t* cuerpo;
+    if (!esperar_trama_virtual(a, &cab, &cuerpo) || cab.tipo != MSG_HORA ||
+        decodificar_hora(cuerpo, cab.longitud, &a->hora_actual, &a->id_agente) == -1)
+        return -1;
+    return 0;
+}
+
+//Guarda la respuesta de la solicitud con ese id, retorna 1 si era una solicitud pendiente
+static int registrar_respuesta(AgenteVirtual* a, uint32_t id, const MsgRespuesta* resp, uint64_t llegada) {
+    if (id == 0 || id > (uint32_t)a->enviadas) return 0; //El id es la posicion de la solicitud + 1
+    MedicionCarga* m = &a->mediciones[id - 1];
+    if (m->codigo != 0) return 0; //Repetida
+    m->codigo = (uint8_t)resp->codigo;
+    m->inicio_asignado = (uint32_t)resp->inicio;
+    m->latencia_ns = llegada - m->enviada_ns;
+    a->respondidas++;
+    return 1;
+}
+
+//Envia todas las solicitudes del agente virtual sin pasar de la ventana y mide cada respuesta
+static void enviar_carga(AgenteVirtual* a) {
+    int pendientes = 0;
+    uint8_t trama[MAX_TRAMA];
+    CabeceraTrama cab;
+    const uint8_t* cuerpo;
+    MsgRespuesta resps[MAX_LOTE];
+    uint32_t ids[MAX_LOTE];
+    int fin_enviado = 0; //1 cuando ya se aviso que no hay mas solicitudes
+    while (a->enviadas < cfg.solicitudes || pendientes > 0) {
+        while (a->enviadas < cfg.solicitudes && pendientes < cfg.ventana) {
+            MsgSolicitud sol;
+            sol.inicio = generar_inicio(a);
+            sol.personas = generar_personas(a);
+            sol.id_agente = a->id_agente;
+            sol.parque = cfg.parques > 1 ? (int)(siguiente_azar(&a->estado_azar) % (uint64_t)cfg.parques) : 0;
+            snprintf(sol.familia, sizeof(sol.familia), "%.30sF%d", a->nombre, a->enviadas + 1);
+            MedicionCarga* m = &a->mediciones[a->enviadas];
+            m->inicio = (uint32_t)sol.inicio;
+            m->personas = (uint16_t)sol.personas;
+            int len = codificar_solicitud(trama, (uint32_t)a->enviadas + 1, &sol);
+            m->enviada_ns = ahora_ns();
+            if (len < 0 || enviar_trama_virtual(a, trama, len) == -1) return; //El controlador ya no recibe
+            a->enviadas++;
+            pendientes++;
+            if (cfg.pausa_ms > 0) {
+                struct timespec pausa = { cfg.pausa_ms / 1000, (cfg.pausa_ms % 1000) * 1000000L };
+                nanosleep(&pausa, NULL);
+            }
+        }
+        if (!fin_enviado && a->enviadas == cfg.solicitudes) { //Con reloj virtual el controlador espera este aviso
+            int len = codificar_fin_solicitudes(trama, a->id_agente);
+            if (enviar_trama_virtual(a, trama, len) == -1) return;
+            fin_enviado = 1;
+        }
+        if (!esperar_trama_virtual(a, &cab, &cuerpo) || cab.tipo == MSG_TERMINAR) return;
+        uint64_t llegada = ahora_ns();
+        if (cab.tipo == MSG_RESPUESTA && decodificar_respuesta(cuerpo, cab.longitud, &resps[0]) == 0) {
+            pendientes -= registrar_respuesta(a, cab.id_solicitud, &resps[0], llegada);
+        } else if (cab.tipo == MSG_RESPUESTA_LOTE) {
+            int n = decodificar_respuesta_lote(cuerpo, cab.longitud, resps, ids);
+            for (int i = 0; i < n; i++) pendientes -= registrar_respuesta(a, ids[i], &resps[i], llegada);
+        }
+    }
+}
+
+//Cierra y borra el canal de respuestas del agente virtual
+static void cerrar_virtual(AgenteVirtual* a) {
+    if (a->fd_conexion != -1) close(a->fd_conexion);
+    if (a->anillo) {
+        anillo_cerrar(a->anillo);
+        anillo_liberar(a->anillo);
+        anillo_borrar(a->pipe_propio);
+    }
+    if (a->fd_propio != -1) close(a->fd_propio);
+    if (a->fd_escritura_propia != -1) close(a->fd_escritura_propia);
+    if (cfg.transporte == TRANSPORTE_FIFO) unlink(a->pipe_propio);
+}
+
+//Hilo de un agente virtual: se registra, espera a los demas y envia su carga
+static void* agente_virtual(void* arg) {
+    AgenteVirtual* a = (AgenteVirtual*)arg;
+    a->registrado = registrar_virtual(a) == 0;
+    if (!a->registrado) fprintf(stderr, "Error: el agente virtual %s no se pudo registrar.\n", a->nombre);
+    pthread_barrier_wait(&salida);
+    if (a->registrado) enviar_carga(a);
+    cerrar_virtual(a);
+    return NULL;
+}
+
+//Lee un entero positivo de la opcion o termina con un mensaje de error
+static int numero_opcion(const char* texto, const char* opcion) {
+    char* fin;
+    long v = strtol(texto, &fin, 10);
+    if (*fin != '\0' || v < 0 || v > 1000000000L) {
+        fprintf(stderr, "Error: valor invalido para %s: %s\n", opcion, texto);
+        exit(1);
+    }
+    return (int)v;
+}
+
+// Lee las opciones del cargador y valida sus rangos
+void parsear_argumentos_carga(int argc, char* argv[], ConfigCarga* c) {
+    memset(c, 0, sizeof(*c));
+    strcpy(c->prefijo, "V");
+    strcpy(c->etiqueta, "carga");
+    c->transporte = TRANSPORTE_FIFO;
+    c->agentes = 100;
+    c->solicitudes = 10;
+    c->ventana = 1;
+    c->hora_min = 7;
+    c->hora_max = 18;
+    c->hora_pico = 12;
+    c->jornadas = 1;
+    c->paso_minutos = 60;
+    c->exponente_zipf = 1.0;
+    c->max_personas = 10;
+    c->parques = 1;
+    c->semilla = 1;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) { fprintf(stderr, "Error: falta el valor de %s.\n", argv[i]); exit(1); }
+        const char* v = argv[i + 1];
+        if (strcmp(argv[i], "-p") == 0) snprintf(c->pipe_entrada, sizeof(c->pipe_entrada), "%s", v); //Canal del controlador
+        else if (strcmp(argv[i], "-s") == 0) snprintf(c->prefijo, 20, "%s", v); //Prefijo de los nombres
+        else if (strcmp(argv[i], "-x") == 0) c->transporte = transporte_desde_texto(v); //fifo, shm o unix
+        else if (strcmp(argv[i], "-n") == 0) c->agentes = numero_opcion(v, "-n"); //Agentes virtuales
+        else if (strcmp(argv[i], "-m") == 0) c->solicitudes = numero_opcion(v, "-m"); //Solicitudes por agente
+        else if (strcmp(argv[i], "-v") == 0) c->ventana = numero_opcion(v, "-v"); //Solicitudes en vuelo
+        else if (strcmp(argv[i], "-d") == 0) c->pausa_ms = numero_opcion(v, "-d"); //Pausa entre envios
+        else if (strcmp(argv[i], "-i") == 0) c->hora_min = numero_opcion(v, "-i"); //Primera hora pedida
+        else if (strcmp(argv[i], "-f") == 0) c->hora_max = numero_opcion(v, "-f"); //Ultima hora pedida
+        else if (strcmp(argv[i], "-c") == 0) c->hora_pico = numero_opcion(v, "-c"); //Hora pico
+        else if (strcmp(argv[i], "-j") == 0) c->jornadas = numero_opcion(v, "-j"); //Dias entre los que se reparten
+        else if (strcmp(argv[i], "-u") == 0) c->paso_minutos = numero_opcion(v, "-u"); //Paso de los minutos pedidos
+        else if (strcmp(argv[i], "-k") == 0) c->max_personas = numero_opcion(v, "-k"); //Grupo mas grande
+        else if (strcmp(argv[i], "-a") == 0) c->parques = numero_opcion(v, "-a"); //Parques del controlador
+        else if (strcmp(argv[i], "-z") == 0) c->exponente_zipf = atof(v); //Exponente de Zipf
+        else if (strcmp(argv[i], "-e") == 0) c->semilla = strtoull(v, NULL, 10); //Semilla
+        else if (strcmp(argv[i], "-l") == 0) snprintf(c->etiqueta, sizeof(c->etiqueta), "%s", v); //Etiqueta del resultado
+        else if (strcmp(argv[i], "-r") == 0) snprintf(c->archivo_resultados, sizeof(c->archivo_resultados), "%s", v); //CSV de resultados
+        else if (strcmp(argv[i], "-o") == 0) snprintf(c->archivo_tiempos, sizeof(c->archivo_tiempos), "%s", v); //CSV de tiempos
+        else if (strcmp(argv[i], "-h") == 0) { //Distribucion de horas
+            if (strcmp(v, "uniforme") == 0) c->dist_horas = HORAS_UNIFORME;
+            else if (strcmp(v, "pico") == 0) c->dist_horas = HORAS_PICO;
+            else { fprintf(stderr, "Error: -h debe ser uniforme o pico.\n"); exit(1); }
+        } else if (strcmp(argv[i], "-g") == 0) { //Distribucion de tamanos de grupo
+            if (strcmp(v, "uniforme") == 0) c->dist_grupos = GRUPOS_UNIFORME;
+            else if (strcmp(v, "zipf") == 0) c->dist_grupos = GRUPOS_ZIPF;
+            else { fprintf(stderr, "Error: -g debe ser uniforme o zipf.\n"); exit(1); }
+        } else {
+            fprintf(stderr, "Error: opcion desconocida %s.\n", argv[i]);
+            exit(1);
+        }
+        i++;
+    }
+    if (strlen(c->pipe_entrada) == 0) {
+        fprintf(stderr, "Error: faltan parámetros.\n");
+        exit(1);
+    }
+    if (c->transporte == -1) {
+        fprintf(stderr, "Error: el transporte debe ser fifo, shm o unix.\n");
+        exit(1);
+    }
+    if (c->agentes < 1 || c->agentes > MAX_VIRTUALES || c->solicitudes < 1 ||
+        c->ventana < 1 || c->ventana > MAX_VENTANA_CARGA) {
+        fprintf(stderr, "Error: -n debe estar entre 1 y %d, -m ser positivo y -v estar entre 1 y %d.\n",
+                MAX_VIRTUALES, MAX_VENTANA_CARGA);
+        exit(1);
+    }
+    if (c->hora_min > c->hora_max || c->hora_max > 23 || c->jornadas < 1 || c->jornadas > MAX_DIAS ||
+        c->paso_minutos < 1 || 60 % c->paso_minutos != 0 || c->max_personas < 1 ||
+        c->max_personas > MAX_PERSONAS_CARGA || c->exponente_zipf <= 0 || c->parques < 1 || c->parques > MAX_PARQUES) {
+        fprintf(stderr, "Error: rango de horas, dias, paso de minutos, tamano de grupo, exponente o parques invalidos.\n");
+        exit(1);
+    }
+}
+
+// Prepara las tablas de las distribuciones y abre el canal compartido hacia el controlador
+void preparar_carga(const ConfigCarga* c) {
+    cfg = *c;
+    //Zipf: la acumulada se calcula una sola vez y cada sorteo es una busqueda binaria
+    double total = 0;
+    for (int k = 1; k <= cfg.max_personas; k++) total += 1.0 / pow(k, cfg.exponente_zipf);
+    double suma = 0;
+    for (int k = 1; k <= cfg.max_personas; k++) {
+        suma += 1.0 / pow(k, cfg.exponente_zipf) / total;
+        acumulada_grupos[k - 1] = suma;
+    }
+    acumulada_grupos[cfg.max_personas - 1] = 1.0; //Evita que el redondeo deje un hueco al final
+
+    if (cfg.transporte == TRANSPORTE_FIFO) {
+        fd_entrada = open(cfg.pipe_entrada, O_WRONLY);
+        if (fd_entrada == -1) {
+            perror("open pipe_entrada");
+            exit(1);
+        }
+    } else if (cfg.transporte == TRANSPORTE_SHM) {
+        anillo_controlador = anillo_abrir(cfg.pipe_entrada);
+        if (!anillo_controlador) {
+            perror("anillo_abrir pipe_entrada");
+            exit(1);
+        }
+    }
+}
+
+// Lanza los agentes virtuales, espera a que terminen y retorna los nanosegundos que duro el envio
+uint64_t ejecutar_carga(AgenteVirtual* agentes) {
+    pthread_t* hilos = malloc(sizeof(pthread_t) * (size_t)cfg.agentes);
+    if (!hilos) {
+        perror("malloc hilos");
+        exit(1);
+    }
+    pthread_barrier_init(&salida, NULL, (unsigned)cfg.agentes + 1); //Los agentes y este hilo
+    pthread_attr_t atributos;
+    pthread_attr_init(&atributos);
+    pthread_attr_setstacksize(&atributos, PILA_VIRTUAL); //Miles de hilos no necesitan la pila por defecto
+    for (int i = 0; i < cfg.agentes; i++) {
+        AgenteVirtual* a = &agentes[i];
+        memset(a, 0, sizeof(*a));
+        a->indice = i;
+        snprintf(a->nombre, sizeof(a->nombre), "%.20s%d", cfg.prefijo, i + 1); //El prefijo ya viene acotado a 19 caracteres
+        snprintf(a->pipe_propio, sizeof(a->pipe_propio), "Pipe%.40s", a->nombre);
+        a->fd_propio = a->fd_escritura_propia = a->fd_conexion = -1;
+        a->estado_azar = (cfg.semilla + (uint64_t)i + 1) * 0x9E3779B97F4A7C15ULL; //Nunca queda en cero
+        if (a->estado_azar == 0) a->estado_azar = 1;
+        a->lector = malloc(sizeof(LectorTramas));
+        a->mediciones = calloc((size_t)cfg.solicitudes, sizeof(MedicionCarga));
+        if (!a->lector || !a->mediciones) {
+            perror("malloc agente virtual");
+            exit(1);
+        }
+        lector_iniciar(a->lector);
+        if (pthread_create(&hilos[i], &atributos, agente_virtual, a) != 0) {
+            perror("pthread_create agente virtual");
+            exit(1);
+        }
+    }
+    pthread_attr_destroy(&atributos);
+    pthread_barrier_wait(&salida); //Todos se registraron: empieza la medicion
+    uint64_t inicio = ahora_ns();
+    for (int i = 0; i < cfg.agentes; i++) pthread_join(hilos[i], NULL);
+    uint64_t duracion = ahora_ns() - inicio;
+    pthread_barrier_destroy(&salida);
+    free(hilos);
+    return duracion;
+}
+
+// Junta las mediciones de todos los agentes en un resultado con el histograma de latencias
+void resumir_carga(const AgenteVirtual* agentes, uint64_t duracion_ns, ResultadoCarga* r) {
+    memset(r, 0, sizeof(*r));
+    histograma_iniciar(&latencias);
+    for (int i = 0; i < cfg.agentes; i++) {
+        r->registrados += agentes[i].registrado;
+        r->enviadas += agentes[i].enviadas;
+        r->respondidas += agentes[i].respondidas;
+        for (int j = 0; j < agentes[i].enviadas; j++) {
+            const MedicionCarga* m = &agentes[i].mediciones[j];
+            if (m->codigo == 0) continue; //Sin respuesta
+            if (m->codigo <= RESP_OCUPADO) r->por_codigo[m->codigo]++;
+            histograma_registrar(&latencias, m->latencia_ns);
+        }
+    }
+    r->duracion_s = duracion_ns / 1e9;
+    r->rendimiento = r->duracion_s > 0 ? r->respondidas / r->duracion_s : 0;
+    r->latencias = &latencias;
+}
+
+// Muestra el resumen de respuestas, rendimiento y percentiles de latencia
+void imprimir_resumen_carga(const ResultadoCarga* r) {
+    printf("\n=== RESUMEN DE CARGA ===\n");
+    printf("Agentes virtuales registrados: %d de %d\n", r->registrados, cfg.agentes);
+    printf("Solicitudes enviadas: %ld, respondidas: %ld, sin respuesta: %ld\n",
+           r->enviadas, r->respondidas, r->enviadas - r->respondidas);
+    printf("OK: %ld, REPROGRAMADA: %ld, NEGADA_EXT: %ld, NEGADA: %ld\n", r->por_codigo[RESP_OK],
+           r->por_codigo[RESP_REPROGRAMADA], r->por_codigo[RESP_NEGADA_EXT], r->por_codigo[RESP_NEGADA]);
+    if (r->por_codigo[RESP_OCUPADO] > 0) //Con -q en el controlador: rechazadas sin decidir, no se reintentan
+        printf("OCUPADO: %ld\n", r->por_codigo[RESP_OCUPADO]);
+    printf("Duracion: %.3f s, rendimiento: %.0f respuestas/s\n", r->duracion_s, r->rendimiento);
+    if (r->latencias->total > 0) {
+        const Histograma* h = r->latencias;
+        printf("Latencia (us): min %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+               h->minimo / 1e3, histograma_percentil(h, 50) / 1e3, histograma_percentil(h, 90) / 1e3,
+               histograma_percentil(h, 99) / 1e3, histograma_percentil(h, 99.9) / 1e3, h->maximo / 1e3);
+    }
+}
+
+// Agrega una fila con el resultado al CSV de resultados, con encabezado si el archivo esta vacio
+int guardar_resultado(const ResultadoCarga* r, const char* archivo) {
+    FILE* f = fopen(archivo, "a");
+    if (!f) return -1;
+    const Histograma* h = r->latencias;
+    if (ftell(f) == 0)
+        fprintf(f, "etiqueta,transporte,agentes,solicitudes,ventana,semilla,enviadas,respondidas,"
+                   "duracion_s,respuestas_s,min_us,p50_us,p90_us,p99_us,p999_us,max_us\n");
+    const char* transportes[] = { "fifo", "shm", "unix" };
+    fprintf(f, "%s,%s,%d,%d,%d,%llu,%ld,%ld,%.6f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+            cfg.etiqueta, transportes[cfg.transporte], cfg.agentes, cfg.solicitudes, cfg.ventana,
+            (unsigned long long)cfg.semilla, r->enviadas, r->respondidas, r->duracion_s, r->rendimiento,
+            h->total ? h->minimo / 1e3 : 0.0, histograma_percentil(h, 50) / 1e3, histograma_percentil(h, 90) / 1e3,
+            histograma_percentil(h, 99) / 1e3, histograma_percentil(h, 99.9) / 1e3, h->maximo / 1e3);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// Escribe el CSV con el tiempo de cada solicitud, retorna 0 o -1 si no pudo
+int guardar_tiempos(const AgenteVirtual* agentes, const char* archivo) {
+    FILE* f = fopen(archivo, "w");
+    if (!f) return -1;
+    fprintf(f, "agente,solicitud,hora,personas,respuesta,hora_asignada,latencia_us\n");
+    for (int i = 0; i < cfg.agentes; i++) {
+        for (int j = 0; j < agentes[i].enviadas; j++) {
+            const MedicionCarga* m = &agentes[i].mediciones[j];
+            char pedida[TAM_INSTANTE], asignada[TAM_INSTANTE];
+            texto_instante((int)m->inicio, pedida, sizeof(pedida));
+            texto_instante((int)m->inicio_asignado, asignada, sizeof(asignada));
+            if (m->codigo == 0) //Se envio pero no llego respuesta antes de terminar
+                fprintf(f, "%s,%d,%s,%d,SIN_RESPUESTA,,\n", agentes[i].nombre, j + 1, pedida, m->personas);
+            else
+                fprintf(f, "%s,%d,%s,%d,%s,%s,%.1f\n", agentes[i].nombre, j + 1, pedida, m->personas,
+                        nombre_respuesta(m->codigo), asignada, m->latencia_ns / 1e3);
+        }
+    }
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+// Cierra el canal compartido y libera la memoria de los agentes
+void terminar_carga(AgenteVirtual* agentes) {
+    if (fd_entrada != -1) close(fd_entrada);
+    if (anillo_controlador) anillo_liberar(anillo_controlador);
+    for (int i = 0; i < cfg.agentes; i++) {
+        free(agentes[i].lector);
+        free(agentes[i].mediciones);
+    }
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* El cargador reemplaza decenas de terminales con agentes
+* reales por un solo comando reproducible: la misma semilla
+* genera exactamente las mismas familias, horas y grupos, y
+* como todos los agentes salen juntos despues de registrarse,
+* el tiempo medido corresponde solo al envio de solicitudes.
+******************************************************/
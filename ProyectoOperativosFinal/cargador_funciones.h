@@ -0,0 +1,143 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto cargador_funciones.h
+*
+* Descripción:
+* Este archivo define la configuracion, las estructuras y los prototipos
+* del generador de carga. El cargador simula desde un solo proceso
+* muchos agentes virtuales, cada uno en su propio hilo, que se registran
+* y envian solicitudes al controlador con el mismo protocolo que el
+* agente. Las familias, horas y tamanos de grupo salen de distribuciones
+* configurables y cada respuesta queda medida desde que su solicitud se
+* envio.
+******************************************************/
+#ifndef CARGADOR_FUNCIONES_H
+#define CARGADOR_FUNCIONES_H
+
+#include <stdio.h> //Libreria para mostrar informacion por pantalla
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <string.h> //libreria para cadenas de caracteres
+#include <unistd.h> //Libreria para funciones relacionadas con posix
+#include <fcntl.h> // Libreria para constantes y flags para open
+#include <sys/stat.h> //Libreria para archivos y permisos
+#include <sys/types.h> //Libreria para syscalls
+#include <errno.h> //Libreria para manejo de errores
+#include <pthread.h> // Libreria para los hilos de los agentes virtuales
+#include <time.h> //Libreria para clock_gettime
+#include <math.h> //Libreria para pow, floor y ceil
+
+#include "histograma.h" //Histograma de latencias
+#include "protocolo.h" //Formato de las tramas y MAX_NOMBRE
+#include "transporte_shm.h" //Anillos en memoria compartida para -x shm
+#include "transporte_unix.h" //Conexion SOCK_SEQPACKET para -x unix
+
+#define MAX_VIRTUALES 8192 //Agentes virtuales maximos, los mismos que acepta el controlador
+#define MAX_VENTANA_CARGA 64 //Solicitudes en vuelo por agente virtual (64 tramas caben en su pipe)
+#define MAX_PERSONAS_CARGA 1000 //Tamano maximo de grupo que se puede generar
+#define PILA_VIRTUAL (256 * 1024) //Pila de cada hilo; el lector de tramas va en memoria dinamica
+
+//Como se reparten las horas pedidas
+typedef enum {
+    HORAS_UNIFORME = 0, //Todas las horas del rango con la misma probabilidad
+    HORAS_PICO = 1 //Triangular alrededor de la hora pico
+} DistribucionHoras;
+
+//Como se reparten los tamanos de grupo
+typedef enum {
+    GRUPOS_UNIFORME = 0, //De 1 a max_personas con la misma probabilidad
+    GRUPOS_ZIPF = 1 //P(k) proporcional a 1/k^s: muchos grupos pequenos y pocos grandes
+} DistribucionGrupos;
+
+typedef struct {
+    char pipe_entrada[MAX_NOMBRE]; //Pipe, anillo o socket del controlador (-p)
+    char prefijo[MAX_NOMBRE]; //Prefijo del nombre de cada agente virtual (-s)
+    int transporte; //TRANSPORTE_FIFO, TRANSPORTE_SHM o TRANSPORTE_UNIX (-x)
+    int agentes; //Agentes virtuales (-n)
+    int solicitudes; //Solicitudes por agente (-m)
+    int ventana; //Solicitudes sin respuesta por agente (-v)
+    long pausa_ms; //Pausa entre envios de cada agente (-d)
+    int hora_min, hora_max; //Rango de horas pedidas (-i, -f)
+    int dist_horas; //DistribucionHoras (-h)
+    int hora_pico; //Centro de la distribucion pico (-c)
+    int jornadas; //Dias, desde el del registro, entre los que se reparten las solicitudes (-j)
+    int paso_minutos; //Los minutos pedidos son multiplos de este paso, 60 pide horas en punto (-u)
+    int dist_grupos; //DistribucionGrupos (-g)
+    double exponente_zipf; //Exponente s de Zipf (-z)
+    int max_personas; //Tamano maximo de grupo (-k)
+    int parques; //Parques entre los que se reparten las solicitudes (-a)
+    uint64_t semilla; //Semilla base, cada agente deriva la suya (-e)
+    char archivo_tiempos[256]; //CSV con el tiempo de cada solicitud, vacio si no se pide (-o)
+    char archivo_resultados[256]; //CSV al que se agrega una fila con el resultado, vacio si no se pide (-r)
+    char etiqueta[MAX_NOMBRE]; //Nombre del escenario en esa fila (-l)
+} ConfigCarga;
+
+//Lo que se mide de una solicitud
+typedef struct {
+    uint32_t inicio; //Minuto pedido
+    uint32_t inicio_asignado; //Minuto que devolvio el controlador
+    uint8_t codigo; //CodigoRespuesta, 0 mientras no llegue
+    uint16_t personas; //Tamano del grupo
+    uint64_t enviada_ns; //Momento del envio (CLOCK_MONOTONIC)
+    uint64_t latencia_ns; //Tiempo hasta la respuesta
+} MedicionCarga;
+
+typedef struct {
+    int indice; //Posicion del agente virtual
+    char nombre[MAX_NOMBRE]; //Nombre con el que se registra
+    char pipe_propio[MAX_NOMBRE]; //Su pipe o anillo de respuestas
+    uint32_t id_agente; //Id que le asigno el controlador
+    int hora_actual; //Instante, en minutos, que recibio al registrarse
+    int fd_propio; //Extremo de lectura de su pipe (-x fifo)
+    int fd_escritura_propia; //Extremo de escritura que deja abierto sobre su pipe (-x fifo)
+    int fd_conexion; //Su conexion con el controlador (-x unix)
+    AnilloShm* anillo; //Su anillo de respuestas (-x shm)
+    int frente_pendiente; //1 si la ultima trama sigue ocupando su ranura del anillo
+    LectorTramas* lector; //Bytes que llegan por el pipe o la conexion
+    uint64_t estado_azar; //Estado del generador de numeros de este agente
+    MedicionCarga* mediciones; //Una por solicitud; el id de la trama es su posicion + 1
+    int enviadas; //Solicitudes enviadas
+    int respondidas; //Respuestas recibidas
+    int registrado; //1 si el controlador lo acepto
+} AgenteVirtual;
+
+//Resultado de una ejecucion completa
+typedef struct {
+    int registrados; //Agentes que el controlador acepto
+    long enviadas, respondidas; //Solicitudes
+    long por_codigo[RESP_OCUPADO + 1]; //Respuestas por CodigoRespuesta
+    double duracion_s; //Desde que todos se registraron hasta la ultima respuesta
+    double rendimiento; //Respuestas por segundo
+    const Histograma* latencias; //Tiempo de respuesta de cada solicitud en nanosegundos
+} ResultadoCarga;
+
+// Lee las opciones del cargador y valida sus rangos
+void parsear_argumentos_carga(int argc, char* argv[], ConfigCarga* cfg);
+// Prepara las tablas de las distribuciones y abre el canal compartido hacia el controlador
+void preparar_carga(const ConfigCarga* cfg);
+// Lanza los agentes virtuales, espera a que terminen y retorna los nanosegundos que duro el envio
+uint64_t ejecutar_carga(AgenteVirtual* agentes);
+// Junta las mediciones de todos los agentes en un resultado con el histograma de latencias
+void resumir_carga(const AgenteVirtual* agentes, uint64_t duracion_ns, ResultadoCarga* r);
+// Muestra el resumen de respuestas, rendimiento y percentiles de latencia
+void imprimir_resumen_carga(const ResultadoCarga* r);
+// Agrega una fila con el resultado al CSV de resultados, retorna 0 o -1 si no pudo
+int guardar_resultado(const ResultadoCarga* r, const char* archivo);
+// Escribe el CSV con el tiempo de cada solicitud, retorna 0 o -1 si no pudo
+int guardar_tiempos(const AgenteVirtual* agentes, const char* archivo);
+// Cierra el canal compartido y libera la memoria de los agentes
+void terminar_carga(AgenteVirtual* agentes);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con estas definiciones un solo proceso puede producir la
+* carga de miles de agentes reales, con distribuciones y
+* semilla fijas, para reproducir localmente lo que se ve en
+* produccion y medir el tiempo de respuesta de cada solicitud.
+******************************************************/
@@ -0,0 +1,211 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto cola_solicitudes.c
+*
+* Descripción:
+* Este archivo implementa la cola de solicitudes como un monticulo
+* binario protegido por un mutex. Los trabajos quedan fijos en su
+* arreglo y el monticulo solo mueve turnos de pocos bytes. Cuando se
+* llena duplica su tamano, asi el hilo de eventos nunca se bloquea
+* esperando espacio.
+******************************************************/
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <string.h> //Libreria para memcpy
+#include <time.h> //Libreria para el reloj monotono de las esperas con limite
+#include <errno.h> //Libreria para reconocer ETIMEDOUT
+
+#include "cola_solicitudes.h"
+
+// Prepara una cola vacia que acepta hasta limite trabajos pendientes (0 sin limite)
+void cola_iniciar(ColaSolicitudes* c, int limite) {
+    c->items = malloc(sizeof(Trabajo) * CAPACIDAD_INICIAL_COLA);
+    c->turnos = malloc(sizeof(TurnoCola) * CAPACIDAD_INICIAL_COLA);
+    c->libres = malloc(sizeof(int) * CAPACIDAD_INICIAL_COLA);
+    c->capacidad = c->items && c->turnos && c->libres ? CAPACIDAD_INICIAL_COLA : 0;
+    for (int i = 0; i < c->capacidad; i++) c->libres[i] = c->capacidad - 1 - i; //Todas las posiciones libres
+    c->llegadas = 0;
+    c->cantidad = 0;
+    c->maximo = 0;
+    c->limite = limite;
+    c->cerrada = 0;
+    pthread_mutex_init(&c->cerrojo, NULL);
+    pthread_condattr_t atributos;
+    pthread_condattr_init(&atributos);
+    pthread_condattr_setclock(&atributos, CLOCK_MONOTONIC); //Los limites de cola_sacar_hasta son del reloj de las metricas
+    pthread_cond_init(&c->hay_trabajo, &atributos);
+    pthread_condattr_destroy(&atributos);
+}
+
+//Duplica la capacidad; los trabajos conservan su posicion y las nuevas quedan libres
+//Solo se llama con la cola llena, asi la pila de libres esta vacia
+static int crecer(ColaSolicitudes* c) {
+    int nueva_capacidad = c->capacidad > 0 ? c->capacidad * 2 : CAPACIDAD_INICIAL_COLA;
+    Trabajo* items = realloc(c->items, sizeof(Trabajo) * nueva_capacidad);
+    if (!items) return -1;
+    c->items = items;
+    TurnoCola* turnos = realloc(c->turnos, sizeof(TurnoCola) * nueva_capacidad);
+    if (!turnos) return -1;
+    c->turnos = turnos;
+    int* libres = realloc(c->libres, sizeof(int) * nueva_capacidad);
+    if (!libres) return -1;
+    c->libres = libres;
+    for (int i = 0; i < nueva_capacidad - c->capacidad; i++) c->libres[i] = nueva_capacidad - 1 - i;
+    c->capacidad = nueva_capacidad;
+    return 0;
+}
+
+//Copia un trabajo sin las posiciones que no usa de sus arreglos de MAX_LOTE: una solicitud sola mueve
+//unos cien bytes en lugar del trabajo completo
+static void copiar_trabajo(Trabajo* destino, const Trabajo* origen) {
+    destino->cantidad = origen->cantidad;
+    destino->lote = origen->lote;
+    destino->tipo = origen->tipo;
+    destino->id_agente = origen->id_agente;
+    destino->encolado_ns = origen->encolado_ns;
+    destino->plazo_ms = origen->plazo_ms;
+    destino->franja_llegada = origen->franja_llegada;
+    memcpy(destino->ids, origen->ids, sizeof(origen->ids[0]) * (size_t)origen->cantidad);
+    memcpy(destino->sol, origen->sol, sizeof(origen->sol[0]) * (size_t)origen->cantidad);
+}
+
+//1 si el turno a sale antes que el b
+static int antes(const TurnoCola* a, const TurnoCola* b) {
+    return a->turno < b->turno || (a->turno == b->turno && a->llegada < b->llegada);
+}
+
+//Sube el turno de la posicion i del monticulo hasta que su padre salga antes que el
+static void subir(ColaSolicitudes* c, int i) {
+    TurnoCola x = c->turnos[i];
+    while (i > 0 && antes(&x, &c->turnos[(i - 1) / 2])) {
+        c->turnos[i] = c->turnos[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    c->turnos[i] = x;
+}
+
+//Baja el turno de la posicion i del monticulo hasta que sus hijos salgan despues que el
+static void bajar(ColaSolicitudes* c, int i) {
+    TurnoCola x = c->turnos[i];
+    for (;;) {
+        int hijo = 2 * i + 1;
+        if (hijo >= c->cantidad) break;
+        if (hijo + 1 < c->cantidad && antes(&c->turnos[hijo + 1], &c->turnos[hijo])) hijo++;
+        if (!antes(&c->turnos[hijo], &x)) break;
+        c->turnos[i] = c->turnos[hijo];
+        i = hijo;
+    }
+    c->turnos[i] = x;
+}
+
+//Saca el trabajo de menor turno, se llama con el cerrojo tomado y la cola no vacia
+static void sacar_primero(ColaSolicitudes* c, Trabajo* t) {
+    int posicion = c->turnos[0].posicion;
+    copiar_trabajo(t, &c->items[posicion]);
+    c->libres[c->capacidad - c->cantidad] = posicion; //Su posicion vuelve a la pila de libres
+    c->cantidad--;
+    if (c->cantidad > 0) {
+        c->turnos[0] = c->turnos[c->cantidad];
+        bajar(c, 0);
+    }
+}
+
+// Agrega un trabajo con el turno que le da su plazo, retorna 0, COLA_LLENA si ya tiene su limite o -1 si esta cerrada o no hay memoria
+//El turno es el orden de llegada mas MAX_ADELANTO en proporcion al plazo dentro de HORIZONTE_URGENTE_MS: lo que esta
+//por pasar va delante de lo que llego antes con mas tiempo, lo que tiene tiempo sigue en orden de llegada entre si,
+//y lo que llega MAX_ADELANTO trabajos despues ya no pasa delante de nada
+int cola_meter(ColaSolicitudes* c, const Trabajo* t) {
+    pthread_mutex_lock(&c->cerrojo);
+    if (c->limite > 0 && c->cantidad >= c->limite && !c->cerrada) { //Saturada: se avisa en lugar de crecer sin fin
+        pthread_mutex_unlock(&c->cerrojo);
+        return COLA_LLENA;
+    }
+    if (c->cerrada || (c->cantidad == c->capacidad && crecer(c) == -1)) {
+        pthread_mutex_unlock(&c->cerrojo);
+        return -1;
+    }
+    int posicion = c->libres[c->capacidad - c->cantidad - 1];
+    copiar_trabajo(&c->items[posicion], t);
+    uint64_t adelanto = t->plazo_ms <= 0 ? 0
+                      : t->plazo_ms >= HORIZONTE_URGENTE_MS ? MAX_ADELANTO
+                      : (uint64_t)t->plazo_ms * MAX_ADELANTO / HORIZONTE_URGENTE_MS;
+    TurnoCola turno = { c->llegadas + adelanto, c->llegadas, posicion };
+    c->llegadas++;
+    c->turnos[c->cantidad] = turno;
+    c->cantidad++;
+    subir(c, c->cantidad - 1);
+    if (c->cantidad > c->maximo) c->maximo = c->cantidad;
+    pthread_cond_signal(&c->hay_trabajo); //Despierta a un trabajador
+    pthread_mutex_unlock(&c->cerrojo);
+    return 0;
+}
+
+// Espera el trabajo de menor turno y lo saca, retorna 0 o -1 si la cola se cerro y quedo vacia
+int cola_sacar(ColaSolicitudes* c, Trabajo* t) {
+    return cola_sacar_varios(c, t, 1) == 1 ? 0 : -1;
+}
+
+// Espera al menos un trabajo y saca hasta max en orden de turno, retorna cuantos saco o -1 si la cola se cerro y quedo vacia
+int cola_sacar_varios(ColaSolicitudes* c, Trabajo* t, int max) {
+    pthread_mutex_lock(&c->cerrojo);
+    while (c->cantidad == 0 && !c->cerrada)
+        pthread_cond_wait(&c->hay_trabajo, &c->cerrojo);
+    int n = c->cantidad < max ? c->cantidad : max; //Lo que haya, sin esperar a completar max
+    for (int i = 0; i < n; i++) sacar_primero(c, &t[i]);
+    pthread_mutex_unlock(&c->cerrojo);
+    return n > 0 ? n : -1;
+}
+
+// Sin esperar mas alla de limite_ns (CLOCK_MONOTONIC), junta hasta max trabajos, retorna cuantos saco (puede ser 0)
+//Espera mientras falten trabajos para completar max; al cerrarse la cola o vencerse el limite saca lo que haya
+int cola_sacar_hasta(ColaSolicitudes* c, Trabajo* t, int max, uint64_t limite_ns) {
+    struct timespec limite = { (time_t)(limite_ns / 1000000000ULL), (long)(limite_ns % 1000000000ULL) };
+    pthread_mutex_lock(&c->cerrojo);
+    while (c->cantidad < max && !c->cerrada)
+        if (pthread_cond_timedwait(&c->hay_trabajo, &c->cerrojo, &limite) == ETIMEDOUT) break;
+    int n = c->cantidad < max ? c->cantidad : max;
+    for (int i = 0; i < n; i++) sacar_primero(c, &t[i]);
+    pthread_mutex_unlock(&c->cerrojo);
+    return n;
+}
+
+// Deja en cantidad los trabajos pendientes y en maximo la mayor cantidad que tuvo
+void cola_profundidad(ColaSolicitudes* c, int* cantidad, int* maximo) {
+    pthread_mutex_lock(&c->cerrojo);
+    *cantidad = c->cantidad;
+    *maximo = c->maximo;
+    pthread_mutex_unlock(&c->cerrojo);
+}
+
+// Cierra la cola: los trabajadores terminan lo pendiente y salen
+void cola_cerrar(ColaSolicitudes* c) {
+    pthread_mutex_lock(&c->cerrojo);
+    c->cerrada = 1;
+    pthread_cond_broadcast(&c->hay_trabajo); //Despierta a todos para que salgan
+    pthread_mutex_unlock(&c->cerrojo);
+}
+
+// Libera la memoria de la cola
+void cola_destruir(ColaSolicitudes* c) {
+    free(c->items);
+    free(c->turnos);
+    free(c->libres);
+    c->items = NULL;
+    c->turnos = NULL;
+    c->libres = NULL;
+    c->capacidad = 0;
+    pthread_mutex_destroy(&c->cerrojo);
+    pthread_cond_destroy(&c->hay_trabajo);
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con un solo mutex y una variable de condicion la cola
+* reparte las solicitudes entre los trabajadores sin
+* perder ninguna, y al cerrarse deja que terminen todo lo
+* pendiente antes de que el controlador imprima el reporte.
+******************************************************/
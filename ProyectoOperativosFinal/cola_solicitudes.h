@@ -0,0 +1,93 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto cola_solicitudes.h
+*
+* Descripción:
+* Este archivo define la cola que comunica el hilo de eventos del
+* controlador con los hilos trabajadores. El hilo de eventos decodifica
+* las tramas y deja cada solicitud en la cola; los trabajadores las
+* sacan y deciden la reserva en paralelo. La cola puede tener un limite:
+* llegado a el no crece mas y quien encola se entera de inmediato. No se
+* saca solo en orden de llegada: lo que esta por quedar en el pasado pasa
+* adelante, sin que nada quede atras de demasiados que llegaron despues.
+******************************************************/
+#ifndef COLA_SOLICITUDES_H
+#define COLA_SOLICITUDES_H
+
+#include <pthread.h> // Libreria para mutex y variables de condicion
+#include <stdint.h> //Libreria para enteros de tamano fijo
+
+#include "protocolo.h" //MsgSolicitud y MAX_LOTE
+
+#define CAPACIDAD_INICIAL_COLA 256 //Espacios con los que arranca la cola, crece si se llena
+#define COLA_LLENA 1 //Lo que retorna cola_meter cuando la cola ya tiene su limite de trabajos
+#define HORIZONTE_URGENTE_MS 1000 //Trabajos cuya hora pasa antes de esto pasan adelante; los demas van en orden de llegada
+#define MAX_ADELANTO 4096 //Ningun trabajo queda detras de mas de esta cantidad de trabajos que llegaron despues
+
+//Solicitudes pendientes de decidir: una sola o un lote completo que se decide de una pasada
+typedef struct {
+    int cantidad; //Solicitudes en el trabajo (1 para MSG_SOLICITUD)
+    int lote; //1 si llego como MSG_SOLICITUD_LOTE y se responde con un solo MSG_RESPUESTA_LOTE
+    int tipo; //MSG_SOLICITUD (tambien en un lote), MSG_CANCELAR o MSG_MODIFICAR
+    uint32_t id_agente; //Agente al que se le responde
+    uint32_t ids[MAX_LOTE]; //Id que se devuelve en cada respuesta
+    MsgSolicitud sol[MAX_LOTE]; //Datos de cada solicitud
+    uint64_t encolado_ns; //Momento en que entro a la cola, para medir la espera
+    int plazo_ms; //Milisegundos hasta que pasa la hora mas cercana que pide, hasta HORIZONTE_URGENTE_MS; lo calcula quien encola
+    int franja_llegada; //Franja del reloj cuando se encolo
+} Trabajo;
+
+//Lugar de un trabajo en el monticulo: se saca primero el de menor turno y, entre iguales, el que llego antes
+typedef struct {
+    uint64_t turno; //Orden de llegada mas lo que puede esperar por su plazo, a lo sumo MAX_ADELANTO
+    uint64_t llegada; //Orden de llegada
+    int posicion; //Posicion del trabajo en items
+} TurnoCola;
+
+typedef struct {
+    Trabajo* items; //Trabajos pendientes, cada uno queda fijo en su posicion hasta que se saca
+    TurnoCola* turnos; //Monticulo binario de los trabajos pendientes, el menor turno en la posicion 0
+    int* libres; //Posiciones de items sin trabajo, usadas como pila
+    int capacidad; //Espacios de los tres arreglos
+    uint64_t llegadas; //Trabajos que se han encolado, da el orden de llegada
+    int cantidad; //Trabajos pendientes
+    int maximo; //Mayor cantidad de trabajos pendientes que tuvo
+    int limite; //Trabajos pendientes desde los que ya no se aceptan mas, 0 sin limite
+    int cerrada; //Si es 1 ya no se aceptan trabajos y los trabajadores salen al vaciarla
+    pthread_mutex_t cerrojo; //Protege todos los campos
+    pthread_cond_t hay_trabajo; //Despierta a los trabajadores
+} ColaSolicitudes;
+
+// Prepara una cola vacia que acepta hasta limite trabajos pendientes (0 sin limite)
+void cola_iniciar(ColaSolicitudes* c, int limite);
+// Agrega un trabajo con el turno que le da su plazo, retorna 0, COLA_LLENA si ya tiene su limite o -1 si esta cerrada o no hay memoria
+int cola_meter(ColaSolicitudes* c, const Trabajo* t);
+// Espera el trabajo de menor turno y lo saca, retorna 0 o -1 si la cola se cerro y quedo vacia
+int cola_sacar(ColaSolicitudes* c, Trabajo* t);
+// Espera al menos un trabajo y saca hasta max en orden de turno, retorna cuantos saco o -1 si la cola se cerro y quedo vacia
+int cola_sacar_varios(ColaSolicitudes* c, Trabajo* t, int max);
+// Sin esperar mas alla de limite_ns (CLOCK_MONOTONIC), junta hasta max trabajos, retorna cuantos saco (puede ser 0)
+int cola_sacar_hasta(ColaSolicitudes* c, Trabajo* t, int max, uint64_t limite_ns);
+// Deja en cantidad los trabajos pendientes y en maximo la mayor cantidad que tuvo
+void cola_profundidad(ColaSolicitudes* c, int* cantidad, int* maximo);
+// Cierra la cola: los trabajadores terminan lo pendiente y salen
+void cola_cerrar(ColaSolicitudes* c);
+// Libera la memoria de la cola
+void cola_destruir(ColaSolicitudes* c);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* La cola desacopla la lectura de los pipes de la logica
+* de reservas: el hilo de eventos nunca espera a que una
+* reserva se decida y varios trabajadores pueden decidir
+* solicitudes de distintos agentes al mismo tiempo. Con el
+* monticulo, una solicitud cuya franja esta por pasar no
+* espera detras de una rafaga para la tarde.
+******************************************************/
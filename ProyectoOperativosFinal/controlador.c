@@ -10,11 +10,11 @@
 *
 * Este archivo implementa el programa principal del controlador del
 * sistema de reservas. Aquí se procesan los argumentos recibidos por
-* línea de comandos, se inicializan las estructuras del parque, se crea
+* línea de comandos, se inicializan las estructuras de los parques, se crea
 * el pipe de comunicación y se configuran las variables globales que
-* serán utilizadas durante toda la simulación. Además, se lanzan los
-* hilos encargados del reloj y de la gestión de solicitudes, coordinando
-* su ejecución mediante la sincronización correspondiente. Este módulo
+* serán utilizadas durante toda la simulación. Además, se prepara el
+* bucle de eventos que atiende en un solo hilo las solicitudes, el
+* temporizador del reloj y las señales de apagado. Este módulo
 * actúa como punto de inicio y núcleo organizador del sistema,
 * asegurando que todos los componentes funcionen de manera integrada.
 ******************************************************/
@@ -33,71 +33,134 @@
 
 #include "controlador_funciones.h"
 //Variables globales
-//Indica la hora actual, la de inicio y fin con las que se obtiene el tiempo transcurrido
-//La cantidad de segundos de las horas simuladas y el maximo de personas
-int hora_actual, hora_inicio, hora_fin, seg_por_hora, aforo_max;
+//La hora de inicio y fin de cada dia
+//La cantidad de segundos de las horas simuladas y el maximo de personas del parque por defecto (-t)
+int hora_inicio, hora_fin, aforo_max;
+Calendario calendario; //Se configura con -i, -f, -m, -d y -v
+atomic_int franja_actual; //La avanza el hilo de eventos y la leen los trabajadores
+double seg_por_hora; //Segundos reales por hora simulada, admite valores como 0.5
+int reloj_virtual = 0; //Con -s virtual el reloj no depende del tiempo real
+int agentes_esperados = 1; //Con reloj virtual, el primer avance espera a que se registren estos agentes
 char pipe_entrada[MAX_NOMBRE]; //Nombre del pipe
-HoraParque parque[MAX_HORAS]; //Estructura que tiene la informacion de las horas
+Parque parques[MAX_PARQUES]; //Cada parque con sus franjas, su indice, sus reservas y su cola
+int num_parques = 0; //Se llena con -a; sin -a hay un solo parque con el aforo de -t
 int fd_pipe_entrada; //Descriptor del pipe
+int transporte = TRANSPORTE_FIFO; //Por defecto se usan pipes
+AnilloShm* anillo_entrada = NULL; //Solo se crea con -x shm
 
-int solicitudes_aceptadas = 0; //Cuenta cuantas solicitudes han sido aprobadas
-int solicitudes_reprogramadas = 0; //Cuenta cuantas solicitudes han sido reprogramadas
-int solicitudes_negadas = 0; //Cuenta cuantas solicitudes han sido negadas
+int num_trabajadores = 0; //Hilos que deciden reservas, por defecto uno por nucleo con un parque y uno por parque con varios
 
 Agente agentes[MAX_AGENTES]; //Lista de los agentes
-int num_agentes = 0; //Guarda cuantos agentes estan conectados
-
-pthread_t hilo_reloj, hilo_gestor; //Identifica los hilos que va a usar
-volatile int simulacion_terminada = 0; //Indica el fin de la simulacion
+atomic_int num_agentes = 0; //Guarda cuantos agentes estan conectados, lo leen tambien las estadisticas
+char archivo_estadisticas[256] = ""; //Solo se escribe con -e
+char archivo_bitacora[256] = ""; //Solo se anota con -b
+int recuperar = 0; //Con -r se parte del estado guardado en la bitacora
+int admision_ms = 0; //Sin -l cada solicitud se decide apenas un trabajador la saca
+int limite_cola = 0; //Sin -q las colas de los parques crecen sin limite
 
 int main(int argc, char* argv[]) {
     //Revisa los argumentos recibidos
+    const char* texto_parques = NULL; //Lista de -a, se lee cuando ya se conoce el horario del dia
+    int minutos_franja = 60, dias = 1, dias_ventana = 0; //Por defecto un solo dia en franjas de una hora
+    int nivel = NIVEL_SOLICITUDES; //Por defecto se muestra lo mismo de siempre
     int i = 1;
     while (i < argc) {
         if (strcmp(argv[i], "-i") == 0) { i++; hora_inicio = atoi(argv[i]); } //Hora inicial
         else if (strcmp(argv[i], "-f") == 0) { i++; hora_fin = atoi(argv[i]); } //Hora final
-        else if (strcmp(argv[i], "-s") == 0) { i++; seg_por_hora = atoi(argv[i]); } //Segundos por hora
+        else if (strcmp(argv[i], "-s") == 0) { //Segundos por hora, o "virtual"
+            i++;
+            if (strcmp(argv[i], "virtual") == 0) reloj_virtual = 1;
+            else seg_por_hora = atof(argv[i]);
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) { i++; agentes_esperados = atoi(argv[i]); } //Agentes del reloj virtual
         else if (strcmp(argv[i], "-t") == 0) { i++; aforo_max = atoi(argv[i]); } //Aforo maximo
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) { i++; texto_parques = argv[i]; } //Parques
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) { i++; minutos_franja = atoi(argv[i]); } //Minutos por franja
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) { i++; dias = atoi(argv[i]); } //Dias simulados
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) { i++; dias_ventana = atoi(argv[i]); } //Dias de la ventana
         else if (strcmp(argv[i], "-p") == 0) { i++; strcpy(pipe_entrada, argv[i]); } //Nombre del pipe
+        else if (strcmp(argv[i], "-w") == 0) { i++; num_trabajadores = atoi(argv[i]); } //Hilos trabajadores
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) { i++; transporte = transporte_desde_texto(argv[i]); } //fifo, shm o unix
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) { i++; snprintf(archivo_estadisticas, sizeof(archivo_estadisticas), "%s", argv[i]); } //Archivo de estadisticas
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) { i++; snprintf(archivo_bitacora, sizeof(archivo_bitacora), "%s", argv[i]); } //Bitacora
+        else if (strcmp(argv[i], "-r") == 0) { recuperar = 1; } //Recuperar desde la bitacora
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) { i++; admision_ms = atoi(argv[i]); } //Ventana de admision
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) { i++; nivel = atoi(argv[i]); } //Nivel de detalle del diario
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) { i++; limite_cola = atoi(argv[i]); } //Limite de cada cola
         i++;
     }
-    //Verifica que las horas si sean en horarios de atencion y valores positivos
-    if (hora_inicio < 7 || hora_inicio > 19 || hora_fin < 7 || hora_fin > 19 ||
-        hora_inicio > hora_fin || seg_por_hora <= 0 || aforo_max <= 0) {
+    //Verifica que el calendario y los horarios de los parques sean validos y los demas valores positivos
+    int calendario_invalido = calendario_configurar(&calendario, minutos_franja, hora_inicio, hora_fin, dias, dias_ventana) == -1;
+    int parques_invalidos = !calendario_invalido && texto_parques && configurar_parques(texto_parques) == -1;
+    if (calendario_invalido || (!reloj_virtual && seg_por_hora < MIN_SEG_POR_HORA) ||
+        parques_invalidos || (num_parques == 0 && aforo_max <= 0) || //Sin -a hace falta el aforo de -t
+        agentes_esperados < 1 || agentes_esperados > MAX_AGENTES ||
+        num_trabajadores < 0 || num_trabajadores > MAX_TRABAJADORES || transporte == -1 ||
+        admision_ms < 0 || admision_ms > MAX_ADMISION_MS || limite_cola < 0 || nivel < NIVEL_SILENCIO || nivel > NIVEL_DECISIONES ||
+        (recuperar && archivo_bitacora[0] == '\0')) { //Para recuperar hay que saber de que bitacora
         fprintf(stderr, "Error: parámetros inválidos.\n");
         exit(1);
     }
-
-    hora_actual = hora_inicio; //Obtiene la hora actual
-    //Inicializa las variables
-    for (int h = 7; h <= 19; h++) {
-        parque[h].hora = h; //Asigna la hora
-        parque[h].ocupacion = 0; //Inicializa la ocupacion en 0
-        parque[h].num_reservas = 0; //Inicializa las reservas en 0
+    if (num_parques == 0) { //Sin -a: un solo parque con el aforo de -t, abierto todo el dia de -i a -f
+        parques[0] = (Parque){ .aforo = aforo_max, .apertura = hora_inicio, .cierre = hora_fin };
+        num_parques = 1;
     }
-
-    if (mkfifo(pipe_entrada, 0666) == -1 && errno != EEXIST) {
-        perror("mkfifo pipe_entrada"); //Muestra un error si no puede crear el fifo
-        exit(1);
+    if (num_trabajadores == 0 && num_parques == 1) { //Si no se indico, un trabajador por nucleo disponible
+        long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+        num_trabajadores = nucleos < 1 ? 1 : nucleos > MAX_TRABAJADORES ? MAX_TRABAJADORES : (int)nucleos;
     }
-
-    fd_pipe_entrada = open(pipe_entrada, O_RDONLY);
-    if (fd_pipe_entrada == -1) {
-        perror("open pipe_entrada"); //Muestra un error si no puede abrir el pipe
+    if (num_trabajadores < num_parques) num_trabajadores = num_parques; //Cada parque tiene al menos un trabajador propio
+    if (metricas_iniciar(num_trabajadores + 1) == -1) { //Contadores del hilo de eventos y de cada trabajador
+        perror("metricas_iniciar");
         exit(1);
     }
 
-    if (pthread_create(&hilo_reloj, NULL, reloj, NULL) != 0) {
-        perror("pthread_create reloj"); //Crea el hilo que va cambiando la hora
-        exit(1);
-    }
-    if (pthread_create(&hilo_gestor, NULL, gestor_solicitudes, NULL) != 0) {
-        perror("pthread_create gestor"); //Crea el hilo que maneja las solicitudes
-        exit(1);
+    franja_actual = 0; //La primera franja del dia 0, a la hora de -i
+    iniciar_parques(); //Franjas, dias, indice, reservas y cola de cada parque
+    if (recuperar) recuperar_estado(); //Reservas, agentes, contadores y reloj de antes de la caida
+
+    //Si un agente termina, write retorna EPIPE en lugar de matar al controlador
+    signal(SIGPIPE, SIG_IGN);
+
+    if (transporte == TRANSPORTE_UNIX) {
+        //Con sockets el nombre de -p es el del socket de escucha ('@nombre' para uno abstracto)
+        fd_pipe_entrada = unix_escuchar(pipe_entrada);
+        if (fd_pipe_entrada == -1) {
+            perror("unix_escuchar pipe_entrada");
+            exit(1);
+        }
+    } else if (transporte == TRANSPORTE_SHM) {
+        //Con memoria compartida el nombre de -p es el del anillo de solicitudes
+        anillo_entrada = anillo_crear(pipe_entrada, RANURAS_ENTRADA);
+        if (!anillo_entrada) {
+            perror("anillo_crear pipe_entrada");
+            exit(1);
+        }
+        //El vigia del anillo marca este eventfd y el epoll lo atiende como si fuera el pipe
+        fd_pipe_entrada = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd_pipe_entrada == -1) {
+            perror("eventfd");
+            exit(1);
+        }
+    } else {
+        if (mkfifo(pipe_entrada, 0666) == -1 && errno != EEXIST) {
+            perror("mkfifo pipe_entrada"); //Muestra un error si no puede crear el fifo
+            exit(1);
+        }
+        //Se abre sin bloquear para no esperar a que llegue el primer agente
+        fd_pipe_entrada = open(pipe_entrada, O_RDONLY | O_NONBLOCK);
+        if (fd_pipe_entrada == -1) {
+            perror("open pipe_entrada"); //Muestra un error si no puede abrir el pipe
+            exit(1);
+        }
     }
 
-    pthread_join(hilo_reloj, NULL); //Espera a que el hilo de las horas termine
-    pthread_join(hilo_gestor, NULL); //Espera a que el hilo que maneja las solicitudes termine
+    iniciar_diario(nivel); //Desde aqui lo que se muestra mientras corre pasa por el escritor del diario
+    iniciar_eventos(); //Prepara el epoll con el pipe, el reloj y las senales
+    iniciar_bitacora(); //Con -b, desde aqui cada cambio del parque queda en disco
+    iniciar_trabajadores(); //Lanza los hilos que deciden las reservas
+    iniciar_estadisticas(); //Con -e, reescribe el archivo de estadisticas cada segundo
+    bucle_eventos(); //Atiende todo hasta que termine la simulacion
 
     return 0;
 }
@@ -108,17 +171,16 @@ int main(int argc, char* argv[]) {
 * Este archivo cumple el rol fundamental de manejar la
 * simulación completa del sistema de reservas. Desde la
 * lectura y validación de parámetros hasta la inicialización
-* del parque y la creación de los hilos, su función es
+* del parque y el arranque del bucle de eventos, su función es
 * garantizar que todos los elementos del proyecto operen en
 * coherencia.
 *
 * La correcta configuración del entorno, incluyendo pipes,
-* estructuras de horas, límites de aforo y tiempos de 
+* el calendario de franjas, límites de aforo y tiempos de 
 * simulación, permite que los módulos de gestión y reloj
-* trabajen de manera estable y sincronizada. Además, la
-* creación de hilos independientes asegura concurrencia real,
-* permitiendo que el controlador responda dinámicamente a las
-* solicitudes de los agentes.
+* trabajen de manera estable y sincronizada. Además, el
+* bucle de eventos permite que el controlador responda de
+* inmediato a las solicitudes de los agentes y al apagado.
 *
 * Finalmente, este archivo establece la base operativa
 * necesaria para que el sistema funcione de manera ordenada,
@@ -14,267 +14,2032 @@
 * aforo del parque en tiempo real. También incluye la generación del
 * reporte final, el cierre ordenado de los agentes y la limpieza de los
 * recursos del sistema. Este módulo constituye el núcleo operativo de la
-* simulación, coordinando la interacción entre hilos, pipes y estructuras
-* de datos.
+* simulación, coordinando en un solo bucle de eventos (epoll) el pipe
+* de entrada, el temporizador del reloj y las señales de apagado.
 ******************************************************/
 #include "controlador_funciones.h"
 
-// Funcion ejecutada por el hilo que controla el avance del reloj
-void* reloj(void* arg) {
-    (void)arg;
-    while (hora_actual <= hora_fin) { //Bucle hasta que la hora pase de la del fin
-        sleep(seg_por_hora); //Que pase una hora simulada
-        avanzar_hora(); //Actualiza las rservas y si esta ocupado
+static int fd_epoll = -1; //Descriptor del epoll que agrupa todas las fuentes de eventos
+static int fd_reloj = -1; //timerfd que marca cada franja simulada
+static uint64_t ns_por_franja = 0; //Periodo de fd_reloj
+static uint64_t proximo_tic_ns = 0; //Cuando vence fd_reloj otra vez (CLOCK_MONOTONIC), lo lleva el hilo de eventos
+static int fd_senales = -1; //signalfd para SIGINT y SIGTERM
+static int fd_decididas = -1; //eventfd con que un trabajador despierta al hilo de eventos: nada por decidir, un cierre o respuestas guardadas
+static int fd_reintento = -1; //timerfd armado mientras haya respuestas guardadas para un canal sin descriptor que vigilar
+static int agentes_sin_fin = 0; //Agentes registrados que aun pueden enviar solicitudes, solo lo usa el hilo de eventos
+static atomic_int hay_cierres = 0; //1 si algun agente tiene cierre_sin_contar; evita recorrerlos en cada vuelta
+static atomic_int hay_pendientes = 0; //1 si algun agente tiene vigilar_pedido
+static int fd_escritura_entrada = -1; //Extremo de escritura propio para que el pipe nunca quede sin escritores
+static pthread_t hilo_vigia; //Con -x shm, duerme en el futex del anillo de entrada y marca fd_pipe_entrada
+static VigiaAnillo vigia; //Argumento del hilo vigia
+//Con -x unix, que hay en cada descriptor: SIN_CONEXION, CONEXION_SIN_REGISTRO o el id del agente
+static int conexiones[MAX_DESCRIPTORES];
+#define SIN_CONEXION -2
+#define CONEXION_SIN_REGISTRO -1
+//Con -x fifo, agente del pipe de respuestas en cada descriptor que se vigila con EPOLLOUT
+static int escritores[MAX_DESCRIPTORES];
+
+static pthread_t hilo_estadisticas; //Con -e, reescribe el archivo de estadisticas
+static int fin_estadisticas = 0; //1 cuando el hilo de estadisticas debe salir
+static pthread_mutex_t cerrojo_estadisticas = PTHREAD_MUTEX_INITIALIZER; //Protege fin_estadisticas
+static pthread_cond_t aviso_estadisticas; //Despierta al hilo de estadisticas antes de tiempo para que salga
+static Histograma histograma_etapa; //Donde se juntan los contadores de una etapa al mostrarla
+static uint64_t generacion_recuperada = 0; //Generacion de la bitacora de la que se recupero, la nueva es la siguiente
+static atomic_int solicitudes_sin_parque = 0; //Solicitudes para un parque que no existe, se niegan en el hilo de eventos
+static int primer_dia_ventana = 0; //Dia mas antiguo que guardan las ventanas, solo lo cambia el hilo de eventos
+static atomic_long ventanas_admision = 0; //Con -l, veces que un trabajador decidio un grupo de solicitudes juntas
+static atomic_long solicitudes_admision = 0; //Con -l, solicitudes decididas en esos grupos
+static atomic_long consultas_disponibilidad = 0; //Consultas respondidas, solo las suma el hilo de eventos
+static atomic_long lecturas_repetidas = 0; //Veces que una consulta se cruzo con un cambio de ocupacion y volvio a leer
+static atomic_long solicitudes_ocupado = 0; //Con -q, solicitudes que no se encolaron porque la cola de su parque estaba llena
+static atomic_long vencidas_en_cola = 0; //Solicitudes a tiempo al encolarse cuya hora ya habia pasado al decidirlas
+
+static void cerrar_agente(Agente* agente);
+static void abandonar_agente(Agente* agente);
+static void contar_cierres(void);
+static void vigilar_pendientes(void);
+static void escribir_pendientes(int fd);
+static void reintentar_pendientes(void);
+static int vaciar_agente(Agente* agente);
+static void avisar(const char* formato, ...);
+static void cerrar_conexion(int fd);
+static int reprogramar(Parque* p, Reserva* r, int desde, int pedida);
+static void imprimir_horas(FILE* f, Parque* p, int dia);
+static int agregar_agente(const char* nombre);
+
+// Lee la lista de parques de -a ("aforo[:apertura-cierre],..."), retorna 0 o -1 si no es valida
+//Un parque sin horario abre todo el dia del calendario (de -i a -f)
+int configurar_parques(const char* texto) {
+    num_parques = 0;
+    const char* c = texto;
+    for (;;) {
+        if (num_parques == MAX_PARQUES) return -1;
+        Parque* p = &parques[num_parques];
+        char* fin;
+        p->aforo = (int)strtol(c, &fin, 10);
+        p->apertura = calendario.hora_apertura;
+        p->cierre = calendario.hora_cierre;
+        if (fin == c || p->aforo <= 0) return -1;
+        c = fin;
+        if (*c == ':') { //Horario propio
+            p->apertura = (int)strtol(c + 1, &fin, 10);
+            if (fin == c + 1 || *fin != '-') return -1;
+            c = fin + 1;
+            p->cierre = (int)strtol(c, &fin, 10);
+            if (fin == c) return -1;
+            c = fin;
+        }
+        if (p->apertura < calendario.hora_apertura || p->cierre > calendario.hora_cierre || p->apertura >= p->cierre) return -1;
+        num_parques++;
+        if (*c == '\0') return 0;
+        if (*c++ != ',') return -1;
+    }
+}
+
+// Prepara las franjas, los dias, el indice y la cola de cada parque y le reparte los trabajadores
+//El trabajador i atiende el parque i % num_parques, asi cada parque tiene al menos uno propio
+//La ventana empieza con los dias 0 a dias_ventana - 1; la memoria depende de la ventana y no de los dias simulados
+void iniciar_parques(void) {
+    int franjas = calendario.franjas_dia * calendario.dias_ventana;
+    for (int k = 0; k < num_parques; k++) {
+        Parque* p = &parques[k];
+        p->id = k;
+        p->hilos = num_trabajadores / num_parques + (k < num_trabajadores % num_parques);
+        p->primera = calendario_franja_del_dia(&calendario, p->apertura * 60);
+        p->ultima = calendario_franja_del_dia(&calendario, (p->cierre + 1) * 60) - 1;
+        p->franjas = calloc((size_t)franjas, sizeof(FranjaParque)); //Ocupacion en 0 y listas vacias
+        p->dias = calloc((size_t)calendario.dias_ventana, sizeof(DiaParque));
+        if (!p->franjas || !p->dias || indice_crear(&p->indice, franjas) == -1) { //Indice en cero sobre toda la ventana
+            perror("iniciar_parques");
+            exit(1);
+        }
+        for (int f = 0; f < franjas; f++)
+            pthread_mutex_init(&p->franjas[f].cerrojo, NULL); //Cerrojo propio de cada franja
+        for (int d = 0; d < calendario.dias_ventana; d++) {
+            p->dias[d].dia = d;
+            almacen_iniciar(&p->dias[d].almacen); //Tabla de reservas vacia
+        }
+        if (tabla_iniciar(&p->reservas) == -1) { //Tabla de ids vacia
+            perror("iniciar_parques");
+            exit(1);
+        }
+        cola_iniciar(&p->cola, limite_cola); //Cola entre el hilo de eventos y los trabajadores del parque, con el limite de -q
+        p->en_curso = 0;
+        p->aceptadas = p->reprogramadas = p->negadas = 0;
+        p->canceladas = p->modificadas = p->cambios_negados = 0;
+        p->siguiente_reserva = 1; //El id 0 es SIN_ID_RESERVA
+        p->escrituras_empezadas = p->escrituras_terminadas = 0;
+    }
+}
+
+//Franja de la ventana de un parque que guarda una franja del calendario
+static FranjaParque* franja_en(Parque* p, int franja) {
+    return &p->franjas[calendario_posicion(&calendario, franja)];
+}
+
+//Dia de la ventana de un parque al que pertenece una franja del calendario
+static DiaParque* dia_en(Parque* p, int franja) {
+    return &p->dias[calendario_dia(&calendario, franja) % calendario.dias_ventana];
+}
+
+//Franjas que dura cada reserva
+static int largo_reserva(void) {
+    return calendario_largo(&calendario, DURACION_RESERVA);
+}
+
+//Vacia un dia que ya paso y deja su lugar de la ventana al dia que esta dias_ventana despues
+//Toma los cerrojos de todas sus franjas en orden ascendente, como una reserva, asi ninguna queda a medias
+static void reciclar_dia(Parque* p, int dia) {
+    int desde = calendario_posicion(&calendario, dia * calendario.franjas_dia);
+    int hasta = desde + calendario.franjas_dia - 1;
+    for (int f = desde; f <= hasta; f++) pthread_mutex_lock(&p->franjas[f].cerrojo);
+    DiaParque* d = &p->dias[dia % calendario.dias_ventana];
+    for (int f = desde; f <= hasta; f++) {
+        int ocupacion = p->franjas[f].ocupacion;
+        if (ocupacion != 0) ajustar_ocupacion(p, f, f, -ocupacion);
+        for (int i = 0; i < p->franjas[f].entradas.cantidad; i++) { //Sus ids ya no se pueden cancelar ni modificar
+            Reserva* r = almacen_obtener(&d->almacen, p->franjas[f].entradas.items[i]);
+            if (!r->cancelada) tabla_quitar(&p->reservas, r->id);
+        }
+        p->franjas[f].entradas.cantidad = 0; //La lista conserva su memoria para el dia nuevo
     }
-    simulacion_terminada = 1; //Indica que termino la simulacion
+    almacen_destruir(&d->almacen); //Devuelve los bloques de reservas del dia que termino
+    almacen_iniciar(&d->almacen);
+    d->dia = dia + calendario.dias_ventana; //Un trabajador atrasado que aun apunte al dia viejo ya no lo encuentra
+    for (int f = hasta; f >= desde; f--) pthread_mutex_unlock(&p->franjas[f].cerrojo);
+}
+
+//Recicla en todos los parques los dias anteriores a 'dia' que siguen en la ventana; solo lo llama el hilo de eventos
+//Si el salto es mayor que la ventana basta reciclar los ultimos dias_ventana: cada lugar queda con el dia que le toca
+static void mover_ventana(int dia) {
+    int desde = dia - calendario.dias_ventana > primer_dia_ventana ? dia - calendario.dias_ventana : primer_dia_ventana;
+    for (int d = desde; d < dia; d++)
+        for (int k = 0; k < num_parques; k++) reciclar_dia(&parques[k], d);
+    if (dia > primer_dia_ventana) primer_dia_ventana = dia;
+}
+
+//Suma los contadores de todos los parques; las negadas incluyen las de parques que no existen
+static void sumar_contadores(int* aceptadas, int* reprogramadas, int* negadas) {
+    *aceptadas = *reprogramadas = 0;
+    *negadas = solicitudes_sin_parque;
+    for (int k = 0; k < num_parques; k++) {
+        *aceptadas += parques[k].aceptadas;
+        *reprogramadas += parques[k].reprogramadas;
+        *negadas += parques[k].negadas;
+    }
+}
+
+//Suma en todos los parques las cancelaciones, las modificaciones y los cambios negados
+static void sumar_cambios(int* canceladas, int* modificadas, int* negados) {
+    *canceladas = *modificadas = *negados = 0;
+    for (int k = 0; k < num_parques; k++) {
+        *canceladas += parques[k].canceladas;
+        *modificadas += parques[k].modificadas;
+        *negados += parques[k].cambios_negados;
+    }
+}
+
+//Agrega un descriptor al epoll para eventos de lectura
+static void vigilar(int fd) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+    if (epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        perror("epoll_ctl");
+        exit(1);
+    }
+}
+
+// Crea el epoll con el pipe de entrada, el temporizador del reloj y las senales de apagado
+void iniciar_eventos(void) {
+    if (transporte == TRANSPORTE_FIFO) {
+        //Mientras el controlador tenga su propio escritor, el pipe no reporta EOF cuando los agentes se van
+        fd_escritura_entrada = open(pipe_entrada, O_WRONLY | O_NONBLOCK);
+        if (fd_escritura_entrada == -1) {
+            perror("open pipe_entrada escritura");
+            exit(1);
+        }
+    }
+
+    fd_reloj = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd_reloj == -1) {
+        perror("timerfd_create");
+        exit(1);
+    }
+    struct itimerspec periodo; //Primera expiracion y periodo: una franja simulada
+    double seg_por_franja = seg_por_hora * calendario.minutos_franja / 60.0;
+    periodo.it_interval.tv_sec = (time_t)seg_por_franja;
+    periodo.it_interval.tv_nsec = (long)((seg_por_franja - (double)periodo.it_interval.tv_sec) * 1e9);
+    periodo.it_value = periodo.it_interval;
+    //Con reloj virtual el timerfd queda desarmado y la franja la avanza hora_completa
+    if (!reloj_virtual && timerfd_settime(fd_reloj, 0, &periodo, NULL) == -1) {
+        perror("timerfd_settime");
+        exit(1);
+    }
+    ns_por_franja = (uint64_t)(seg_por_franja * 1e9);
+    proximo_tic_ns = metricas_ahora() + ns_por_franja;
+    fd_decididas = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_decididas == -1) {
+        perror("eventfd decididas");
+        exit(1);
+    }
+    fd_reintento = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC); //Desarmado hasta que un anillo se llene
+    if (fd_reintento == -1) {
+        perror("timerfd_create reintento");
+        exit(1);
+    }
+
+    //Las senales de apagado se bloquean y se reciben como eventos
+    sigset_t senales;
+    sigemptyset(&senales);
+    sigaddset(&senales, SIGINT);
+    sigaddset(&senales, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &senales, NULL);
+    fd_senales = signalfd(-1, &senales, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd_senales == -1) {
+        perror("signalfd");
+        exit(1);
+    }
+
+    fd_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (fd_epoll == -1) {
+        perror("epoll_create1");
+        exit(1);
+    }
+    for (int i = 0; i < MAX_DESCRIPTORES; i++) conexiones[i] = SIN_CONEXION;
+    for (int i = 0; i < MAX_DESCRIPTORES; i++) escritores[i] = -1;
+    vigilar(fd_pipe_entrada);
+    vigilar(fd_reloj);
+    vigilar(fd_senales);
+    vigilar(fd_decididas);
+    vigilar(fd_reintento);
+
+    if (transporte == TRANSPORTE_SHM) { //El vigia se lanza despues de bloquear las senales, asi las hereda bloqueadas
+        vigia.anillo = anillo_entrada;
+        vigia.fd_evento = fd_pipe_entrada;
+        if (pthread_create(&hilo_vigia, NULL, anillo_vigilar, &vigia) != 0) {
+            perror("pthread_create vigia");
+            exit(1);
+        }
+    }
+}
+
+// Bucle principal: atiende solicitudes, avanza el reloj y termina la simulacion
+void bucle_eventos(void) {
+    struct epoll_event eventos[MAX_EVENTOS];
+    int terminar = franja_actual >= calendario_total(&calendario); //Una simulacion recuperada que ya habia terminado solo muestra su reporte
+    metricas_usar_hilo(0); //Este hilo mide la lectura y la decodificacion
+    diario_usar_hilo(0); //Y anota las solicitudes recibidas y el avance del reloj
+    while (!terminar) {
+        int n = epoll_wait(fd_epoll, eventos, MAX_EVENTOS, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        int hay_solicitudes = 0, hay_tic = 0, hay_senal = 0;
+        int listas[MAX_EVENTOS], num_listas = 0; //Conexiones de agentes con datos (-x unix)
+        int escribibles[MAX_EVENTOS], num_escribibles = 0; //Canales de respuesta que volvieron a tener espacio
+        for (int i = 0; i < n; i++) { //Primero se anota que fuentes estan listas
+            int fd = eventos[i].data.fd;
+            if (fd == fd_pipe_entrada) hay_solicitudes = 1;
+            else if (fd == fd_reloj) hay_tic = 1;
+            else if (fd == fd_senales) hay_senal = 1;
+            else if (fd == fd_decididas) { //Solo sirve para despertar: hora_completa revisa el estado
+                uint64_t avisos;
+                if (read(fd_decididas, &avisos, sizeof(avisos)) == -1 && errno != EAGAIN) perror("read eventfd");
+            }
+            else if (fd == fd_reintento) {
+                uint64_t expiraciones;
+                if (read(fd_reintento, &expiraciones, sizeof(expiraciones)) == sizeof(expiraciones)) reintentar_pendientes();
+            }
+            else { //Con -x fifo solo se vigila la escritura; una conexion puede estar lista para ambas
+                if (transporte != TRANSPORTE_UNIX || (eventos[i].events & EPOLLOUT)) escribibles[num_escribibles++] = fd;
+                if (transporte == TRANSPORTE_UNIX && (eventos[i].events & ~EPOLLOUT)) listas[num_listas++] = fd;
+            }
+        }
+        //Lo guardado sale antes de leer: leer_conexion puede cerrar el descriptor
+        for (int i = 0; i < num_escribibles; i++) escribir_pendientes(escribibles[i]);
+        //Orden fijo: las solicitudes que ya llegaron se deciden antes de que avance la hora
+        if (hay_solicitudes) leer_solicitudes(); //Con -x unix acepta las conexiones nuevas
+        for (int i = 0; i < num_listas; i++) leer_conexion(listas[i]);
+        if (hay_tic) {
+            uint64_t expiraciones = 0;
+            if (read(fd_reloj, &expiraciones, sizeof(expiraciones)) == sizeof(expiraciones)) {
+                proximo_tic_ns += expiraciones * ns_por_franja; //El periodo es fijo, no hace falta preguntarle al timerfd
+                for (uint64_t k = 0; k < expiraciones && !terminar; k++) { //Si hubo retraso avanza todas las franjas vencidas
+                    avanzar_hora(); //Actualiza las rservas y si esta ocupado
+                    if (franja_actual >= calendario_total(&calendario)) terminar = 1; //Paso la ultima franja del ultimo dia
+                }
+            }
+        }
+        contar_cierres(); //Un agente que cerro un trabajador ya no envia: no debe detener el reloj virtual
+        vigilar_pendientes(); //Los agentes a los que un trabajador les guardo respuestas las reciben cuando lean
+        //Con reloj virtual la franja avanza en cuanto no queda nada que decidir en la actual
+        while (reloj_virtual && !terminar && hora_completa()) {
+            avanzar_hora();
+            if (franja_actual >= calendario_total(&calendario)) terminar = 1;
+        }
+        if (hay_senal) {
+            struct signalfd_siginfo info;
+            if (read(fd_senales, &info, sizeof(info)) == sizeof(info)) {
+                char aviso[64];
+                int largo = snprintf(aviso, sizeof(aviso), "Senal %u recibida, se termina la simulacion.\n", info.ssi_signo);
+                diario_texto(NIVEL_SILENCIO, aviso, (size_t)largo);
+            }
+            terminar = 1;
+        }
+    }
+    detener_trabajadores(); //Deja que los trabajadores terminen lo que ya estaba en la cola
+    diario_detener(); //Escribe lo que quedaba en el diario antes del reporte
+    bitacora_cerrar(); //Escribe lo que falte y deja un punto de control con el estado final
+    detener_estadisticas(); //El archivo queda con los valores finales
     imprimir_reporte(); //Muestra un reporte final de la simulacion
     terminar_agentes(); //Le indica todos los agentes que se termino la simulacion
     limpiar_recursos(); //limpia los recursos y borra el pipe del controlador
-    pthread_exit(NULL); //Termina el hilo
 }
 
-// Funcion ejecutada por el hilo que gestiona las solicitudes de los agentes
-void* gestor_solicitudes(void* arg) {
-    (void)arg;
-    char buffer[MAX_BUFFER]; //Buffer de lectura
-    while (!simulacion_terminada) { //Mientras no termine
-        int n = read(fd_pipe_entrada, buffer, sizeof(buffer) - 1); //Lee los mensajes del pipe
-        if (n > 0) {
-            buffer[n] = '\0'; 
-            procesar_mensaje(buffer); //LLama a la funcion que procesa los datos
+//Procesa todas las tramas publicadas en el anillo de entrada, sin copiarlas
+static void leer_anillo(void) {
+    uint64_t avisos;
+    uint64_t inicio = metricas_ahora();
+    if (read(fd_pipe_entrada, &avisos, sizeof(avisos)) == -1) { //Limpia el eventfd
+        if (errno != EAGAIN) perror("read eventfd");
+    } else {
+        metricas_registrar(ETAPA_LECTURA, inicio); //Las tramas se leen en el anillo sin otra llamada al sistema
+    }
+    const uint8_t* trama;
+    int len;
+    while ((len = anillo_frente(anillo_entrada, &trama)) > 0) {
+        CabeceraTrama cab;
+        const uint8_t* cuerpo;
+        if (trama_abrir(trama, (size_t)len, &cab, &cuerpo) == 1)
+            procesar_mensaje(&cab, cuerpo, -1);
+        else
+            fprintf(stderr, "Error: trama invalida en %s, se descarta.\n", pipe_entrada);
+        anillo_avanzar(anillo_entrada); //La ranura se devuelve despues de procesar la trama
+    }
+}
+
+//Acepta todas las conexiones pendientes y las agrega al epoll
+static void aceptar_conexiones(void) {
+    for (;;) {
+        int fd = accept(fd_pipe_entrada, NULL, NULL);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EINTR) perror("accept");
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fd >= MAX_DESCRIPTORES) { //No se puede seguir: se rechaza y el agente ve fin de conexion
+            fprintf(stderr, "Aviso: demasiadas conexiones, se rechaza una.\n");
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, O_NONBLOCK); //Las respuestas nunca bloquean a un trabajador, igual que con los pipes
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        conexiones[fd] = CONEXION_SIN_REGISTRO; //El primer mensaje debe ser el REGISTRO
+        vigilar(fd);
+    }
+}
+
+// Lee las tramas de una conexion de agente; cada recv entrega exactamente una trama
+void leer_conexion(int fd) {
+    uint8_t trama[MAX_TRAMA];
+    for (int k = 0; k < MAX_TRAMAS_POR_CONEXION && conexiones[fd] != SIN_CONEXION; k++) { //El resto queda para la siguiente vuelta
+        uint64_t inicio = metricas_ahora();
+        ssize_t n = recv(fd, trama, sizeof(trama), 0);
+        if (n > 0) metricas_registrar(ETAPA_LECTURA, inicio);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1 && errno == EAGAIN) return; //Ya no hay mas tramas por ahora
+        if (n <= 0) { //El agente cerro la conexion o fallo
+            cerrar_conexion(fd);
+            return;
+        }
+        CabeceraTrama cab;
+        const uint8_t* cuerpo;
+        if (trama_abrir(trama, (size_t)n, &cab, &cuerpo) == 1)
+            procesar_mensaje(&cab, cuerpo, fd);
+        else
+            fprintf(stderr, "Error: trama invalida en una conexion, se descarta.\n");
+    }
+}
+
+//Desactiva al agente de la conexion y cierra el descriptor; solo la llama el hilo de eventos
+static void cerrar_conexion(int fd) {
+    int id = conexiones[fd];
+    if (id >= 0) {
+        desactivar_agente(&agentes[id]); //Despues de esto ningun trabajador escribe en fd
+        if (!agentes[id].fin_envio) { //Un agente desconectado ya no va a enviar mas
+            agentes[id].fin_envio = 1;
+            agentes_sin_fin--;
+        }
+    }
+    conexiones[fd] = SIN_CONEXION;
+    close(fd); //Tambien lo quita del epoll
+}
+
+// Lee y procesa todas las tramas disponibles en el pipe de entrada
+void leer_solicitudes(void) {
+    if (transporte == TRANSPORTE_UNIX) {
+        aceptar_conexiones();
+        return;
+    }
+    if (transporte == TRANSPORTE_SHM) {
+        leer_anillo();
+        return;
+    }
+    static LectorTramas lector; //Buffer grande donde se acumulan los bytes del pipe, conserva tramas a medias entre llamadas
+    for (;;) {
+        uint64_t inicio = metricas_ahora();
+        ssize_t n = lector_llenar(&lector, fd_pipe_entrada); //Lee todo lo que haya en el pipe de una vez
+        if (n <= 0) break; //EAGAIN: ya no hay mas datos por ahora
+        metricas_registrar(ETAPA_LECTURA, inicio);
+        CabeceraTrama cab;
+        const uint8_t* cuerpo;
+        int r;
+        while ((r = lector_siguiente(&lector, &cab, &cuerpo)) == 1) //Procesa cada trama completa
+            procesar_mensaje(&cab, cuerpo, -1);
+        if (r == -1) //Los bytes no forman una trama valida
+            fprintf(stderr, "Error: trama invalida en %s, se descartan los datos pendientes.\n", pipe_entrada);
+    }
+}
+
+//Tipos de los registros del diario propios del controlador (el 0 es DIARIO_TEXTO)
+enum {
+    EVENTO_SOLICITUD = 1, //Solicitud recibida: agente, familia, minuto, personas y parque
+    EVENTO_DECISION, //Decision de un trabajador: ademas el codigo, el minuto asignado y en extra el id de la reserva
+    EVENTO_HORA, //Avance del reloj al minuto indicado
+    EVENTO_MOVIMIENTO, //Quienes salen (codigo 0) o entran (codigo 1) de un parque; le siguen 'cantidad' EVENTO_FAMILIA
+                       //y en extra van las familias que no cupieron en el anillo
+    EVENTO_FAMILIA, //Una familia de un EVENTO_MOVIMIENTO
+    EVENTO_CANCELACION, //Cancelacion recibida (codigo 0) o decidida (codigo de la respuesta), con el id en extra
+    EVENTO_MODIFICACION, //Igual, para una modificacion: ademas el minuto y las personas nuevas
+    EVENTO_CONSULTA //Consulta de disponibilidad: desde en minuto, hasta en extra, personas y parque
+};
+
+//Convierte un registro del diario en el mismo texto que se mostraba con printf; solo lo llama el escritor del diario
+static size_t formatear_evento(const RegistroDiario* r, char* destino) {
+    static int familias_pendientes = 0, familias_puestas = 0, familias_omitidas = 0; //Del EVENTO_MOVIMIENTO que se esta escribiendo
+    char texto[TAM_INSTANTE];
+    int n = 0;
+    switch (r->tipo) {
+        case EVENTO_SOLICITUD:
+            texto_instante(r->minuto, texto, sizeof(texto));
+            if (num_parques > 1)
+                n = snprintf(destino, MAX_FORMATO_DIARIO, "Recibida solicitud de %s: familia %s, hora %s, %d personas, parque %d\n",
+                             agentes[r->agente].nombre, r->texto, texto, r->personas, r->parque);
+            else
+                n = snprintf(destino, MAX_FORMATO_DIARIO, "Recibida solicitud de %s: familia %s, hora %s, %d personas\n",
+                             agentes[r->agente].nombre, r->texto, texto, r->personas);
+            break;
+        case EVENTO_DECISION:
+            texto_instante(r->minuto, texto, sizeof(texto));
+            n = snprintf(destino, MAX_FORMATO_DIARIO, "Decidida solicitud de %s: familia %s, %d personas, %s a las %s",
+                         agentes[r->agente].nombre, r->texto, r->personas, nombre_respuesta(r->codigo), texto);
+            if (r->extra != SIN_ID_RESERVA) n += snprintf(destino + n, MAX_FORMATO_DIARIO - n, ", reserva %u", (uint32_t)r->extra);
+            n += snprintf(destino + n, MAX_FORMATO_DIARIO - n, "\n");
+            break;
+        case EVENTO_CANCELACION:
+            if (r->codigo == 0)
+                n = snprintf(destino, MAX_FORMATO_DIARIO, "Recibida cancelacion de %s: reserva %u\n",
+                             agentes[r->agente].nombre, (uint32_t)r->extra);
+            else
+                n = snprintf(destino, MAX_FORMATO_DIARIO, "Decidida cancelacion de %s: reserva %u, familia %s, %s\n",
+                             agentes[r->agente].nombre, (uint32_t)r->extra, r->texto, nombre_respuesta(r->codigo));
+            break;
+        case EVENTO_MODIFICACION:
+            texto_instante(r->minuto, texto, sizeof(texto));
+            if (r->codigo == 0)
+                n = snprintf(destino, MAX_FORMATO_DIARIO, "Recibida modificacion de %s: reserva %u, hora %s, %d personas\n",
+                             agentes[r->agente].nombre, (uint32_t)r->extra, texto, r->personas);
+            else
+                n = snprintf(destino, MAX_FORMATO_DIARIO, "Decidida modificacion de %s: reserva %u, familia %s, %d personas, %s a las %s\n",
+                             agentes[r->agente].nombre, (uint32_t)r->extra, r->texto, r->personas, nombre_respuesta(r->codigo), texto);
+            break;
+        case EVENTO_CONSULTA: {
+            char hasta[TAM_INSTANTE];
+            texto_instante(r->minuto, texto, sizeof(texto));
+            texto_instante(r->extra, hasta, sizeof(hasta));
+            n = snprintf(destino, MAX_FORMATO_DIARIO, "Consulta de disponibilidad de %s: desde %s hasta %s, %d personas",
+                         agentes[r->agente].nombre, texto, hasta, r->personas);
+            if (num_parques > 1) n += snprintf(destino + n, MAX_FORMATO_DIARIO - n, ", parque %d", r->parque);
+            n += snprintf(destino + n, MAX_FORMATO_DIARIO - n, "\n");
+            break;
         }
+        case EVENTO_HORA:
+            texto_instante(r->minuto, texto, sizeof(texto));
+            n = snprintf(destino, MAX_FORMATO_DIARIO, "Hora actual: %s\n", texto);
+            break;
+        case EVENTO_MOVIMIENTO:
+            if (num_parques > 1 && r->codigo == 0) n = snprintf(destino, MAX_FORMATO_DIARIO, "Parque %d:\n", r->parque);
+            n += snprintf(destino + n, MAX_FORMATO_DIARIO - n, "%s: %d personas (", r->codigo ? "Entran" : "Salen", r->personas);
+            if (r->cantidad == 0) //Sin familias que escribir el parentesis se cierra aqui
+                n += snprintf(destino + n, MAX_FORMATO_DIARIO - n, r->extra > 0 ? "%d familias)\n" : "ninguna)\n", r->extra);
+            familias_pendientes = r->cantidad;
+            familias_puestas = 0;
+            familias_omitidas = r->extra;
+            break;
+        case EVENTO_FAMILIA:
+            n = snprintf(destino, MAX_FORMATO_DIARIO, "%s%.*s", familias_puestas > 0 ? ", " : "", TAM_TEXTO_DIARIO, r->texto);
+            familias_puestas++;
+            if (--familias_pendientes == 0) //La ultima familia cierra la linea
+                n += snprintf(destino + n, MAX_FORMATO_DIARIO - n, familias_omitidas > 0 ? " y %d mas)\n" : ")\n", familias_omitidas);
+            break;
     }
-    pthread_exit(NULL); 
+    return n < MAX_FORMATO_DIARIO ? (size_t)n : MAX_FORMATO_DIARIO - 1;
 }
 
-// Avanza la simulacion en una hora, se actualizan las rservas para esa nueva hora
+//Deja en el diario quienes salen (entran = 0) o entran (entran = 1) de un parque: un registro por familia
+//Todo el evento se reserva de una vez; si el anillo no alcanza para todas, las que sobran solo se cuentan
+//Las reservas canceladas o movidas siguen en la lista de la franja, pero ya no entran ni salen
+static void anotar_movimiento(Parque* p, int franja, int entran) {
+    FranjaParque* f = franja_en(p, franja);
+    DiaParque* d = dia_en(p, franja);
+    RegistroDiario r = { .tipo = EVENTO_MOVIMIENTO, .parque = (uint8_t)p->id, .codigo = (uint8_t)entran };
+    pthread_mutex_lock(&f->cerrojo); //Los trabajadores pueden estar agregando o cancelando reservas
+    int vigentes = 0;
+    for (int i = 0; i < f->entradas.cantidad; i++) {
+        Reserva* reserva = almacen_obtener(&d->almacen, f->entradas.items[i]);
+        if (reserva->cancelada) continue;
+        vigentes++;
+        r.personas += reserva->personas;
+    }
+    int libres = diario_libres() - 1; //Uno es para el propio EVENTO_MOVIMIENTO
+    if (libres >= 0) {
+        r.cantidad = vigentes < libres ? vigentes : libres;
+        r.extra = vigentes - r.cantidad;
+        diario_descartar(r.extra);
+        diario_poner(&r);
+        RegistroDiario familia = { .tipo = EVENTO_FAMILIA, .parque = (uint8_t)p->id };
+        for (int i = 0, puestas = 0; puestas < r.cantidad; i++) { //Recorre las reservas que empiezan en esa franja
+            Reserva* reserva = almacen_obtener(&d->almacen, f->entradas.items[i]);
+            if (reserva->cancelada) continue;
+            strncpy(familia.texto, reserva->familia, TAM_TEXTO_DIARIO);
+            diario_poner(&familia);
+            puestas++;
+        }
+        diario_publicar();
+    } else {
+        diario_descartar(vigentes + 1);
+    }
+    pthread_mutex_unlock(&f->cerrojo);
+}
+
+//Muestra quienes salen y entran a un parque en una franja
+static void mostrar_movimientos(Parque* p, int franja) {
+    int salida = franja - largo_reserva(); //Los que entraron hace DURACION_RESERVA minutos terminan su estadia
+    if (salida >= 0 && calendario_dia(&calendario, salida) == calendario_dia(&calendario, franja)) { //Ninguna estadia cruza la noche
+        anotar_movimiento(p, salida, 0);
+    } else if (diario_reservar(1)) { //Nadie puede salir: el evento va sin familias
+        RegistroDiario r = { .tipo = EVENTO_MOVIMIENTO, .parque = (uint8_t)p->id, .codigo = 0 };
+        diario_poner(&r);
+        diario_publicar();
+    }
+    anotar_movimiento(p, franja, 1);
+}
+
+// Avanza la simulacion en una franja; al terminar un dia lo resume y recicla su lugar en la ventana
+//La ocupacion ya se conto al aceptar cada reserva, aqui solo se informa quien entra y quien sale de cada parque
 void avanzar_hora() {
-    printf("Hora actual: %d\n", hora_actual);
-
-    int saliendo = 0;
-    char familias_saliendo[512] = "";
-    if (hora_actual - 2 >= 7) { //Salen las rservas de las ultimas dos horas
-        for (int i = 0; i < parque[hora_actual - 2].num_reservas; i++) {
-            Reserva* r = &parque[hora_actual - 2].reservas[i];
-            if (r->hora_inicio == hora_actual - 2) { //Si estaban en las ultimas dos horas
-                parque[hora_actual - 2].ocupacion -= r->personas; //Se restan del aforo
-                if (hora_actual - 1 <= 19)
-                    parque[hora_actual - 1].ocupacion -= r->personas;
-                saliendo += r->personas;
-                strcat(familias_saliendo, r->familia);
-                strcat(familias_saliendo, ", ");
+    int f = franja_actual; //Solo este hilo cambia el reloj, se lee una vez
+    if (diario_activo(NIVEL_RELOJ)) { //Cada evento se descarta por separado si el anillo esta lleno
+        if (diario_reservar(1)) {
+            RegistroDiario r = { .tipo = EVENTO_HORA, .minuto = calendario_minuto(&calendario, f) };
+            diario_poner(&r);
+            diario_publicar();
+        }
+        for (int k = 0; k < num_parques; k++)
+            mostrar_movimientos(&parques[k], f);
+    }
+    int dia = calendario_dia(&calendario, f);
+    //El ultimo dia no se recicla: es el que muestra el reporte final
+    int cambia_dia = calendario_dia(&calendario, f + 1) != dia && dia + 1 < calendario.dias;
+    if (cambia_dia && diario_activo(NIVEL_RELOJ)) { //Resumen del dia antes de que su lugar en la ventana pase a otro
+        char* resumen = NULL; //Una vez por dia: se arma con stdio y pasa al diario como texto
+        size_t largo = 0;
+        FILE* m = open_memstream(&resumen, &largo);
+        if (m) {
+            fprintf(m, "Fin del dia %d:\n", dia);
+            for (int k = 0; k < num_parques; k++) {
+                if (num_parques > 1) fprintf(m, "Parque %d:\n", k);
+                imprimir_horas(m, &parques[k], dia);
             }
+            fclose(m);
+            diario_texto(NIVEL_RELOJ, resumen, largo);
+            free(resumen);
         }
-        //Quita la coma si solo hay una familia
-        if (strlen(familias_saliendo) > 0)
-            familias_saliendo[strlen(familias_saliendo) - 2] = '\0';
-    }
-
-    int entrando = 0; //Inicializa el contador de personas entrando
-    char familias_entrando[512] = ""; //Donde van los nombres de las familias que entraron
-    for (int i = 0; i < parque[hora_actual].num_reservas; i++) { //Recoore las reservas
-        Reserva* r = &parque[hora_actual].reservas[i]; //Va rserva por reserva
-        if (r->hora_inicio == hora_actual) { //Si es la hora de su reserva entran
-            parque[hora_actual].ocupacion += r->personas; //Aumenta el aforo
-            if (hora_actual + 1 <= 19) //En la siguiente hora ya que estan durante dos horas
-                parque[hora_actual + 1].ocupacion += r->personas;
-            entrando += r->personas; //Actualiza las personas entrando
-            strcat(familias_entrando, r->familia); //Agrega el nombre de la familia
-            strcat(familias_entrando, ", ");
-        }
-    }
-    //Elimina la , si solo hay una familia
-    if (strlen(familias_entrando) > 0)
-        familias_entrando[strlen(familias_entrando) - 2] = '\0';
-    //Muestra cuantos salieron y entraron
-    printf("Salen: %d personas (%s)\n", saliendo,
-           strlen(familias_saliendo) > 0 ? familias_saliendo : "ninguna");
-    printf("Entran: %d personas (%s)\n", entrando,
-           strlen(familias_entrando) > 0 ? familias_entrando : "ninguna");
-    //Avanza la hora en uno
-    hora_actual++;
-}
-
-// Procesa los mensajes recibidos desde los agentes
-void procesar_mensaje(char* msg) {
-    //Variables en donde se guardan los datos del mensaje
-    char tipo[20], p1[MAX_NOMBRE], p2[MAX_NOMBRE], p3[MAX_NOMBRE], p4[MAX_NOMBRE];
-    int n = sscanf(msg, "%[^|]|%[^|]|%[^|]|%[^|]|%[^|]", tipo, p1, p2, p3, p4);
+    }
+    //Avanza una franja; con -b queda anotado para que una recuperacion siga desde aqui
+    bitacora_entrar();
+    franja_actual++;
+    if (cambia_dia) mover_ventana(dia + 1); //Dentro de la seccion: un punto de control ve el dia ya reciclado
+    RegistroBitacora reg = { .tipo = BIT_HORA, .minuto = calendario_minuto(&calendario, franja_actual) };
+    bitacora_anotar(&reg);
+    bitacora_salir();
+}
+
+//Si un trabajador cerro al agente (no se le pudo escribir), lo cuenta como terminado; solo el hilo de eventos
+static void contar_cierre(Agente* a) {
+    if (atomic_exchange(&a->cierre_sin_contar, 0) && !a->fin_envio) {
+        a->fin_envio = 1;
+        agentes_sin_fin--;
+    }
+}
+
+//Cuenta como terminados a todos los agentes que cerraron los trabajadores desde la ultima vuelta
+static void contar_cierres(void) {
+    if (!atomic_exchange(&hay_cierres, 0)) return; //Un cierre posterior vuelve a marcarlo y se ve en la siguiente vuelta
+    for (int i = 0; i < num_agentes; i++) contar_cierre(&agentes[i]);
+}
+
+//Arma (1) o desarma (0) el reintento periodico de las respuestas guardadas para anillos
+static void armar_reintento(int armar) {
+    struct itimerspec periodo = { 0 };
+    if (armar) {
+        periodo.it_interval.tv_nsec = REINTENTO_ANILLO_MS * 1000000L;
+        periodo.it_value = periodo.it_interval;
+    }
+    if (timerfd_settime(fd_reintento, 0, &periodo, NULL) == -1) perror("timerfd_settime reintento");
+}
+
+//Un anillo no tiene descriptor y un pipe fuera de escritores no se puede seguir: ambos se reintentan con el temporizador
+static int sin_descriptor(const Agente* a) {
+    return a->anillo != NULL || a->fd_respuesta >= MAX_DESCRIPTORES;
+}
+
+//Espera que el canal del agente id tenga espacio; con su cerrojo tomado, solo el hilo de eventos
+static void vigilar_escritura(int id) {
+    Agente* a = &agentes[id];
+    int fd = a->fd_respuesta;
+    if (sin_descriptor(a)) {
+        armar_reintento(1);
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLOUT, .data.fd = fd };
+    int r;
+    if (transporte == TRANSPORTE_UNIX) { //La conexion ya esta en el epoll para leer
+        ev.events |= EPOLLIN;
+        r = epoll_ctl(fd_epoll, EPOLL_CTL_MOD, fd, &ev);
+    } else {
+        escritores[fd] = id;
+        r = epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &ev);
+        if (r == -1 && errno == EEXIST) r = 0; //Ya se vigilaba
+    }
+    if (r == -1) perror("epoll_ctl escritura");
+}
+
+//Deja de esperar espacio en fd; si el agente ya lo cerro, el close lo quito del epoll y esto no hace nada
+static void dejar_de_vigilar(int fd) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+    if (transporte == TRANSPORTE_UNIX) epoll_ctl(fd_epoll, EPOLL_CTL_MOD, fd, &ev);
+    else epoll_ctl(fd_epoll, EPOLL_CTL_DEL, fd, NULL);
+}
+
+//Empieza a esperar espacio en el canal de los agentes a los que un trabajador les guardo respuestas
+static void vigilar_pendientes(void) {
+    if (!atomic_exchange(&hay_pendientes, 0)) return; //Un pedido posterior vuelve a marcarlo y se ve en la siguiente vuelta
+    for (int i = 0; i < num_agentes; i++) {
+        Agente* a = &agentes[i];
+        if (!atomic_exchange(&a->vigilar_pedido, 0)) continue;
+        pthread_mutex_lock(&a->cerrojo);
+        if (a->activo && a->pendiente_largo > 0) vigilar_escritura(i);
+        pthread_mutex_unlock(&a->cerrojo);
+    }
+}
+
+//El canal de respuestas en fd tiene espacio: le escribe a su agente lo que se le guardo
+static void escribir_pendientes(int fd) {
+    int id = transporte == TRANSPORTE_UNIX ? conexiones[fd] : escritores[fd];
+    int quedan = 0;
+    if (id >= 0) {
+        Agente* a = &agentes[id];
+        pthread_mutex_lock(&a->cerrojo);
+        quedan = a->activo && a->fd_respuesta == fd && vaciar_agente(a); //Si no coincide, un trabajador ya lo cerro
+        pthread_mutex_unlock(&a->cerrojo);
+    }
+    if (!quedan) dejar_de_vigilar(fd); //Con el epoll por nivel, seguiria avisando mientras tenga espacio
+}
+
+//Vence el reintento: escribe lo guardado para los canales sin descriptor y lo desarma cuando ya no queda nada
+static void reintentar_pendientes(void) {
+    int quedan = 0;
+    for (int i = 0; i < num_agentes; i++) {
+        Agente* a = &agentes[i];
+        pthread_mutex_lock(&a->cerrojo);
+        if (a->activo && a->pendiente_largo > 0 && sin_descriptor(a) && vaciar_agente(a)) quedan = 1;
+        pthread_mutex_unlock(&a->cerrojo);
+    }
+    if (!quedan) armar_reintento(0); //Un pedido posterior lo vuelve a armar en vigilar_pendientes
+}
+
+// Con reloj virtual, retorna 1 si todos los agentes esperados terminaron de enviar y no queda nada por decidir
+//Solo la llama el hilo de eventos, que es el que registra agentes, recibe sus MSG_FIN_SOLICITUDES y encola
+//Como nadie mas suma a en_curso, si cada parque se ve en cero de uno en uno todos lo estan a la vez
+int hora_completa(void) {
+    if (num_agentes < agentes_esperados || agentes_sin_fin != 0) return 0;
+    for (int k = 0; k < num_parques; k++)
+        if (atomic_load(&parques[k].en_curso) != 0) return 0;
+    return 1;
+}
+
+//Milisegundos hasta que el reloj deja atras la franja mas cercana que pide un trabajo, hasta HORIZONTE_URGENTE_MS
+//La franja f queda en el pasado con el tic que lleva el reloj a f + 1. Una cancelacion no pide hora y libera lugares,
+//asi que no espera; una hora que ya paso o fuera del horario no gana nada con adelantarse y no tiene plazo
+//Con reloj virtual la franja no avanza mientras quede algo en las colas: ningun trabajo tiene plazo
+static int plazo_trabajo(const Trabajo* t) {
+    if (reloj_virtual) return HORIZONTE_URGENTE_MS;
+    if (t->tipo == MSG_CANCELAR) return 0;
+    int ahora = franja_actual;
+    uint64_t tic = metricas_ahora();
+    uint64_t hasta_tic = proximo_tic_ns > tic ? proximo_tic_ns - tic : 0; //Un tic vencido todavia sin leer esta por pasar
+    uint64_t plazo = (uint64_t)HORIZONTE_URGENTE_MS * 1000000ULL;
+    for (int i = 0; i < t->cantidad; i++) {
+        int f = calendario_franja(&calendario, t->sol[i].inicio);
+        if (f < ahora) continue;
+        uint64_t p = hasta_tic + (uint64_t)(f - ahora) * ns_por_franja;
+        if (p < plazo) plazo = p;
+    }
+    return (int)(plazo / 1000000ULL);
+}
+
+//Responde en el hilo de eventos, con el mismo codigo para todas, las solicitudes de un trabajo que no se decide:
+//NEGADA si su parque no existe u OCUPADO si su cola esta llena. No cambia ningun parque y no se anota
+static void responder_sin_decidir(const Trabajo* t, Agente* agente, int codigo) {
+    MsgRespuesta respuestas[MAX_LOTE];
+    for (int i = 0; i < t->cantidad; i++) {
+        respuestas[i].codigo = codigo;
+        respuestas[i].inicio = codigo == RESP_OCUPADO ? REINTENTO_OCUPADO_MS : t->sol[i].inicio;
+        respuestas[i].reserva = t->sol[i].reserva;
+        strcpy(respuestas[i].familia, t->sol[i].familia);
+    }
+    uint8_t trama[MAX_TRAMA];
+    int len = t->lote ? codificar_respuesta_lote(trama, respuestas, t->ids, t->cantidad)
+                      : codificar_respuesta(trama, t->ids[0], &respuestas[0]);
+    enviar_respuesta(agente, trama, len);
+}
+
+//Agente que dice ser el remitente de una trama, o NULL si no se le puede creer o no existe
+static Agente* agente_remitente(uint32_t id_agente, int fd_origen) {
+    if (fd_origen >= 0 && id_agente != (uint32_t)conexiones[fd_origen]) { //Con conexiones el id debe ser el del que la envia
+        fprintf(stderr, "Error: solicitud con el id de otro agente, se descarta.\n");
+        return NULL;
+    }
+    if (id_agente >= (uint32_t)num_agentes) { //El id lo asigna el registro, uno desconocido no tiene a quien responder
+        fprintf(stderr, "Error: no se encontró el agente %u para enviar respuesta.\n", id_agente);
+        return NULL;
+    }
+    return &agentes[id_agente]; //Acceso directo por id
+}
+
+//Responde una consulta de disponibilidad en el hilo de eventos: no cambia nada, asi que no pasa por la cola
+//ni por la bitacora, y la lectura sin cerrojos no frena a los trabajadores que estan reservando
+static void responder_consulta(const CabeceraTrama* cab, const uint8_t* cuerpo, int fd_origen) {
+    MsgConsulta c;
+    if (decodificar_consulta(cuerpo, cab->longitud, &c) == -1) return;
+    Agente* agente = agente_remitente(c.id_agente, fd_origen);
+    if (!agente) return;
+    if (diario_activo(NIVEL_SOLICITUDES) && diario_reservar(1)) {
+        RegistroDiario r = { .tipo = EVENTO_CONSULTA, .parque = (uint8_t)c.parque, .agente = c.id_agente,
+                             .minuto = c.desde, .personas = c.personas, .extra = c.hasta };
+        diario_poner(&r);
+        diario_publicar();
+    }
+    MsgDisponibilidad disponibilidad;
+    disponibilidad.cantidad = 0; //Un parque que no existe no tiene franjas libres
+    if (c.parque < num_parques) consultar_disponibilidad(&parques[c.parque], &c, &disponibilidad);
+    consultas_disponibilidad++;
+    uint8_t trama[MAX_TRAMA];
+    int len = codificar_disponibilidad(trama, cab->id_solicitud, &disponibilidad);
+    if (len > 0) enviar_respuesta(agente, trama, len);
+}
+
+// Procesa una trama completa recibida desde los agentes
+//fd_origen es la conexion por la que llego la trama con -x unix, o -1 con los demas transportes
+void procesar_mensaje(const CabeceraTrama* cab, const uint8_t* cuerpo, int fd_origen) {
+    if (fd_origen >= 0 && cab->tipo != MSG_REGISTRO && conexiones[fd_origen] < 0) {
+        fprintf(stderr, "Error: mensaje antes del registro en una conexion, se descarta.\n");
+        return;
+    }
     //El mensaje indica que hay un nuevo agente
-    if (strcmp(tipo, "REGISTRO") == 0 && n >= 3) {
-        registrar_agente(p1, p2); //Lo registra
-    } else if (strcmp(tipo, "SOLICITUD") == 0 && n >= 4) { //El mensaje es una solicitud de reserva
-        int hora = atoi(p2); //Convierte la entrada a entero
-        int personas = atoi(p3); //Convierte el numero de personas a entero
-        char respuesta[MAX_BUFFER] = ""; //Buffer para la respuesta
-        //Indica que recibio la solicitud
-        printf("Recibida solicitud de %s: familia %s, hora %d, %d personas\n",
-               p4, p1, hora, personas);
-        //Llama la funcion de rservas
-        intentar_reserva(p1, hora, personas, p4, respuesta);
-
-        char pipe_agente[MAX_NOMBRE] = ""; //Variable para el nombre del pipe del agente
-        for (int i = 0; i < num_agentes; i++) { //Recorre los agentes
-            if (strcmp(agentes[i].nombre, p4) == 0) { //Si es el que envio la solicitud
-                strcpy(pipe_agente, agentes[i].pipe_respuesta); //Obtiene una copia del nombre
-                break;
+    if (cab->tipo == MSG_REGISTRO) {
+        MsgRegistro reg;
+        if (decodificar_registro(cuerpo, cab->longitud, &reg) == 0) {
+            if (fd_origen >= 0 && conexiones[fd_origen] != CONEXION_SIN_REGISTRO) return; //Una conexion se registra una sola vez
+            int id = registrar_agente(reg.nombre, reg.pipe_respuesta, fd_origen); //Lo registra
+            if (fd_origen >= 0) {
+                if (id >= 0) conexiones[fd_origen] = id; //Desde ahora la conexion es de este agente
+                else cerrar_conexion(fd_origen); //Registro rechazado: el agente ve fin de conexion
             }
         }
+    } else if (cab->tipo == MSG_FIN_SOLICITUDES) { //El agente ya envio todo su archivo
+        uint32_t id;
+        if (decodificar_fin_solicitudes(cuerpo, cab->longitud, &id) == -1 || id >= (uint32_t)num_agentes) return;
+        if (fd_origen >= 0 && id != (uint32_t)conexiones[fd_origen]) return; //Solo el propio agente puede avisarlo
+        if (!agentes[id].fin_envio) {
+            agentes[id].fin_envio = 1;
+            agentes_sin_fin--;
+        }
+    } else if (cab->tipo == MSG_SOLICITUD || cab->tipo == MSG_SOLICITUD_LOTE ||
+               cab->tipo == MSG_CANCELAR || cab->tipo == MSG_MODIFICAR) { //Una solicitud de reserva, un lote o un cambio
+        Trabajo t; //Solicitudes que se dejan para los trabajadores
+        uint64_t inicio = metricas_ahora();
+        t.tipo = cab->tipo == MSG_SOLICITUD_LOTE ? MSG_SOLICITUD : cab->tipo;
+        if (cab->tipo == MSG_SOLICITUD_LOTE) {
+            t.cantidad = decodificar_lote(cuerpo, cab->longitud, t.sol, t.ids); //Cada solicitud trae su id
+            if (t.cantidad == -1) return;
+            t.lote = 1;
+        } else {
+            //Un cambio va a la cola del parque de la reserva, que viene en los bits bajos de su id
+            if ((cab->tipo == MSG_SOLICITUD ? decodificar_solicitud(cuerpo, cab->longitud, &t.sol[0])
+                                            : decodificar_cambio(cuerpo, cab->longitud, cab->tipo, &t.sol[0])) == -1) return;
+            t.cantidad = 1;
+            t.lote = 0;
+            t.ids[0] = cab->id_solicitud; //Se devuelve el mismo id que envio el agente
+        }
+        metricas_registrar(ETAPA_DECODIFICACION, inicio);
+        t.id_agente = t.sol[0].id_agente;
+        Agente* agente = agente_remitente(t.id_agente, fd_origen);
+        if (!agente) return;
+        contador_sumar(&agente->solicitudes, (uint64_t)t.cantidad);
+        metricas_contar((uint64_t)t.cantidad);
+        if (diario_activo(NIVEL_SOLICITUDES) && diario_reservar(t.cantidad)) { //Indica que recibio cada solicitud
+            uint8_t evento = t.tipo == MSG_CANCELAR ? EVENTO_CANCELACION : t.tipo == MSG_MODIFICAR ? EVENTO_MODIFICACION : EVENTO_SOLICITUD;
+            for (int i = 0; i < t.cantidad; i++) {
+                RegistroDiario r = { .tipo = evento, .parque = (uint8_t)t.sol[i].parque, .agente = t.id_agente,
+                                     .minuto = t.sol[i].inicio, .personas = t.sol[i].personas, .extra = (int32_t)t.sol[i].reserva };
+                memcpy(r.texto, t.sol[i].familia, MAX_NOMBRE);
+                diario_poner(&r);
+            }
+            diario_publicar();
+        }
+        if (t.sol[0].parque >= num_parques) { //Todo el trabajo es de un mismo parque (un lote no mezcla parques)
+            solicitudes_sin_parque += t.cantidad;
+            fprintf(stderr, "Error: %s pidio el parque %d, que no existe.\n", agente->nombre, t.sol[0].parque);
+            responder_sin_decidir(&t, agente, RESP_NEGADA);
+            return;
+        }
+        Parque* p = &parques[t.sol[0].parque]; //La solicitud pasa directo a la cola de su parque
+        t.encolado_ns = metricas_ahora();
+        t.plazo_ms = plazo_trabajo(&t); //Ordena la cola: lo que esta por pasar se decide primero
+        t.franja_llegada = franja_actual;
+        p->en_curso++; //Antes de encolar: un trabajador puede terminarlo de inmediato
+        int encolado = cola_meter(&p->cola, &t);
+        if (encolado != 0) p->en_curso--;
+        if (encolado == COLA_LLENA) { //Con -q: se rechaza ya, el agente reintenta en lugar de esperar detras de la cola
+            solicitudes_ocupado += t.cantidad;
+            responder_sin_decidir(&t, agente, RESP_OCUPADO);
+        } else if (encolado == -1) {
+            fprintf(stderr, "Error: no se pudo encolar la solicitud de %s.\n", agente->nombre);
+        }
+    } else if (cab->tipo == MSG_DISPONIBILIDAD) { //Una consulta se responde de inmediato
+        responder_consulta(cab, cuerpo, fd_origen);
+    }
+}
+
+static pthread_t hilos_trabajadores[MAX_TRABAJADORES]; //Hilos que deciden las reservas
+
+// Lanza los hilos trabajadores que deciden las reservas
+//El trabajador i atiende solo el parque i % num_parques, el mismo reparto que cuenta iniciar_parques
+void iniciar_trabajadores(void) {
+    for (int i = 0; i < num_trabajadores; i++) {
+        //Cada trabajador recibe la posicion de sus contadores (la 0 es la del hilo de eventos)
+        if (pthread_create(&hilos_trabajadores[i], NULL, trabajador, (void*)(intptr_t)(i + 1)) != 0) {
+            perror("pthread_create trabajador"); //Crea los hilos que deciden reservas
+            exit(1);
+        }
+    }
+}
+
+// Espera a que los trabajadores terminen lo pendiente
+void detener_trabajadores(void) {
+    for (int k = 0; k < num_parques; k++)
+        cola_cerrar(&parques[k].cola); //Ya no entran mas solicitudes
+    for (int i = 0; i < num_trabajadores; i++)
+        pthread_join(hilos_trabajadores[i], NULL);
+}
+
+//Anota en la bitacora el resultado de una solicitud o de un cambio (tipo), retorna la posicion a esperar (0 sin -b)
+static uint64_t anotar_decision(int tipo, const MsgSolicitud* sol, uint32_t agente, const MsgRespuesta* resp) {
+    RegistroBitacora reg = { .tipo = BIT_NEGADA, .codigo = tipo, .parque = sol->parque };
+    if (resp->codigo == RESP_CANCELADA) {
+        reg = (RegistroBitacora){ .tipo = BIT_CANCELADA, .reserva = resp->reserva, .parque = sol->parque };
+    } else if (resp->codigo == RESP_OK && tipo == MSG_MODIFICAR) {
+        reg = (RegistroBitacora){ .tipo = BIT_MODIFICADA, .reserva = resp->reserva, .minuto = resp->inicio,
+                                  .personas = sol->personas, .parque = sol->parque };
+    } else if (resp->codigo == RESP_OK || resp->codigo == RESP_REPROGRAMADA) {
+        reg.tipo = BIT_RESERVA;
+        reg.codigo = resp->codigo;
+        reg.minuto = resp->inicio; //El inicio asignado, no el pedido
+        reg.personas = sol->personas;
+        reg.agente = agente;
+        reg.reserva = resp->reserva;
+        strcpy(reg.nombre, sol->familia);
+    }
+    return bitacora_anotar(&reg);
+}
+
+//Con el nivel de decisiones, deja en el diario del trabajador la respuesta de una solicitud o de un cambio (tipo)
+static void anotar_en_diario(int tipo, const MsgSolicitud* sol, uint32_t agente, const MsgRespuesta* resp) {
+    if (!diario_activo(NIVEL_DECISIONES) || !diario_reservar(1)) return;
+    RegistroDiario r = { .tipo = EVENTO_DECISION, .parque = (uint8_t)sol->parque, .codigo = (uint8_t)resp->codigo,
+                         .agente = agente, .minuto = resp->inicio, .personas = sol->personas, .extra = (int32_t)resp->reserva };
+    if (tipo == MSG_CANCELAR) r.tipo = EVENTO_CANCELACION;
+    if (tipo == MSG_MODIFICAR) r.tipo = EVENTO_MODIFICACION;
+    memcpy(r.texto, resp->familia, MAX_NOMBRE); //En un cambio la familia la pone el controlador
+    diario_poner(&r);
+    diario_publicar();
+}
 
-        if (strlen(pipe_agente) > 0) //Si lo encontro le envia la respuesta
-            enviar_respuesta(pipe_agente, respuesta);
-        else //En caso contrario muestra un error
-            fprintf(stderr, "Error: no se encontró el agente %s para enviar respuesta.\n", p4);
+//Decide la solicitud i de un trabajo segun su tipo y la anota, retorna la posicion de bitacora a esperar
+//Se llama dentro de una seccion de la bitacora, asi la decision y su registro entran juntos a un punto de control
+static uint64_t decidir(Parque* p, Trabajo* t, int i, MsgRespuesta* resp) {
+    MsgSolicitud* sol = &t->sol[i];
+    if (t->tipo == MSG_CANCELAR) cancelar_reserva(p, sol, resp);
+    else if (t->tipo == MSG_MODIFICAR) modificar_reserva(p, sol, resp);
+    else {
+        CodigoRespuesta r = intentar_reserva(p, sol->familia, sol->inicio, sol->personas, t->id_agente, resp);
+        //Reprogramada o negada por hora pasada cuando llego a tiempo: el reloj avanzo mientras esperaba en la cola
+        if ((r == RESP_REPROGRAMADA || r == RESP_NEGADA_EXT) && sol->inicio >= calendario_minuto(&calendario, t->franja_llegada) &&
+            sol->inicio < calendario_minuto(&calendario, franja_actual))
+            vencidas_en_cola++;
     }
+    uint64_t posicion = anotar_decision(t->tipo, sol, t->id_agente, resp);
+    anotar_en_diario(t->tipo, sol, t->id_agente, resp);
+    return posicion;
 }
 
-// Registra un nuevo agente en el sistema
-//Registra un nuevo agente si todavia no ha alcanzado el maximo de agentes posibles
-int registrar_agente(char* nombre, char* pipe_resp) {
-    if (num_agentes >= MAX_AGENTES) return 0;
-    for (int i = 0; i < num_agentes; i++) //Recorre a los agntes para ver que no quede duplicado
-        if (strcmp(agentes[i].nombre, nombre) == 0) return 0;
+//Una solicitud de una ventana de admision: en que trabajo esta, su posicion en el y cuantas personas trae
+//Los cambios cuentan como el grupo mas grande: se deciden primero y lo que liberan ya lo pueden usar los demas
+typedef struct {
+    int trabajo, solicitud, personas;
+} SolicitudAdmision;
+
+//Primero los grupos grandes; entre iguales, la que llego antes
+static int comparar_admision(const void* a, const void* b) {
+    const SolicitudAdmision* x = a;
+    const SolicitudAdmision* y = b;
+    if (x->personas != y->personas) return y->personas - x->personas;
+    if (x->trabajo != y->trabajo) return x->trabajo - y->trabajo;
+    return x->solicitud - y->solicitud;
+}
 
-    strcpy(agentes[num_agentes].nombre, nombre); //Copia el nombre del agente al arreglo
-    strcpy(agentes[num_agentes].pipe_respuesta, pipe_resp); //Guarda el nombre del pipe usado para respuestas
-    agentes[num_agentes].activo = 1; //Indica que el agente esta activo
+//Decide juntas todas las solicitudes de una ventana de admision (-l), retorna la posicion de bitacora a esperar
+//Es un empaquetado de mayor a menor: los grupos grandes escogen primero, cuando todavia quedan bloques seguidos,
+//y los pequenos llenan los huecos; quien no cabe en su hora pasa al bloque libre mas cercano a ella
+static uint64_t decidir_ventana(Parque* p, Trabajo* trabajos, int n, MsgRespuesta respuestas[][MAX_LOTE]) {
+    static _Thread_local SolicitudAdmision orden[TRABAJOS_POR_VUELTA * MAX_LOTE];
+    int total = 0;
+    for (int k = 0; k < n; k++) {
+        metricas_registrar(ETAPA_COLA, trabajos[k].encolado_ns);
+        for (int i = 0; i < trabajos[k].cantidad; i++)
+            orden[total++] = (SolicitudAdmision){ k, i, trabajos[k].tipo == MSG_SOLICITUD ? trabajos[k].sol[i].personas : INT_MAX };
+    }
+    uint64_t inicio = metricas_ahora();
+    qsort(orden, total, sizeof(SolicitudAdmision), comparar_admision);
+    uint64_t posicion = 0;
+    bitacora_entrar(); //Toda la ventana entra junta a un punto de control
+    for (int j = 0; j < total; j++) {
+        MsgRespuesta* resp = &respuestas[orden[j].trabajo][orden[j].solicitud]; //Cada respuesta vuelve a su lugar en el lote
+        uint64_t pos = decidir(p, &trabajos[orden[j].trabajo], orden[j].solicitud, resp);
+        if (pos > posicion) posicion = pos;
+    }
+    bitacora_salir();
+    metricas_registrar(ETAPA_DECISION, inicio);
+    metricas_contar((uint64_t)total);
+    ventanas_admision++;
+    solicitudes_admision += total;
+    return posicion;
+}
+
+// Funcion ejecutada por cada hilo trabajador
+//Solo decide las reservas de su parque, asi los parques no comparten cerrojos ni cola entre si
+//Con -b saca varios trabajos por vuelta: los decide todos, espera una sola sincronizacion de la bitacora y responde
+//Con -l, despues del primer trabajo sigue juntando hasta que pasan admision_ms desde que se encolo y los decide juntos
+void* trabajador(void* arg) {
+    int indice = (int)(intptr_t)arg;
+    metricas_usar_hilo(indice);
+    diario_usar_hilo(indice);
+    Parque* p = &parques[(indice - 1) % num_parques]; //La posicion 0 de las metricas es la del hilo de eventos
+    static _Thread_local Trabajo trabajos[TRABAJOS_POR_VUELTA];
+    static _Thread_local MsgRespuesta respuestas[TRABAJOS_POR_VUELTA][MAX_LOTE]; //Respuestas que se le devuelven a cada agente
+    static _Thread_local uint8_t tramas[TRABAJOS_POR_VUELTA][MAX_TRAMA]; //Respuesta codificada de cada trabajo
+    int largos[TRABAJOS_POR_VUELTA];
+    //Sin bitacora ni ventana de admision no hay nada que esperar en grupo
+    int max = archivo_bitacora[0] != '\0' || admision_ms > 0 ? TRABAJOS_POR_VUELTA : 1;
+    int n;
+    while ((n = cola_sacar_varios(&p->cola, trabajos, max)) > 0) { //Hasta que la cola se cierre y quede vacia
+        uint64_t posicion = 0; //Hasta donde debe estar sincronizada la bitacora antes de responder
+        if (admision_ms > 0) {
+            uint64_t limite = trabajos[0].encolado_ns + (uint64_t)admision_ms * 1000000ULL;
+            if (n < max) n += cola_sacar_hasta(&p->cola, trabajos + n, max - n, limite);
+            posicion = decidir_ventana(p, trabajos, n, respuestas);
+        } else {
+            for (int k = 0; k < n; k++) {
+                Trabajo* t = &trabajos[k];
+                metricas_registrar(ETAPA_COLA, t->encolado_ns);
+                uint64_t inicio = metricas_ahora();
+                bitacora_entrar(); //Cada decision y su registro entran juntos a un punto de control
+                for (int i = 0; i < t->cantidad; i++) { //Llama la funcion de rservas para cada solicitud
+                    uint64_t pos = decidir(p, t, i, &respuestas[k][i]);
+                    if (pos > posicion) posicion = pos;
+                }
+                bitacora_salir();
+                metricas_registrar(ETAPA_DECISION, inicio);
+                metricas_contar((uint64_t)t->cantidad);
+            }
+        }
+        for (int k = 0; k < n; k++) { //Un lote se responde en una sola trama
+            Trabajo* t = &trabajos[k];
+            largos[k] = t->lote ? codificar_respuesta_lote(tramas[k], respuestas[k], t->ids, t->cantidad)
+                                : codificar_respuesta(tramas[k], t->ids[0], &respuestas[k][0]);
+        }
+        uint64_t inicio = metricas_ahora();
+        bitacora_esperar(posicion); //Lo que se le confirma a los agentes ya sobrevive a una caida
+        if (posicion > 0) metricas_registrar(ETAPA_BITACORA, inicio);
+        for (int k = 0; k < n; k++) {
+            inicio = metricas_ahora();
+            enviar_respuesta(&agentes[trabajos[k].id_agente], tramas[k], largos[k]); //Le envia la respuesta
+            metricas_registrar(ETAPA_RESPUESTA, inicio);
+            if (--p->en_curso == 0 && reloj_virtual) { //Era lo ultimo del parque: el hilo de eventos revisa si la franja termino
+                uint64_t uno = 1;
+                if (write(fd_decididas, &uno, sizeof(uno)) == -1) perror("write eventfd");
+            }
+        }
+    }
+    pthread_exit(NULL);
+}
+
+//Tabla hash de direccionamiento abierto: guarda id + 1 y 0 significa espacio vacio
+static int32_t tabla_agentes[TAM_TABLA_AGENTES];
+
+//Hash FNV-1a del nombre
+static uint32_t hash_nombre(const char* nombre) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)nombre; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Busca un agente por nombre en la tabla hash, retorna su id o -1
+//Solo la usa el hilo de eventos, que es el unico que registra agentes
+int buscar_agente(const char* nombre) {
+    for (uint32_t i = hash_nombre(nombre) & (TAM_TABLA_AGENTES - 1);; i = (i + 1) & (TAM_TABLA_AGENTES - 1)) {
+        int32_t v = tabla_agentes[i];
+        if (v == 0) return -1; //Espacio vacio: el nombre no esta
+        if (strcmp(agentes[v - 1].nombre, nombre) == 0) return v - 1;
+    }
+}
+
+//Agrega un agente inactivo con el siguiente id y lo pone en la tabla hash, retorna su id
+static int agregar_agente(const char* nombre) {
+    int id = num_agentes;
+    Agente* a = &agentes[id];
+    strcpy(a->nombre, nombre); //Copia el nombre del agente al arreglo
+    a->fd_respuesta = -1; //Sin pipe hasta que se registre
+    pthread_mutex_init(&a->cerrojo, NULL); //Cerrojo para las respuestas concurrentes
+    uint32_t i = hash_nombre(nombre) & (TAM_TABLA_AGENTES - 1);
+    while (tabla_agentes[i] != 0) i = (i + 1) & (TAM_TABLA_AGENTES - 1);
+    tabla_agentes[i] = id + 1;
     num_agentes++; //Aumenta el numero de agentes
-    //Le confirma que quedo registrado y le envia la hora actual
-    char msg[50];
-    sprintf(msg, "HORA|%d", hora_actual);
-    enviar_respuesta(pipe_resp, msg);
-    return 1;
+    return id;
+}
+
+// Registra un nuevo agente en el sistema, retorna su id o -1 si no se pudo
+//Un nombre que ya esta activo se rechaza; si esta inactivo (el agente termino) se reutiliza su id
+int registrar_agente(char* nombre, char* pipe_resp, int fd_conexion) {
+    int id = buscar_agente(nombre); //Revisa en la tabla que no quede duplicado
+    if (id != -1 && agentes[id].activo) return -1;
+    if (id == -1 && num_agentes >= MAX_AGENTES) return -1;
+
+    //Abre el pipe una sola vez y sin bloquear: el agente ya lo tiene abierto para lectura
+    //Con -x shm se mapea el anillo de respuestas que creo el agente
+    //Con -x unix se responde por la misma conexion del registro
+    int fd = -1;
+    AnilloShm* anillo = NULL;
+    if (fd_conexion >= 0) fd = fd_conexion;
+    else if (transporte == TRANSPORTE_SHM) anillo = anillo_abrir(pipe_resp);
+    else fd = open(pipe_resp, O_WRONLY | O_NONBLOCK);
+    if (fd == -1 && !anillo) {
+        fprintf(stderr, "Error: no se pudo abrir el pipe %s del agente %s: %s\n", pipe_resp, nombre, strerror(errno));
+        return -1;
+    }
+
+    if (id == -1) { //Agente nuevo: toma el siguiente id y queda anotado para conservarlo despues de una caida
+        bitacora_entrar();
+        id = agregar_agente(nombre);
+        RegistroBitacora reg = { .tipo = BIT_AGENTE, .agente = (uint32_t)id };
+        strcpy(reg.nombre, nombre);
+        bitacora_anotar(&reg);
+        bitacora_salir();
+    }
+    Agente* a = &agentes[id];
+    contar_cierre(a); //Un cierre pendiente de la vez anterior se cuenta antes de volver a contarlo como activo
+    pthread_mutex_lock(&a->cerrojo);
+    strcpy(a->pipe_respuesta, pipe_resp); //Guarda el nombre del pipe usado para respuestas
+    a->fd_respuesta = fd; //Guarda el descriptor abierto
+    a->anillo = anillo;
+    a->activo = 1; //Indica que el agente esta activo
+    a->fin_envio = 0; //Desde ahora puede enviar solicitudes
+    agentes_sin_fin++;
+    pthread_mutex_unlock(&a->cerrojo);
+    //Le confirma que quedo registrado y le envia el instante actual junto con su id
+    uint8_t trama[MAX_TRAMA];
+    int len = codificar_hora(trama, 0, calendario_minuto(&calendario, franja_actual), (uint32_t)id);
+    enviar_respuesta(a, trama, len);
+    return id;
+}
+
+//Avisa de un problema con un agente por el diario, sin escribir en stderr desde un trabajador
+//Despues de diario_detener (terminar_agentes) el diario ya no escribe y el aviso va directo a stderr
+static void avisar(const char* formato, ...) {
+    char aviso[2 * MAX_NOMBRE + 128];
+    va_list args;
+    va_start(args, formato);
+    int largo = vsnprintf(aviso, sizeof(aviso), formato, args);
+    va_end(args);
+    if (largo < 0) return;
+    if ((size_t)largo >= sizeof(aviso)) largo = (int)sizeof(aviso) - 1;
+    if (diario_activo(NIVEL_SILENCIO)) diario_texto(NIVEL_SILENCIO, aviso, (size_t)largo);
+    else fputs(aviso, stderr);
+}
+
+//Despierta al hilo de eventos para que vea cierres o pedidos de vigilancia nuevos
+static void despertar_eventos(void) {
+    uint64_t uno = 1;
+    if (write(fd_decididas, &uno, sizeof(uno)) == -1) perror("write eventfd");
+}
+
+//Escribe una trama completa por el canal del agente sin bloquear; -1 con errno EAGAIN si no cabe
+static int escribir_canal(Agente* agente, const uint8_t* trama, int len) {
+    return agente->anillo ? anillo_meter_unico(agente->anillo, trama, len) //El cerrojo del agente lo deja con un solo productor
+                          : escribir_trama(agente->fd_respuesta, trama, len);
+}
+
+//Escribe en orden las respuestas guardadas hasta terminarlas o llenar el canal, con su cerrojo tomado
+//Retorna 0 (si quedan, errno queda en EAGAIN) o -1 si el canal fallo por otra razon
+static int vaciar_pendiente(Agente* agente) {
+    size_t hecho = 0;
+    int r = 0;
+    while (hecho < agente->pendiente_largo) {
+        uint16_t largo;
+        memcpy(&largo, agente->pendiente + hecho, sizeof(largo));
+        if (escribir_canal(agente, agente->pendiente + hecho + sizeof(largo), largo) == -1) {
+            r = errno == EAGAIN ? 0 : -1;
+            break;
+        }
+        hecho += sizeof(largo) + largo;
+    }
+    int error = errno;
+    if (hecho > 0) { //Lo que falta pasa al principio
+        agente->pendiente_largo -= hecho;
+        memmove(agente->pendiente, agente->pendiente + hecho, agente->pendiente_largo);
+    }
+    errno = error;
+    return r;
+}
+
+//Guarda una respuesta que no cupo detras de las anteriores, con su cerrojo tomado; -1 si el agente ya acumula demasiadas
+static int guardar_pendiente(Agente* agente, const uint8_t* trama, int len) {
+    uint16_t largo = (uint16_t)len;
+    size_t necesario = agente->pendiente_largo + sizeof(largo) + (size_t)len;
+    if (necesario > MAX_PENDIENTE_AGENTE) return -1;
+    if (necesario > agente->pendiente_capacidad) {
+        size_t capacidad = agente->pendiente_capacidad ? agente->pendiente_capacidad : MAX_TRAMA * 16;
+        while (capacidad < necesario) capacidad *= 2;
+        if (capacidad > MAX_PENDIENTE_AGENTE) capacidad = MAX_PENDIENTE_AGENTE;
+        uint8_t* nuevo = realloc(agente->pendiente, capacidad);
+        if (!nuevo) return -1;
+        agente->pendiente = nuevo;
+        agente->pendiente_capacidad = capacidad;
+    }
+    int primera = agente->pendiente_largo == 0;
+    memcpy(agente->pendiente + agente->pendiente_largo, &largo, sizeof(largo));
+    memcpy(agente->pendiente + agente->pendiente_largo + sizeof(largo), trama, (size_t)len);
+    agente->pendiente_largo = necesario;
+    if (primera) { //El hilo de eventos empieza a esperar espacio en su canal
+        atomic_store(&agente->vigilar_pedido, 1);
+        atomic_store(&hay_pendientes, 1);
+        despertar_eventos();
+    }
+    return 0;
+}
+
+//Escribe lo guardado para el agente desde el hilo de eventos, con su cerrojo tomado; retorna 1 si todavia le quedan
+static int vaciar_agente(Agente* agente) {
+    if (vaciar_pendiente(agente) == -1) {
+        if (!agente->fin_envio || errno != EPIPE) //Uno que ya termino su archivo pudo haber salido
+            avisar("Aviso: el agente %s ya no esta disponible (%s).\n", agente->nombre, strerror(errno));
+        abandonar_agente(agente);
+        return 0;
+    }
+    if (agente->pendiente_largo > 0) return 1;
+    if (agente->despedido) cerrar_agente(agente); //Ya se le escribio el MSG_TERMINAR y ya se conto como terminado
+    return 0;
+}
+
+//El agente acumulo MAX_PENDIENTE_AGENTE sin leer: se le deja de responder y se cuenta como terminado, con su cerrojo tomado
+//Cerrar su anillo o su conexion hace que su receptor vea el fin; su pipe lo mantiene abierto el propio agente,
+//asi que lo no leido se descarta y solo queda un MSG_TERMINAR que se le escribe en cuanto lea
+static void despedir_agente(Agente* agente) {
+    avisar("Aviso: el agente %s no lee sus respuestas, se le deja de responder.\n", agente->nombre);
+    if (agente->anillo) anillo_cerrar(agente->anillo);
+    if (agente->anillo || transporte == TRANSPORTE_UNIX) {
+        abandonar_agente(agente);
+        return;
+    }
+    uint8_t trama[MAX_TRAMA];
+    int len = codificar_vacio(trama, MSG_TERMINAR, 0);
+    agente->pendiente_largo = 0;
+    guardar_pendiente(agente, trama, len); //Cabe: se acaba de vaciar
+    agente->despedido = 1;
+    atomic_store(&agente->cierre_sin_contar, 1);
+    atomic_store(&hay_cierres, 1);
+    despertar_eventos();
+}
+
+//Escribe una trama al agente; avisar_fin en 0 calla el aviso de un agente que ya no esta (EPIPE), que es lo esperado
+//cuando el agente envio MSG_FIN_SOLICITUDES y termino antes de que acabe la simulacion
+//Si el canal esta lleno la trama se guarda y sale, en orden, cuando el agente lea; nunca se descarta
+static int enviar_trama(Agente* agente, const uint8_t* trama, int len, int avisar_fin) {
+    if (len <= 0) return -1; //La trama no se pudo codificar
+    int resultado = -1;
+    pthread_mutex_lock(&agente->cerrojo); //Otro hilo no puede cerrar el descriptor mientras se escribe
+    if (!agente->activo || agente->despedido) { //El agente ya no esta o ya se le pidio terminar
+        resultado = -1;
+    } else if (vaciar_pendiente(agente) == 0 && agente->pendiente_largo == 0 && escribir_canal(agente, trama, len) == 0) {
+        resultado = 0; //Sin nada guardado antes, se escribe directo
+    } else if (errno == EAGAIN) { //El canal esta lleno o quedan respuestas anteriores: va detras de ellas
+        if (guardar_pendiente(agente, trama, len) == 0) resultado = 0;
+        else despedir_agente(agente);
+    } else { //EPIPE u otro error: el agente cerro su canal o termino
+        if (avisar_fin || errno != EPIPE)
+            avisar("Aviso: el agente %s ya no esta disponible (%s).\n", agente->nombre, strerror(errno));
+        abandonar_agente(agente);
+    }
+    pthread_mutex_unlock(&agente->cerrojo);
+    return resultado;
 }
 
 // Envia una respuesta a un agente mediante su pipe especifico
-void enviar_respuesta(char* pipe_resp, char* msg) {
-    int fd = open(pipe_resp, O_WRONLY); //Abre el pipe
-    if (fd != -1) { //Si logra abrirlo escribe un mensaje
-        write(fd, msg, strlen(msg));
-        close(fd); //Cierra el pipe
-    }
-}
-
-// Intenta reservar basado en la disponibilidad del parque
-int intentar_reserva(char* familia, int hora, int personas, char* agente, char* resp) {
-    if (personas > aforo_max) { //Revisa que todavia se pueden meter mas personas
-        sprintf(resp, "NEGADA|%s", familia); //Como ya esta lleno la niega
-        solicitudes_negadas++; //Aumenta el contador de solicitudes negadas
-        return 4;
-    }
-    //Si la hora ya paso lo re agenda
-    if (hora < hora_actual) {
-        int nueva; //para la nueva hora
-        if (buscar_bloque_libre(personas, &nueva)) { //Busca dos horas libres
-            Reserva r = { "", nueva, personas, "" }; //Crea una nueva reserva
-            strcpy(r.familia, familia); //Pone en la nueva rserva el nombre de la familia
-            strcpy(r.agente, agente); //Pone en la nueva rserva el nombre del agente
-            parque[nueva].reservas[parque[nueva].num_reservas++] = r; //Anade la nueva rserva
-            if (nueva + 1 <= 19) //Como las reservas son dos horas, la siguiente
-                parque[nueva + 1].reservas[parque[nueva + 1].num_reservas++] = r; 
-            parque[nueva].ocupacion += personas; //Aumenta la ocupacion
-            if (nueva + 1 <= 19)
-                parque[nueva + 1].ocupacion += personas;
-            sprintf(resp, "REPROGRAMADA|%s|%d", familia, nueva);
-            solicitudes_reprogramadas++; //Incrementa el contador de reprogramadas
-            return 2;
+int enviar_respuesta(Agente* agente, const uint8_t* trama, int len) {
+    return enviar_trama(agente, trama, len, 1);
+}
+
+//Cierra un agente al que no se le pudo escribir y le avisa al hilo de eventos, que lleva la cuenta de los que
+//pueden enviar; se llama con su cerrojo tomado, tambien desde los trabajadores
+static void abandonar_agente(Agente* agente) {
+    cerrar_agente(agente);
+    atomic_store(&agente->cierre_sin_contar, 1);
+    atomic_store(&hay_cierres, 1);
+    despertar_eventos();
+}
+
+//Cierra el descriptor del agente y descarta lo que se le habia guardado, se llama con su cerrojo tomado
+static void cerrar_agente(Agente* agente) {
+    //Una conexion solo la cierra el hilo de eventos (cerrar_conexion); aqui se corta y su recv vera el fin
+    if (agente->fd_respuesta != -1 && transporte == TRANSPORTE_UNIX) shutdown(agente->fd_respuesta, SHUT_RDWR);
+    else if (agente->fd_respuesta != -1) close(agente->fd_respuesta);
+    agente->fd_respuesta = -1;
+    anillo_liberar(agente->anillo); //El agente borra su propio anillo, aqui solo se quita el mapeo
+    agente->anillo = NULL;
+    free(agente->pendiente);
+    agente->pendiente = NULL;
+    agente->pendiente_largo = agente->pendiente_capacidad = 0;
+    agente->despedido = 0;
+    agente->activo = 0;
+}
+
+// Cierra el pipe de un agente y lo marca como inactivo
+void desactivar_agente(Agente* agente) {
+    pthread_mutex_lock(&agente->cerrojo);
+    cerrar_agente(agente);
+    pthread_mutex_unlock(&agente->cerrojo);
+}
+
+//Franja del calendario en que empieza un dia y ultima en que puede empezar una reserva del parque ese dia
+static void inicios_del_dia(const Parque* p, int dia, int* base, int* ultimo_inicio) {
+    *base = dia * calendario.franjas_dia;
+    *ultimo_inicio = *base + p->ultima - largo_reserva() + 1; //La estadia termina, a mas tardar, al cierre
+}
+
+//Franja en que empezaria una estadia pedida para ese minuto, o -1 si cae fuera del horario del parque,
+//despues del ultimo dia o mas alla de la ventana; ahora es la franja actual, que quien llama ya comparo con el minuto
+static int franja_admitida(const Parque* p, int inicio, int ahora) {
+    int franja = calendario_franja(&calendario, inicio); //-1 si cae fuera del horario del dia
+    if (franja == -1) return -1;
+    int dia = calendario_dia(&calendario, franja);
+    int base, ultimo_inicio;
+    inicios_del_dia(p, dia, &base, &ultimo_inicio);
+    if (franja < base + p->primera || franja > ultimo_inicio ||
+        dia >= calendario.dias || dia >= calendario_dia(&calendario, ahora) + calendario.dias_ventana) return -1;
+    return franja;
+}
+
+// Intenta reservar basado en la disponibilidad del parque, retorna el codigo que dejo en la respuesta
+//La llaman los trabajadores del parque a la vez: cada reserva se confirma con los cerrojos de sus franjas
+//inicio es el minuto pedido; uno que cae a mitad de una franja se atiende en esa franja
+CodigoRespuesta intentar_reserva(Parque* p, char* familia, int inicio, int personas, uint32_t agente, MsgRespuesta* resp) {
+    strcpy(resp->familia, familia); //La respuesta siempre lleva el nombre de la familia
+    resp->inicio = inicio;
+    resp->reserva = SIN_ID_RESERVA; //Solo una reserva aceptada tiene id
+    Reserva r = { "", 0, personas, agente, SIN_ID_RESERVA, 0 }; //Crea la resrva con el id del agente; reservar_bloque le da su propio id
+    strcpy(r.familia, familia); //Anade a la familia
+    int ahora = franja_actual; //Toda la decision usa la misma franja aunque el reloj avance
+
+    if (personas > p->aforo) { //Revisa que todavia se pueden meter mas personas
+        resp->codigo = RESP_NEGADA; //Como ya esta lleno la niega
+        p->negadas++; //Aumenta el contador de solicitudes negadas
+        return RESP_NEGADA;
+    }
+    //Si la hora ya paso lo re agenda, desde la franja actual
+    if (inicio < calendario_minuto(&calendario, ahora)) {
+        if (reprogramar(p, &r, ahora, -1)) { //Busca un bloque libre y lo reserva
+            resp->codigo = RESP_REPROGRAMADA;
+            resp->inicio = calendario_minuto(&calendario, r.franja_inicio);
+            resp->reserva = r.id;
+            p->reprogramadas++; //Incrementa el contador de reprogramadas
+            return RESP_REPROGRAMADA;
         } else {
-            sprintf(resp, "NEGADA_EXT|%s", familia); //Mensaje de rechazo
-            solicitudes_negadas++; //Aumenta el contador de rechazos
-            return 3;
+            resp->codigo = RESP_NEGADA_EXT; //Mensaje de rechazo
+            p->negadas++; //Aumenta el contador de rechazos
+            return RESP_NEGADA_EXT;
         }
     }
 
-    if (hora + 1 > hora_fin) { //Si la hora no esta dentro dle horario de atencion
-        sprintf(resp, "NEGADA|%s", familia); //La rechaza, aumenta el contador y muetsra el mensaje de error
-        solicitudes_negadas++;
-        return 4;
+    int franja = franja_admitida(p, inicio, ahora);
+    //Fuera del horario del parque, despues del ultimo dia o mas alla de la ventana: se niega
+    if (franja == -1) {
+        resp->codigo = RESP_NEGADA; //La rechaza, aumenta el contador y muetsra el mensaje de error
+        p->negadas++;
+        return RESP_NEGADA;
     }
+    int dia = calendario_dia(&calendario, franja);
+    int base = dia * calendario.franjas_dia;
+    r.franja_inicio = franja;
+    resp->inicio = calendario_minuto(&calendario, franja);
     //Si hay espacio a la hora que pidieron
-    if (parque[hora].ocupacion + personas <= aforo_max &&
-        parque[hora + 1].ocupacion + personas <= aforo_max) {
-        Reserva r = { "", hora, personas, "" }; //Crea la resrva
-        strcpy(r.familia, familia); //Anade a la familia
-        strcpy(r.agente, agente); //Anade al agente
-        parque[hora].reservas[parque[hora].num_reservas++] = r;
-        if (hora + 1 <= 19) //Tambien lo anade para la segunda hora de la reserva
-            parque[hora + 1].reservas[parque[hora + 1].num_reservas++] = r; 
-        parque[hora].ocupacion += personas; //Actualiza la ocupacion en esa hora
-        if (hora + 1 <= 19)
-            parque[hora + 1].ocupacion += personas; //Actualiza la ocupacion en esa hora
-        sprintf(resp, "OK|%s|%d", familia, hora);
-        solicitudes_aceptadas++; //Aumenta el contador de solicitudes esperadas
-        return 1;
-    } else {
-        int nueva;
-        if (buscar_bloque_libre(personas, &nueva)) { //Busca otras horas
-            Reserva r = { "", nueva, personas, "" }; //Crea una nueva rserva
-            strcpy(r.familia, familia); //Anade a la familia
-            strcpy(r.agente, agente); //Anade al agente
-            parque[nueva].reservas[parque[nueva].num_reservas++] = r; //Guarda la reserva
-            if (nueva + 1 <= 19)
-                parque[nueva + 1].reservas[parque[nueva + 1].num_reservas++] = r;
-            parque[nueva].ocupacion += personas; //Actualiza la ocupacion
-            if (nueva + 1 <= 19)
-                parque[nueva + 1].ocupacion += personas;
-            sprintf(resp, "REPROGRAMADA|%s|%d", familia, nueva);
-            solicitudes_reprogramadas++; //Aumenta las reprogamadas
-            return 2;
-        } else { //Si no lo logro, la rechaza
-            sprintf(resp, "NEGADA|%s", familia);
-            solicitudes_negadas++; //Aumenta el contador de negadas
-            return 4;
-        }
-    }
-}
-
-// Busca un bloque libre para reprogramar una reserva
-int buscar_bloque_libre(int personas, int* nueva_hora) {
-    for (int h = hora_actual; h <= hora_fin - 1 && h + 1 <= 19; h++) { //Recorre las horas
-        if (parque[h].ocupacion + personas <= aforo_max && //Si hay una y la siguiente libres la asigna
-            parque[h + 1].ocupacion + personas <= aforo_max) {
-            *nueva_hora = h;
-            return 1;
-        }
+    if (reservar_bloque(p, franja, &r)) {
+        resp->codigo = RESP_OK;
+        resp->reserva = r.id;
+        p->aceptadas++; //Aumenta el contador de solicitudes esperadas
+        return RESP_OK;
+    //Busca otras horas del mismo dia; con -l, la mas cercana a la pedida para no mover de mas a nadie
+    } else if (reprogramar(p, &r, calendario_dia(&calendario, ahora) == dia ? ahora : base, admision_ms > 0 ? franja : -1)) {
+        resp->codigo = RESP_REPROGRAMADA;
+        resp->inicio = calendario_minuto(&calendario, r.franja_inicio);
+        resp->reserva = r.id;
+        p->reprogramadas++; //Aumenta las reprogamadas
+        return RESP_REPROGRAMADA;
+    } else { //Si no lo logro, la rechaza
+        resp->codigo = RESP_NEGADA;
+        p->negadas++; //Aumenta el contador de negadas
+        return RESP_NEGADA;
+    }
+}
+
+//Busca y reserva el primer bloque libre desde una franja, deja en r la franja asignada
+//Con pedida >= 0 prueba antes el bloque mas cercano a ella; si otro trabajador se lo gana, sigue con el primero libre
+static int reprogramar(Parque* p, Reserva* r, int desde, int pedida) {
+    int nueva;
+    if (pedida >= 0 && buscar_bloque_cercano(p, r->personas, desde, pedida, &nueva)) {
+        r->franja_inicio = nueva;
+        if (reservar_bloque(p, nueva, r)) return 1;
+    }
+    //Otro trabajador puede ocupar el bloque entre la busqueda y la reserva, en ese caso se sigue buscando
+    while (buscar_bloque_libre(p, r->personas, desde, &nueva)) {
+        r->franja_inicio = nueva;
+        if (reservar_bloque(p, nueva, r)) return 1;
+        desde = nueva + 1;
     }
     return 0;
 }
 
+//Toma en orden ascendente los cerrojos de dos estadias que empiezan en las posiciones a y b de la ventana
+//Si se cruzan, las franjas comunes se toman una sola vez; con a == b es una sola estadia
+static void tomar_estadias(Parque* p, int a, int b) {
+    int largo = largo_reserva();
+    int menor = a < b ? a : b, mayor = a < b ? b : a;
+    for (int f = menor; f < menor + largo; f++) //Siempre en orden ascendente para no tener interbloqueos
+        pthread_mutex_lock(&p->franjas[f].cerrojo);
+    for (int f = mayor > menor + largo ? mayor : menor + largo; f < mayor + largo; f++)
+        pthread_mutex_lock(&p->franjas[f].cerrojo);
+}
+
+//Suelta lo que tomo tomar_estadias, en orden descendente
+static void soltar_estadias(Parque* p, int a, int b) {
+    int largo = largo_reserva();
+    int menor = a < b ? a : b, mayor = a < b ? b : a;
+    for (int f = mayor + largo - 1; f >= (mayor > menor + largo ? mayor : menor + largo); f--)
+        pthread_mutex_unlock(&p->franjas[f].cerrojo);
+    for (int f = menor + largo - 1; f >= menor; f--)
+        pthread_mutex_unlock(&p->franjas[f].cerrojo);
+}
+
+//Id de la siguiente reserva del parque: su propia secuencia con el parque en los bits bajos
+static uint32_t nuevo_id(Parque* p) {
+    return (atomic_fetch_add(&p->siguiente_reserva, 1) << BITS_PARQUE_RESERVA) | (uint32_t)p->id;
+}
+
+//Guarda una reserva en el almacen de su dia, en la lista de su franja de inicio y en la tabla de ids; no toca la ocupacion
+//Se llama con los cerrojos de su estadia tomados, o al recuperar antes de que haya otros hilos. Retorna 1 o 0 si no hay memoria
+static int guardar_reserva(Parque* p, const Reserva* r) {
+    DiaParque* d = dia_en(p, r->franja_inicio);
+    uint32_t indice = almacen_guardar(&d->almacen, r); //La reserva se guarda una sola vez
+    //La franja de inicio solo guarda el indice; la salida se calcula con DURACION_RESERVA
+    if (indice == SIN_RESERVA || lista_agregar(&franja_en(p, r->franja_inicio)->entradas, indice) == -1) return 0;
+    if (tabla_poner(&p->reservas, r->id, r->franja_inicio, indice) == -1) {
+        almacen_obtener(&d->almacen, indice)->cancelada = 1; //Ya esta en la lista: se deja como si se hubiera cancelado
+        return 0;
+    }
+    return 1;
+}
+
+// Reserva las franjas de DURACION_RESERVA desde una franja si todavia hay cupo, retorna 1 si lo logro
+//Quien la llama garantiza que la estadia termina el mismo dia, asi sus franjas quedan seguidas en la ventana
+//Si la logra le asigna a r su id
+int reservar_bloque(Parque* p, int franja, Reserva* r) {
+    int desde = calendario_posicion(&calendario, franja);
+    int hasta = desde + largo_reserva() - 1; //Ultima franja de la estadia
+    DiaParque* d = dia_en(p, franja);
+    tomar_estadias(p, desde, desde);
+    //Con los cerrojos de estas franjas tomados nadie mas puede cambiar su ocupacion en el indice ni reciclar su dia
+    int cabe = d->dia == calendario_dia(&calendario, franja) && //El dia pudo reciclarse mientras se decidia
+               indice_maximo(&p->indice, desde, hasta) + r->personas <= p->aforo;
+    if (cabe) {
+        r->id = nuevo_id(p);
+        cabe = guardar_reserva(p, r);
+        if (cabe)
+            ajustar_ocupacion(p, desde, hasta, r->personas); //Actualiza la ocupacion y el indice
+    }
+    soltar_estadias(p, desde, desde);
+    return cabe;
+}
+
+//Reserva guardada con ese id si sigue viva en esa franja e indice, o NULL; se llama con los cerrojos de su estadia tomados
+//Como cancelar, modificar y reciclar el dia toman esos mismos cerrojos, lo que se encuentre no cambia hasta soltarlos
+static Reserva* reserva_vigente(Parque* p, uint32_t id, int franja, uint32_t indice) {
+    DiaParque* d = dia_en(p, franja);
+    int franja_tabla;
+    uint32_t indice_tabla;
+    if (d->dia != calendario_dia(&calendario, franja) || !tabla_buscar(&p->reservas, id, &franja_tabla, &indice_tabla) ||
+        franja_tabla != franja || indice_tabla != indice) return NULL; //Se cancelo, se movio o su dia ya paso
+    return almacen_obtener(&d->almacen, indice);
+}
+
+//Quita una reserva viva: libera sus franjas, la marca para que las listas la salten y saca su id de la tabla
+//Se llama con los cerrojos de su estadia tomados
+static void quitar_reserva(Parque* p, Reserva* r) {
+    int desde = calendario_posicion(&calendario, r->franja_inicio);
+    ajustar_ocupacion(p, desde, desde + largo_reserva() - 1, -r->personas);
+    r->cancelada = 1;
+    tabla_quitar(&p->reservas, r->id);
+}
+
+// Cancela una reserva del agente que la pide si su estadia no ha empezado, retorna el codigo de la respuesta
+//La tabla de ids da su franja sin recorrer nada; las dos horas de la estadia se liberan con sus cerrojos tomados
+int cancelar_reserva(Parque* p, const MsgSolicitud* sol, MsgRespuesta* resp) {
+    resp->codigo = RESP_NEGADA; //Id desconocido, de otro agente o de una estadia que ya empezo
+    resp->inicio = 0;
+    resp->reserva = sol->reserva;
+    resp->familia[0] = '\0';
+    int franja;
+    uint32_t indice;
+    if (tabla_buscar(&p->reservas, sol->reserva, &franja, &indice)) {
+        int desde = calendario_posicion(&calendario, franja);
+        tomar_estadias(p, desde, desde);
+        Reserva* r = reserva_vigente(p, sol->reserva, franja, indice);
+        if (r && r->agente == sol->id_agente && franja >= franja_actual) {
+            strcpy(resp->familia, r->familia);
+            resp->inicio = calendario_minuto(&calendario, franja);
+            quitar_reserva(p, r);
+            resp->codigo = RESP_CANCELADA;
+        }
+        soltar_estadias(p, desde, desde);
+    }
+    if (resp->codigo == RESP_CANCELADA) p->canceladas++;
+    else p->cambios_negados++;
+    return resp->codigo;
+}
+
+// Mueve una reserva del agente a otro inicio o con otras personas, todo o nada; retorna el codigo de la respuesta
+//Toma juntos los cerrojos de la estadia vieja y de la nueva, descuenta la vieja y prueba la nueva en la hora pedida:
+//si cabe queda con el mismo id, si no se devuelve la vieja tal cual y se niega. No se reprograma a otra hora
+int modificar_reserva(Parque* p, const MsgSolicitud* sol, MsgRespuesta* resp) {
+    resp->codigo = RESP_NEGADA;
+    resp->inicio = sol->inicio;
+    resp->reserva = sol->reserva;
+    resp->familia[0] = '\0';
+    int ahora = franja_actual;
+    int franja, nueva;
+    uint32_t indice;
+    if (sol->personas > 0 && sol->personas <= p->aforo && sol->inicio >= calendario_minuto(&calendario, ahora) &&
+        (nueva = franja_admitida(p, sol->inicio, ahora)) != -1 && tabla_buscar(&p->reservas, sol->reserva, &franja, &indice)) {
+        int desde = calendario_posicion(&calendario, franja), nueva_desde = calendario_posicion(&calendario, nueva);
+        int largo = largo_reserva();
+        tomar_estadias(p, desde, nueva_desde);
+        Reserva* r = reserva_vigente(p, sol->reserva, franja, indice);
+        if (r && r->agente == sol->id_agente && franja >= ahora) {
+            strcpy(resp->familia, r->familia);
+            ajustar_ocupacion(p, desde, desde + largo - 1, -r->personas); //La estadia vieja no compite con la nueva
+            Reserva movida = *r;
+            movida.franja_inicio = nueva;
+            movida.personas = sol->personas;
+            if (dia_en(p, nueva)->dia == calendario_dia(&calendario, nueva) &&
+                indice_maximo(&p->indice, nueva_desde, nueva_desde + largo - 1) + sol->personas <= p->aforo &&
+                guardar_reserva(p, &movida)) { //La tabla ya apunta a la copia nueva
+                r->cancelada = 1;
+                ajustar_ocupacion(p, nueva_desde, nueva_desde + largo - 1, sol->personas);
+                resp->codigo = RESP_OK;
+                resp->inicio = calendario_minuto(&calendario, nueva);
+            } else {
+                ajustar_ocupacion(p, desde, desde + largo - 1, r->personas); //Vuelve a quedar como estaba
+            }
+        }
+        soltar_estadias(p, desde, nueva_desde);
+    }
+    if (resp->codigo == RESP_OK) p->modificadas++;
+    else p->cambios_negados++;
+    return resp->codigo;
+}
+
+// Suma delta a la ocupacion de las posiciones [desde, hasta] de la ventana y al indice, con sus cerrojos tomados
+//El cambio queda entre las dos marcas del seqlock: una consulta que lo cruce vuelve a leer
+void ajustar_ocupacion(Parque* p, int desde, int hasta, int delta) {
+    atomic_fetch_add_explicit(&p->escrituras_empezadas, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); //La marca se ve antes que cualquier ocupacion nueva
+    for (int f = desde; f <= hasta; f++)
+        atomic_fetch_add_explicit(&p->franjas[f].ocupacion, delta, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->escrituras_terminadas, 1, memory_order_release);
+    indice_sumar(&p->indice, desde, hasta, delta);
+}
+
+//Lee una vez las franjas consultadas; la ocupacion se lee suelta y consultar_disponibilidad valida la foto completa
+static void leer_disponibilidad(Parque* p, const MsgConsulta* c, int primera, int limite, MsgDisponibilidad* resp) {
+    int largo = largo_reserva();
+    resp->cantidad = 0;
+    for (int f = primera; f < limite && resp->cantidad < MAX_FRANJAS_CONSULTA; f++) {
+        int en_dia = f % calendario.franjas_dia;
+        if (en_dia < p->primera || en_dia > p->ultima) continue; //El parque esta cerrado en esa franja
+        int minuto = calendario_minuto(&calendario, f);
+        if (minuto > c->hasta) break;
+        if (dia_en(p, f)->dia != calendario_dia(&calendario, f)) continue; //Su lugar de la ventana guarda otro dia
+        int ocupacion = atomic_load_explicit(&franja_en(p, f)->ocupacion, memory_order_relaxed);
+        //Una estadia cabe si termina antes del cierre y todas sus franjas tienen lugar para el grupo
+        int cabe = c->personas > 0 && en_dia + largo - 1 <= p->ultima;
+        for (int k = 0; cabe && k < largo; k++)
+            if (atomic_load_explicit(&franja_en(p, f + k)->ocupacion, memory_order_relaxed) + c->personas > p->aforo) cabe = 0;
+        FranjaLibre* libre = &resp->franjas[resp->cantidad++];
+        libre->minuto = minuto;
+        libre->libres = ocupacion < p->aforo ? p->aforo - ocupacion : 0;
+        libre->cabe = cabe;
+    }
+}
+
+// Llena resp con las personas libres de cada franja abierta del rango consultado, sin tomar cerrojos
+//Solo cuenta franjas desde la actual y dentro de la ventana. La ocupacion se lee como un seqlock: si un trabajador
+//la cambio mientras tanto se lee otra vez, asi la respuesta es una foto coherente y los trabajadores nunca esperan.
+//La llama solo el hilo de eventos, el mismo que recicla los dias, asi la ventana no se mueve durante la lectura
+void consultar_disponibilidad(Parque* p, const MsgConsulta* c, MsgDisponibilidad* resp) {
+    int ahora = franja_actual;
+    int desde = c->desde > 0 ? c->desde : 0;
+    int del_dia = calendario_franja_del_dia(&calendario, desde % MINUTOS_DIA);
+    if (del_dia < 0) del_dia = 0; //Antes de abrir: desde la primera franja del dia
+    if (del_dia > calendario.franjas_dia) del_dia = calendario.franjas_dia; //Despues de cerrar: desde el dia siguiente
+    int primera = desde / MINUTOS_DIA * calendario.franjas_dia + del_dia;
+    if (primera < ahora) primera = ahora;
+    int limite = (calendario_dia(&calendario, ahora) + calendario.dias_ventana) * calendario.franjas_dia;
+    if (limite > calendario_total(&calendario)) limite = calendario_total(&calendario);
+    for (;;) {
+        unsigned terminadas = atomic_load_explicit(&p->escrituras_terminadas, memory_order_acquire);
+        leer_disponibilidad(p, c, primera, limite, resp);
+        atomic_thread_fence(memory_order_acquire); //Las ocupaciones leidas quedan antes de revisar la marca
+        if (atomic_load_explicit(&p->escrituras_empezadas, memory_order_relaxed) == terminadas) return;
+        lecturas_repetidas++;
+    }
+}
+
+// Busca un bloque libre el mismo dia desde una franja para reprogramar una reserva
+//El indice no toma los cerrojos de las franjas: el resultado es una sugerencia que reservar_bloque confirma
+int buscar_bloque_libre(Parque* p, int personas, int desde, int* nueva_franja) {
+    int base, ultimo_inicio;
+    inicios_del_dia(p, calendario_dia(&calendario, desde), &base, &ultimo_inicio);
+    if (desde < base + p->primera) desde = base + p->primera; //Nunca antes de que abra el parque
+    if (desde > ultimo_inicio) return 0;
+    int posicion = calendario_posicion(&calendario, base); //Las franjas del dia estan seguidas desde aqui
+    int f = indice_primer_bloque(&p->indice, posicion + desde - base, posicion + ultimo_inicio - base,
+                                 largo_reserva(), p->aforo - personas);
+    if (f == -1) return 0;
+    *nueva_franja = base + f - posicion;
+    return 1;
+}
+
+// Igual que buscar_bloque_libre pero elige el inicio mas cercano a la franja pedida (en empate, el anterior)
+int buscar_bloque_cercano(Parque* p, int personas, int desde, int pedida, int* nueva_franja) {
+    int base, ultimo_inicio;
+    inicios_del_dia(p, calendario_dia(&calendario, desde), &base, &ultimo_inicio);
+    if (desde < base + p->primera) desde = base + p->primera;
+    if (desde > ultimo_inicio) return 0;
+    int posicion = calendario_posicion(&calendario, base);
+    int f = indice_bloque_cercano(&p->indice, posicion + desde - base, posicion + ultimo_inicio - base,
+                                  posicion + pedida - base, largo_reserva(), p->aforo - personas);
+    if (f == -1) return 0;
+    *nueva_franja = base + f - posicion;
+    return 1;
+}
+
+//Vuelve a poner una reserva anotada que empieza en ese minuto; solo se usa al recuperar
+//Solo se pone si su dia sigue en la ventana y la estadia cabe en el horario del parque
+static void reponer_reserva(Parque* p, Reserva* r, int minuto) {
+    int f = calendario_franja(&calendario, minuto);
+    if (f == -1 || r->personas <= 0) return;
+    int base, ultimo_inicio;
+    inicios_del_dia(p, calendario_dia(&calendario, f), &base, &ultimo_inicio);
+    if (dia_en(p, f)->dia != calendario_dia(&calendario, f) || f < base + p->primera || f > ultimo_inicio) return;
+    r->franja_inicio = f;
+    r->cancelada = 0;
+    int desde = calendario_posicion(&calendario, f);
+    if (guardar_reserva(p, r)) ajustar_ocupacion(p, desde, desde + largo_reserva() - 1, r->personas);
+}
+
+//Aplica un registro de la bitacora al estado; solo se usa al arrancar, antes de que haya otros hilos
+static void aplicar_registro(const RegistroBitacora* reg) {
+    if (reg->tipo == BIT_AGENTE) {
+        //Los ids se asignan en orden, asi que cada agente nuevo debe traer el siguiente
+        if (reg->agente == (uint32_t)num_agentes && num_agentes < MAX_AGENTES && buscar_agente(reg->nombre) == -1)
+            agregar_agente(reg->nombre);
+    } else if (reg->tipo == BIT_HORA) { //El reloj avanza igual que en vivo: la ventana se corre con el
+        int f = calendario_franja(&calendario, reg->minuto);
+        if (f == -1) return; //Anotado con otro horario (-i, -f o -m): no cae en ninguna franja
+        franja_actual = f;
+        if (calendario_dia(&calendario, f) < calendario.dias) mover_ventana(calendario_dia(&calendario, f));
+    } else if (reg->parque >= num_parques) { //Cambio de un parque que ya no esta en -a: se ignora
+        return;
+    } else if (reg->tipo == BIT_RESERVA) {
+        Parque* p = &parques[reg->parque];
+        if (reg->codigo == RESP_REPROGRAMADA) p->reprogramadas++; //La decision cuenta aunque su dia ya haya pasado
+        else p->aceptadas++;
+        uint32_t secuencia = reg->reserva >> BITS_PARQUE_RESERVA;
+        if (secuencia >= p->siguiente_reserva) p->siguiente_reserva = secuencia + 1; //Un id nuevo nunca repite uno anotado
+        Reserva r = { "", 0, reg->personas, reg->agente, reg->reserva, 0 };
+        strcpy(r.familia, reg->nombre);
+        reponer_reserva(p, &r, reg->minuto);
+    } else if (reg->tipo == BIT_NEGADA) {
+        if (reg->codigo == MSG_SOLICITUD) parques[reg->parque].negadas++;
+        else parques[reg->parque].cambios_negados++;
+    } else if (reg->tipo == BIT_CANCELADA || reg->tipo == BIT_MODIFICADA) { //Se repite el cambio sobre la reserva viva
+        Parque* p = &parques[reg->parque];
+        if (reg->tipo == BIT_CANCELADA) p->canceladas++;
+        else p->modificadas++;
+        int franja;
+        uint32_t indice;
+        if (!tabla_buscar(&p->reservas, reg->reserva, &franja, &indice)) return; //Su dia ya salio de la ventana
+        Reserva* r = almacen_obtener(&dia_en(p, franja)->almacen, indice);
+        Reserva movida = *r;
+        quitar_reserva(p, r);
+        if (reg->tipo == BIT_MODIFICADA) {
+            movida.personas = reg->personas;
+            reponer_reserva(p, &movida, reg->minuto);
+        }
+    } else if (reg->tipo == BIT_CONTADORES) { //Al final del punto de control: valores exactos del parque
+        Parque* p = &parques[reg->parque];
+        p->aceptadas = reg->aceptadas;
+        p->reprogramadas = reg->reprogramadas;
+        p->negadas = reg->negadas;
+        p->canceladas = reg->canceladas;
+        p->modificadas = reg->modificadas;
+        p->cambios_negados = reg->cambios_negados;
+        p->siguiente_reserva = reg->reserva;
+    }
+}
+
+//Escribe todo el estado como registros; la bitacora la llama cuando ningun hilo lo esta cambiando
+//El reloj va primero: al recuperar, la ventana ya esta en su lugar cuando llegan las reservas
+static void escribir_estado(BufferBitacora* b) {
+    RegistroBitacora reg = { .tipo = BIT_HORA, .minuto = calendario_minuto(&calendario, franja_actual) };
+    if (bitacora_poner(b, &reg) == -1) goto sin_memoria;
+    for (int i = 0; i < num_agentes; i++) {
+        reg = (RegistroBitacora){ .tipo = BIT_AGENTE, .agente = (uint32_t)i };
+        strcpy(reg.nombre, agentes[i].nombre);
+        if (bitacora_poner(b, &reg) == -1) goto sin_memoria;
+    }
+    for (int k = 0; k < num_parques; k++) {
+        Parque* p = &parques[k];
+        for (int f = 0; f < calendario.franjas_dia * calendario.dias_ventana; f++) {
+            DiaParque* d = &p->dias[f / calendario.franjas_dia];
+            for (int i = 0; i < p->franjas[f].entradas.cantidad; i++) {
+                Reserva* r = almacen_obtener(&d->almacen, p->franjas[f].entradas.items[i]);
+                if (r->cancelada) continue; //Solo las vivas: el punto de control no guarda cancelaciones
+                reg = (RegistroBitacora){ .tipo = BIT_RESERVA, .codigo = RESP_OK, .minuto = calendario_minuto(&calendario, r->franja_inicio),
+                                          .personas = r->personas, .agente = r->agente, .reserva = r->id, .parque = k };
+                strcpy(reg.nombre, r->familia);
+                if (bitacora_poner(b, &reg) == -1) goto sin_memoria;
+            }
+        }
+        reg = (RegistroBitacora){ .tipo = BIT_CONTADORES, .aceptadas = p->aceptadas,
+                                  .reprogramadas = p->reprogramadas, .negadas = p->negadas, .canceladas = p->canceladas,
+                                  .modificadas = p->modificadas, .cambios_negados = p->cambios_negados,
+                                  .reserva = p->siguiente_reserva, .parque = k };
+        if (bitacora_poner(b, &reg) == -1) goto sin_memoria;
+    }
+    return;
+sin_memoria:
+    perror("escribir_estado");
+}
+
+// Reconstruye parque, agentes, contadores y reloj desde el ultimo punto de control y la cola del registro
+void recuperar_estado(void) {
+    uint64_t inicio = metricas_ahora();
+    long registros = bitacora_recuperar(archivo_bitacora, aplicar_registro, &generacion_recuperada);
+    if (registros == -1) {
+        perror("bitacora_recuperar");
+        exit(1);
+    }
+    int reservas = 0; //Las vivas: las canceladas o movidas siguen en las listas pero no en la tabla de ids
+    for (int k = 0; k < num_parques; k++) reservas += (int)tabla_cantidad(&parques[k].reservas);
+    char texto[TAM_INSTANTE];
+    texto_instante(calendario_minuto(&calendario, franja_actual), texto, sizeof(texto));
+    printf("Recuperado desde %s: %ld registros, %d agentes, %d reservas, hora %s (%.1f ms)\n", archivo_bitacora,
+           registros, (int)num_agentes, reservas, texto, (double)(metricas_ahora() - inicio) / 1e6);
+}
+
+// Lanza el escritor del diario con el nivel de detalle de -g
+void iniciar_diario(int nivel) {
+    if (diario_iniciar(num_trabajadores + 1, nivel, formatear_evento) == -1) { //Un anillo por hilo, como las metricas
+        perror("diario_iniciar");
+        exit(1);
+    }
+}
+
+// Con -b, guarda el estado de arranque y empieza a anotar cada cambio
+void iniciar_bitacora(void) {
+    if (archivo_bitacora[0] == '\0') return; //No se pidio -b
+    if (bitacora_iniciar(archivo_bitacora, generacion_recuperada + 1, escribir_estado) == -1) {
+        perror("bitacora_iniciar");
+        exit(1);
+    }
+}
+
+//Muestra las franjas abiertas de un dia del parque cuya ocupacion es exactamente 'personas'
+static void imprimir_franjas(FILE* f_salida, Parque* p, int dia, int personas) {
+    int base = dia * calendario.franjas_dia;
+    for (int f = base + p->primera; f <= base + p->ultima; f++) {
+        if (franja_en(p, f)->ocupacion != personas) continue;
+        char texto[TAM_INSTANTE];
+        texto_instante(calendario_minuto(&calendario, f) % MINUTOS_DIA, texto, sizeof(texto)); //El dia ya se sabe
+        fprintf(f_salida, "%s ", texto);
+    }
+}
+
+//Muestra las horas pico y valle de un parque en un dia que siga en la ventana
+static void imprimir_horas(FILE* f_salida, Parque* p, int dia) {
+    int max_p = 0, min_p = INT_MAX; //Maximo y mino de personas
+    int base = dia * calendario.franjas_dia;
+    for (int f = base + p->primera; f <= base + p->ultima; f++) { //Recorre todas las franjas del parque
+        int ocupacion = franja_en(p, f)->ocupacion; //Obtiene la ocupacion
+        if (ocupacion > max_p) max_p = ocupacion;
+        if (ocupacion < min_p) min_p = ocupacion;
+    }
+    fprintf(f_salida, "Horas pico: ");
+    imprimir_franjas(f_salida, p, dia, max_p); //Muestra las horas pico
+    fprintf(f_salida, "(%d personas)\n", max_p);
+    fprintf(f_salida, "Horas valle: ");
+    imprimir_franjas(f_salida, p, dia, min_p); //Muestra las horas valle
+    fprintf(f_salida, "(%d personas)\n", min_p);
+}
+
 //Muestra un reporte final de la simulacion
+//Con varios parques primero va el detalle de cada uno y luego los totales; las horas son las del ultimo dia
 void imprimir_reporte() {
-    //Variables
-    int max_p = 0, min_p = 100000; //Maximo y mino de personas
-    int horas_pico[13], horas_valle[13], np = 0, nv = 0; //Para hora pico y mas vacia
+    int dia = calendario_dia(&calendario, franja_actual);
+    if (dia >= calendario.dias) dia = calendario.dias - 1; //El reloj ya paso la ultima franja
+    if (calendario.dias > 1) printf("Dia %d:\n", dia);
+    for (int k = 0; k < num_parques; k++) {
+        Parque* p = &parques[k];
+        if (num_parques > 1)
+            printf("Parque %d (aforo %d, de %d a %d, %d trabajadores):\n", k, p->aforo, p->apertura, p->cierre, p->hilos);
+        imprimir_horas(stdout, p, dia);
+        if (num_parques > 1)
+            printf("Negadas: %d, aceptadas en su hora: %d, re-programadas: %d\n",
+                   (int)p->negadas, (int)p->aceptadas, (int)p->reprogramadas);
+    }
+    int aceptadas, reprogramadas, negadas;
+    sumar_contadores(&aceptadas, &reprogramadas, &negadas);
+    if (num_parques > 1) printf("Total de los %d parques:\n", num_parques);
+    printf("Solicitudes negadas: %d\n", negadas); //Muestra cuantas solicitudes fueron negadas
+    printf("Solicitudes aceptadas en su hora: %d\n", aceptadas); //Muestra cuantas solicitudes fueron aceptadas
+    printf("Solicitudes re-programadas: %d\n", reprogramadas);  //Muestra cuantas solicitudes fueron reprogramadas
+    if (solicitudes_sin_parque > 0)
+        printf("Solicitudes para parques que no existen (ya contadas como negadas): %d\n", (int)solicitudes_sin_parque);
+    int canceladas, modificadas, cambios_negados;
+    sumar_cambios(&canceladas, &modificadas, &cambios_negados);
+    if (canceladas + modificadas + cambios_negados > 0)
+        printf("Reservas canceladas: %d, modificadas: %d, cambios negados: %d\n", canceladas, modificadas, cambios_negados);
+    if (vencidas_en_cola > 0)
+        printf("Solicitudes cuya hora paso mientras esperaban en la cola: %ld\n", (long)vencidas_en_cola);
+    if (solicitudes_ocupado > 0)
+        printf("Solicitudes rechazadas con OCUPADO por colas llenas (limite %d): %ld\n", limite_cola, (long)solicitudes_ocupado);
+    if (consultas_disponibilidad > 0)
+        printf("Consultas de disponibilidad: %ld (%ld lecturas repetidas por cruzarse con una reserva)\n",
+               (long)consultas_disponibilidad, (long)lecturas_repetidas);
+    if (diario_descartados() > 0)
+        printf("Diario: %llu registros descartados porque la salida no alcanzaba\n", (unsigned long long)diario_descartados());
+    if (admision_ms > 0 && ventanas_admision > 0)
+        printf("Admision por ventanas de %d ms: %ld ventanas, %.1f solicitudes por ventana\n", admision_ms,
+               (long)ventanas_admision, (double)solicitudes_admision / (double)ventanas_admision);
+    if (archivo_bitacora[0] != '\0') {
+        uint64_t registros, sincronizaciones, puntos;
+        bitacora_resumen(&registros, &sincronizaciones, &puntos);
+        printf("Bitacora: %llu registros, %llu sincronizaciones (%.1f registros por fdatasync), %llu puntos de control\n",
+               (unsigned long long)registros, (unsigned long long)sincronizaciones,
+               sincronizaciones ? (double)registros / (double)sincronizaciones : 0.0, (unsigned long long)puntos);
+    }
+    printf("Tiempos por etapa (us):\n");
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        histograma_iniciar(&histograma_etapa);
+        metricas_juntar((EtapaMetrica)e, &histograma_etapa);
+        if (histograma_etapa.total == 0) continue; //Etapa que no se uso (por ejemplo sin solicitudes)
+        printf("  %-14s p50 %.1f, p99 %.1f, max %.1f (%llu mediciones)\n", nombre_etapa((EtapaMetrica)e),
+               histograma_percentil(&histograma_etapa, 50) / 1e3, histograma_percentil(&histograma_etapa, 99) / 1e3,
+               histograma_etapa.maximo / 1e3, (unsigned long long)histograma_etapa.total);
+    }
+}
 
-    for (int h = 7; h <= 19; h++) { //Recorre todas las horas
-        int p = parque[h].ocupacion; //Obtiene la ocupacion
-        if (p > max_p) { max_p = p; np = 0; horas_pico[np++] = h; }
-        else if (p == max_p) horas_pico[np++] = h; //Si es mayor o igual la anade a pico
-        if (p < min_p) { min_p = p; nv = 0; horas_valle[nv++] = h; }
-        else if (p == min_p) horas_valle[nv++] = h; //Si es menor o igual la anade a pico
+// Escribe las estadisticas actuales: contadores, profundidad de la cola, tiempos por etapa y solicitudes por agente
+//Solo lee contadores atomicos y el cerrojo de la cola, asi no frena a los trabajadores
+void escribir_estadisticas(FILE* f) {
+    int profundidad = 0, maxima = 0; //Suma de las colas de los parques y la mayor de sus maximas
+    int aceptadas, reprogramadas, negadas;
+    for (int k = 0; k < num_parques; k++) {
+        int c, m;
+        cola_profundidad(&parques[k].cola, &c, &m);
+        profundidad += c;
+        if (m > maxima) maxima = m;
+    }
+    sumar_contadores(&aceptadas, &reprogramadas, &negadas);
+    char texto[TAM_INSTANTE];
+    texto_instante(calendario_minuto(&calendario, franja_actual), texto, sizeof(texto));
+    fprintf(f, "hora_actual %s\n", texto);
+    fprintf(f, "calendario minutos_franja %d dias %d dias_ventana %d\n",
+            calendario.minutos_franja, calendario.dias, calendario.dias_ventana);
+    fprintf(f, "agentes_registrados %d\n", num_agentes);
+    fprintf(f, "solicitudes_aceptadas %d\n", aceptadas);
+    fprintf(f, "solicitudes_reprogramadas %d\n", reprogramadas);
+    fprintf(f, "solicitudes_negadas %d\n", negadas);
+    int canceladas, modificadas, cambios_negados;
+    sumar_cambios(&canceladas, &modificadas, &cambios_negados);
+    fprintf(f, "cambios canceladas %d modificadas %d negados %d\n", canceladas, modificadas, cambios_negados);
+    fprintf(f, "consultas %ld repetidas %ld\n", (long)consultas_disponibilidad, (long)lecturas_repetidas);
+    fprintf(f, "ocupado limite %d solicitudes %ld\n", limite_cola, (long)solicitudes_ocupado);
+    fprintf(f, "vencidas_en_cola %ld\n", (long)vencidas_en_cola);
+    fprintf(f, "cola_profundidad %d\n", profundidad);
+    fprintf(f, "cola_maxima %d\n", maxima);
+    fprintf(f, "diario nivel %d escritos %llu descartados %llu\n", diario_nivel(),
+            (unsigned long long)diario_escritos(), (unsigned long long)diario_descartados());
+    fprintf(f, "admision ms %d ventanas %ld solicitudes %ld\n", admision_ms, (long)ventanas_admision, (long)solicitudes_admision);
+    for (int k = 0; k < num_parques; k++) {
+        Parque* p = &parques[k];
+        int c, m;
+        cola_profundidad(&p->cola, &c, &m);
+        fprintf(f, "parque %d aforo %d apertura %d cierre %d trabajadores %d aceptadas %d reprogramadas %d negadas %d cola_profundidad %d cola_maxima %d\n",
+                k, p->aforo, p->apertura, p->cierre, p->hilos, (int)p->aceptadas, (int)p->reprogramadas, (int)p->negadas, c, m);
     }
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        histograma_iniciar(&histograma_etapa);
+        metricas_juntar((EtapaMetrica)e, &histograma_etapa);
+        fprintf(f, "etapa %s mediciones %llu p50_us %.1f p99_us %.1f p999_us %.1f max_us %.1f\n",
+                nombre_etapa((EtapaMetrica)e), (unsigned long long)histograma_etapa.total,
+                histograma_percentil(&histograma_etapa, 50) / 1e3, histograma_percentil(&histograma_etapa, 99) / 1e3,
+                histograma_percentil(&histograma_etapa, 99.9) / 1e3, histograma_etapa.maximo / 1e3);
+    }
+    for (int i = 0; i < metricas_hilos(); i++) {
+        if (i == 0) fprintf(f, "hilo 0 eventos solicitudes %llu\n", (unsigned long long)metricas_solicitudes(0));
+        else fprintf(f, "hilo %d trabajador solicitudes %llu parque %d\n", i,
+                     (unsigned long long)metricas_solicitudes(i), (i - 1) % num_parques);
+    }
+    int n = num_agentes; //Los agentes con id menor ya tienen su nombre copiado
+    for (int i = 0; i < n; i++)
+        fprintf(f, "agente %s id %d solicitudes %llu\n", agentes[i].nombre, i,
+                (unsigned long long)atomic_load_explicit(&agentes[i].solicitudes, memory_order_relaxed));
+}
+
+//Escribe un archivo temporal y lo renombra, asi quien lee nunca ve el archivo a medias
+static void guardar_estadisticas(void) {
+    char temporal[sizeof(archivo_estadisticas) + 8];
+    snprintf(temporal, sizeof(temporal), "%s.tmp", archivo_estadisticas);
+    FILE* f = fopen(temporal, "w");
+    if (!f) {
+        perror("fopen estadisticas");
+        return;
+    }
+    escribir_estadisticas(f);
+    if (fclose(f) != 0 || rename(temporal, archivo_estadisticas) == -1) perror("guardar estadisticas");
+}
+
+//Hilo que reescribe el archivo cada PERIODO_ESTADISTICAS segundos hasta que se lo detenga
+static void* estadisticas(void* arg) {
+    (void)arg;
+    struct timespec limite;
+    clock_gettime(CLOCK_MONOTONIC, &limite);
+    pthread_mutex_lock(&cerrojo_estadisticas);
+    while (!fin_estadisticas) {
+        limite.tv_sec += PERIODO_ESTADISTICAS;
+        while (!fin_estadisticas && pthread_cond_timedwait(&aviso_estadisticas, &cerrojo_estadisticas, &limite) != ETIMEDOUT);
+        pthread_mutex_unlock(&cerrojo_estadisticas);
+        guardar_estadisticas(); //Se escribe sin el cerrojo: detener_estadisticas no espera la escritura para avisar
+        pthread_mutex_lock(&cerrojo_estadisticas);
+    }
+    pthread_mutex_unlock(&cerrojo_estadisticas);
+    return NULL;
+}
 
-    printf("Horas pico: ");
-    for (int i = 0; i < np; i++) printf("%d ", horas_pico[i]);
-    printf("(%d personas)\n", max_p);
-    printf("Horas valle: "); //Muestra las horas pico
-    for (int i = 0; i < nv; i++) printf("%d ", horas_valle[i]); //Muestra las horas valle
-    printf("(%d personas)\n", min_p);
-    printf("Solicitudes negadas: %d\n", solicitudes_negadas); //Muestra cuantas solicitudes fueron negadas
-    printf("Solicitudes aceptadas en su hora: %d\n", solicitudes_aceptadas); //Muestra cuantas solicitudes fueron aceptadas
-    printf("Solicitudes re-programadas: %d\n", solicitudes_reprogramadas);  //Muestra cuantas solicitudes fueron reprogramadas
+// Lanza el hilo que reescribe el archivo de estadisticas cada PERIODO_ESTADISTICAS segundos
+void iniciar_estadisticas(void) {
+    if (archivo_estadisticas[0] == '\0') return; //No se pidio -e
+    pthread_condattr_t atributos; //El periodo se mide con el reloj monotonico
+    pthread_condattr_init(&atributos);
+    pthread_condattr_setclock(&atributos, CLOCK_MONOTONIC);
+    pthread_cond_init(&aviso_estadisticas, &atributos);
+    pthread_condattr_destroy(&atributos);
+    if (pthread_create(&hilo_estadisticas, NULL, estadisticas, NULL) != 0) {
+        perror("pthread_create estadisticas");
+        exit(1);
+    }
+}
+
+// Detiene ese hilo dejando el archivo con los valores finales
+void detener_estadisticas(void) {
+    if (archivo_estadisticas[0] == '\0') return;
+    pthread_mutex_lock(&cerrojo_estadisticas);
+    fin_estadisticas = 1;
+    pthread_cond_signal(&aviso_estadisticas);
+    pthread_mutex_unlock(&cerrojo_estadisticas);
+    pthread_join(hilo_estadisticas, NULL); //Su ultima escritura ya incluye todo lo que decidieron los trabajadores
+    pthread_cond_destroy(&aviso_estadisticas);
 }
 
 //Le indica todos los agentes que se termino la simulacion
+//Antes del MSG_TERMINAR cada uno recibe lo que se le guardo, esperando a lo sumo ESPERA_PENDIENTES_MS entre todos
 void terminar_agentes() {
-    for (int i = 0; i < num_agentes; i++) //Pasa por los agentes
-        if (agentes[i].activo) //Si esta activo, le dice que termine
-            enviar_respuesta(agentes[i].pipe_respuesta, "TERMINAR");
+    uint64_t limite = metricas_ahora() + (uint64_t)ESPERA_PENDIENTES_MS * 1000000ULL;
+    for (int i = 0; i < num_agentes; i++) {
+        Agente* a = &agentes[i];
+        for (;;) {
+            pthread_mutex_lock(&a->cerrojo);
+            int quedan = a->activo && vaciar_agente(a);
+            struct pollfd canal = { .fd = a->anillo ? -1 : a->fd_respuesta, .events = POLLOUT }; //Con fd -1 solo espera
+            pthread_mutex_unlock(&a->cerrojo);
+            if (!quedan || metricas_ahora() >= limite) break;
+            poll(&canal, 1, REINTENTO_ANILLO_MS);
+        }
+    }
+    uint8_t trama[MAX_TRAMA];
+    int len = codificar_vacio(trama, MSG_TERMINAR, 0);
+    for (int i = 0; i < num_agentes; i++) { //Pasa por los agentes
+        if (agentes[i].activo) { //Si esta activo, le dice que termine y cierra su pipe
+            enviar_trama(&agentes[i], trama, len, !agentes[i].fin_envio); //Uno que ya termino su archivo pudo haber salido
+            pthread_mutex_lock(&agentes[i].cerrojo);
+            if (agentes[i].activo && agentes[i].pendiente_largo > 0) //Al menos el MSG_TERMINAR no cupo
+                avisar("Aviso: el agente %s no leyo lo ultimo que se le envio antes de terminar.\n", agentes[i].nombre);
+            pthread_mutex_unlock(&agentes[i].cerrojo);
+            desactivar_agente(&agentes[i]);
+        }
+    }
 }
 //limpia los recursos y borra el pipe del controlador
 void limpiar_recursos() {
+    close(fd_epoll); //Cierra el epoll y sus fuentes de eventos
+    close(fd_reloj);
+    close(fd_senales);
+    close(fd_decididas);
+    close(fd_reintento);
+    if (fd_escritura_entrada != -1) close(fd_escritura_entrada);
+    for (int fd = 0; fd < MAX_DESCRIPTORES; fd++) //Conexiones de agentes que siguen abiertas
+        if (conexiones[fd] != SIN_CONEXION) close(fd);
+    if (transporte == TRANSPORTE_SHM) { //Los agentes que sigan enviando reciben EPIPE
+        anillo_cerrar(anillo_entrada);
+        pthread_join(hilo_vigia, NULL); //El vigia sale antes de cerrar su eventfd
+        anillo_liberar(anillo_entrada);
+        anillo_borrar(pipe_entrada);
+    }
     close(fd_pipe_entrada); //Ciera el pipe del controlador
-    unlink(pipe_entrada); //elimina el fifo
+    for (int k = 0; k < num_parques; k++) {
+        Parque* p = &parques[k];
+        for (int f = 0; f < calendario.franjas_dia * calendario.dias_ventana; f++) { //Libera las listas de reservas de cada franja
+            lista_liberar(&p->franjas[f].entradas);
+            pthread_mutex_destroy(&p->franjas[f].cerrojo);
+        }
+        for (int d = 0; d < calendario.dias_ventana; d++)
+            almacen_destruir(&p->dias[d].almacen); //Libera la tabla de reservas de cada dia
+        free(p->franjas);
+        free(p->dias);
+        indice_destruir(&p->indice);
+        tabla_destruir(&p->reservas);
+        cola_destruir(&p->cola);
+    }
+    metricas_destruir();
+    diario_destruir();
+    if (transporte == TRANSPORTE_FIFO) unlink(pipe_entrada); //elimina el fifo
+    if (transporte == TRANSPORTE_UNIX) unix_borrar(pipe_entrada); //elimina el archivo del socket
 }
 
 /******************************************************
@@ -282,10 +2047,10 @@ void limpiar_recursos() {
 *
 * Este archivo genera el motor del controlador,
 * ejecutando las funciones críticas que permiten la
-* simulación completa del parque. El uso de hilos
-* independientes para el reloj y la gestión de solicitudes
-* garantiza concurrencia realista y evita bloqueos entre
-* las distintas entidades del sistema.
+* simulación completa del parque. Un solo bucle de eventos
+* atiende el pipe, el reloj y las señales en un orden fijo,
+* por lo que no hay carreras sobre la hora actual y el
+* apagado es inmediato.
 *
 * La implementación del algoritmo de reservas, con validación
 * de aforo, detección de conflictos y búsqueda de bloques
@@ -1,9 +1,9 @@
-/******************************************************
-* Fecha 11/11/2025
-* Pontificia Universidad Javeriana
-* Profesor: J. Corredor, PhD
-* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
-* Materia: Sistemas opertivos
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
 * Temas: Proyecto controlador_funciones.h
 *
 * Descripción:
@@ -14,84 +14,207 @@
 * registro de agentes, procesamiento de solicitudes, control de aforo,
 * reprogramación de reservas y comunicación mediante pipes. Su propósito
 * es centralizar los elementos fundamentales que permiten la correcta
-* interacción entre los hilos y módulos del proyecto.
-******************************************************/
-#ifndef CONTROLADOR_FUNCIONES_H
-#define CONTROLADOR_FUNCIONES_H
-
-#include <stdio.h> //Libreria para mostrar informacion por pantalla
-#include <stdlib.h> //Libreria de memoria dinamica
-#include <string.h> //libreria para cadenas de caracteres
-#include <unistd.h> //Libreria para funciones relacionadas con posix
-#include <fcntl.h> // Libreria para constantes y flags
-#include <sys/stat.h> //Libreria para archivos y permisos
-#include <sys/types.h> //Libreria para syscalls
-#include <pthread.h> // Libreria para tipos de datos usados en llamadas al sistema
-#include <errno.h> //Libreria para manejo de errores
-
-#define MAX_HORAS 20 //Cantidad maxima de horas que maneja
-#define MAX_RESERVAS_POR_HORA 50 //Cantidad maxima de reservas en una hora
-#define MAX_AGENTES 20 //Cantidad maxima de agentes que soporta
-#define MAX_NOMBRE 50 //Cantidad maxima de caracteres en un nombre
-#define MAX_BUFFER 256 //Cantidad maxima de caracteres para el buffer (lectura y escritura)
-
-typedef struct {
-    char familia[MAX_NOMBRE]; //Nombre de la familia que realizo la reserva
-    int hora_inicio; //Hora de inicio
-    int personas; //Cantidad de integrantes de la familia
-    char agente[MAX_NOMBRE]; //Nombre del agente
-} Reserva;
-
-typedef struct {
-    int hora; //Entero donde se guarda la hora
-    int ocupacion; //Cantidad de persona en esa hora
-    Reserva reservas[MAX_RESERVAS_POR_HORA]; //Arreglo de rservas para esa hora
-    int num_reservas;
-} HoraParque;
-
-typedef struct {
-    char nombre[MAX_NOMBRE]; //Nombre del agente
-    char pipe_respuesta[MAX_NOMBRE]; //Nombre del pipe para comunicarse
-    int activo; //Si esta activo (1) o no (0)
-} Agente;
-
-// Variables globales externas
-//Indica la hora actual, la de inicio y fin con las que se obtiene el tiempo transcurrido
-//La cantidad de segundos de las horas simuladas y el maximo de personas
-extern int hora_actual, hora_inicio, hora_fin, seg_por_hora, aforo_max;
-extern char pipe_entrada[MAX_NOMBRE]; //Nombre del pipe
-extern HoraParque parque[MAX_HORAS]; //Arreglo que tiene la informacion de las horas
-extern int fd_pipe_entrada; //Descriptor del pipe
-//Cuenta cuantas solicitudes han sido aprobadas, reprogramadas o negadas
-extern int solicitudes_aceptadas, solicitudes_reprogramadas, solicitudes_negadas;
-extern Agente agentes[MAX_AGENTES]; //Lista de los agentes
-extern int num_agentes; //Guarda cuantos agentes estan conectados
-extern volatile int simulacion_terminada; //Indica el fin de la simulacion
-
-// Prototipos
-// Funcion que controla el avance del reloj
-void* reloj(void* arg);
-// Funcion que gestiona las solicitudes de los agentes
-void* gestor_solicitudes(void* arg);
-// Avanza la simulacion en una hora, se actualizan las rservas para esa nueva hora
-void avanzar_hora(void);
-// Procesa los mensajes recibidos desde los agentes
-void procesar_mensaje(char* msg);
-// Registra un nuevo agente en el sistema
-int registrar_agente(char* nombre, char* pipe_resp);
-// Envia una respuesta a un agente mediante su pipe especifico
-void enviar_respuesta(char* pipe_resp, char* msg);
-// Intenta reservar basado en la disponibilidad del parque
-int intentar_reserva(char* familia, int hora, int personas, char* agente, char* resp);
-// Busca un bloque libre para reprogramar una reserva
-int buscar_bloque_libre(int personas, int* nueva_hora);
-//Muestra un reporte final de la simulacion
-void imprimir_reporte(void);
-//Le indica todos los agentes que se termino la simulacion
-void terminar_agentes(void);
-//limpia los recursos y borra el pipe del controlador
-void limpiar_recursos(void);
-
+* interacción entre los hilos y módulos del proyecto.
+******************************************************/
+#ifndef CONTROLADOR_FUNCIONES_H
+#define CONTROLADOR_FUNCIONES_H
+
+#include <stdio.h> //Libreria para mostrar informacion por pantalla
+#include <stdarg.h> //Libreria para los avisos con formato que van al diario
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <string.h> //libreria para cadenas de caracteres
+#include <unistd.h> //Libreria para funciones relacionadas con posix
+#include <fcntl.h> // Libreria para constantes y flags
+#include <sys/stat.h> //Libreria para archivos y permisos
+#include <sys/types.h> //Libreria para syscalls
+#include <pthread.h> // Libreria para tipos de datos usados en llamadas al sistema
+#include <errno.h> //Libreria para manejo de errores
+#include <signal.h> // Libreria para manejo de senales
+#include <sys/epoll.h> //Libreria para esperar eventos sobre varios descriptores
+#include <sys/timerfd.h> //Libreria para el temporizador del reloj simulado
+#include <sys/signalfd.h> //Libreria para recibir senales como eventos
+#include <sys/socket.h> //Libreria para las conexiones de -x unix
+#include <sys/eventfd.h> //Libreria para avisar al epoll que llegaron tramas por memoria compartida
+#include <stdatomic.h> //Libreria para contadores y valores compartidos entre hilos
+#include <poll.h> //Libreria para esperar, al terminar, que los agentes lean lo que se les guardo
+
+#include "protocolo.h" //Formato de las tramas y MAX_NOMBRE
+#include "cola_solicitudes.h" //Cola entre el hilo de eventos y los trabajadores
+#include "indice_ocupacion.h" //Arbol de segmentos sobre la ocupacion de cada franja
+#include "calendario.h" //Franjas, dias y ventana circular
+#include "almacen_reservas.h" //Tabla unica de reservas y listas de indices
+#include "transporte_shm.h" //Anillos en memoria compartida para -x shm
+#include "transporte_unix.h" //Socket de escucha para -x unix
+#include "metricas.h" //Tiempos por etapa de cada hilo
+#include "bitacora.h" //Registro en disco de cada cambio del parque
+#include "diario.h" //Anillos por hilo para lo que se muestra mientras corre
+
+#define DURACION_RESERVA 120 //Minutos que dura cada reserva
+#define MAX_AGENTES 8192 //Cantidad maxima de agentes que soporta
+#define TAM_TABLA_AGENTES 16384 //Espacios de la tabla hash de nombres (potencia de 2, el doble de MAX_AGENTES)
+#define MAX_TRABAJADORES 64 //Cantidad maxima de hilos que deciden reservas
+#define MAX_EVENTOS 256 //Eventos que se atienden por cada llamada a epoll_wait
+#define MAX_DESCRIPTORES (MAX_AGENTES + 1024) //Descriptores de conexion que se pueden seguir con -x unix
+#define MAX_TRAMAS_POR_CONEXION 64 //Tramas que se leen de una conexion antes de pasar a la siguiente
+#define MIN_SEG_POR_HORA 0.001 //Hora simulada mas corta en tiempo real (un milisegundo)
+#define PERIODO_ESTADISTICAS 1 //Segundos entre cada reescritura del archivo de estadisticas
+#define TRABAJOS_POR_VUELTA 64 //Con -b, trabajos que un trabajador decide antes de esperar una sola sincronizacion
+#define MAX_ADMISION_MS 1000 //Ventana de admision mas larga que se acepta con -l
+#define REINTENTO_OCUPADO_MS 20 //Espera que se le sugiere a un agente al responderle OCUPADO; el agente la alarga con cada intento
+#define NIVEL_SILENCIO 0 //Diario (-g): solo avisos de apagado; el reporte final siempre se muestra
+#define NIVEL_RELOJ 1 //Ademas cada franja con quienes entran y salen y el resumen de cada dia
+#define NIVEL_SOLICITUDES 2 //Ademas cada solicitud recibida (por defecto)
+#define NIVEL_DECISIONES 3 //Ademas la respuesta que dio un trabajador a cada solicitud
+#define MAX_PENDIENTE_AGENTE (1 << 20) //Bytes de respuestas guardadas para un agente que no lee antes de dejar de responderle
+#define REINTENTO_ANILLO_MS 1 //Cada cuanto se reintentan las respuestas guardadas para un anillo lleno (no tiene descriptor)
+#define ESPERA_PENDIENTES_MS 1000 //Al terminar, cuanto se espera a que los agentes lean las respuestas que se les guardaron
+
+//Cada franja tiene su propio cerrojo: una reserva toma los de todas sus franjas en orden ascendente
+typedef struct {
+    atomic_int ocupacion; //Cantidad de persona en esa franja, solo se modifica con el cerrojo tomado
+    ListaIndices entradas; //Reservas que empiezan en esta franja (indices en el almacen de su dia)
+    pthread_mutex_t cerrojo; //Protege entradas y los cambios de ocupacion
+} FranjaParque;
+
+//Un dia de la ventana de un parque; al reciclarlo se vacia y pasa a guardar el dia dias_ventana despues
+typedef struct {
+    int dia; //Dia que guarda ahora, cambia con los cerrojos de todas sus franjas tomados
+    AlmacenReservas almacen; //Reservas que empiezan ese dia, cada una guardada una sola vez
+} DiaParque;
+
+//Cada parque es un fragmento independiente: sus franjas, su indice, sus reservas, su cola y sus contadores
+//Solo lo tocan sus propios trabajadores y el hilo de eventos, que le encola solicitudes y avanza el reloj
+typedef struct {
+    int id; //Posicion en parques, es el id que mandan los agentes
+    int aforo; //Maximo de personas por franja
+    int apertura, cierre; //Primera y ultima hora en que se puede estar en el parque, dentro de -i y -f
+    int primera, ultima; //Las mismas, como franjas del dia: primera en que abre y ultima en que puede haber alguien
+    int hilos; //Trabajadores que deciden sus reservas
+    FranjaParque* franjas; //Franjas de la ventana, un dia tras otro en anillo (calendario_posicion)
+    DiaParque* dias; //Dias de la ventana, el dia d esta en d % dias_ventana
+    IndiceOcupacion indice; //Indice sobre las franjas de la ventana para buscar bloques libres sin recorrerlas
+    ColaSolicitudes cola; //Solicitudes pendientes de decidir en este parque
+    _Alignas(64) atomic_long en_curso; //Trabajos encolados cuya respuesta todavia no se envia, en su propia linea de cache
+    atomic_int aceptadas, reprogramadas, negadas; //Solicitudes aprobadas, reprogramadas y negadas en este parque
+    atomic_int canceladas, modificadas, cambios_negados; //Cancelaciones y modificaciones hechas y las que se negaron
+    TablaReservas reservas; //Id de cada reserva viva a su franja y su lugar en el almacen de su dia
+    atomic_uint siguiente_reserva; //Secuencia del siguiente id; el id lleva ademas el parque en sus bits bajos
+    //Seqlock de la ocupacion para las consultas: cada cambio suma uno a empezadas antes y a terminadas despues,
+    //asi una lectura que ve ambos iguales no se cruzo con ningun cambio y los trabajadores nunca esperan a los lectores
+    _Alignas(64) atomic_uint escrituras_empezadas;
+    atomic_uint escrituras_terminadas;
+} Parque;
+
+typedef struct {
+    char nombre[MAX_NOMBRE]; //Nombre del agente
+    char pipe_respuesta[MAX_NOMBRE]; //Nombre del pipe para comunicarse
+    int fd_respuesta; //Descriptor no bloqueante del pipe, abierto desde el registro hasta terminar_agentes
+    AnilloShm* anillo; //Anillo de respuestas del agente con -x shm, NULL con pipes
+    uint8_t* pendiente; //Respuestas que no cupieron en su canal, en orden y cada una precedida por su largo (uint16_t)
+    size_t pendiente_largo, pendiente_capacidad; //Bytes guardados en pendiente y bytes reservados
+    int despedido; //1 si ya no se le responde: solo falta que lea el MSG_TERMINAR que quedo en pendiente
+    atomic_int vigilar_pedido; //1 si se le guardaron respuestas y el hilo de eventos todavia no espera espacio en su canal
+    int activo; //Si esta activo (1) o no (0)
+    atomic_ullong solicitudes; //Solicitudes recibidas de este agente, solo la suma el hilo de eventos
+    int fin_envio; //1 cuando envio MSG_FIN_SOLICITUDES o se desconecto, solo lo usa el hilo de eventos
+    atomic_int cierre_sin_contar; //1 si un trabajador lo cerro y el hilo de eventos todavia no lo cuenta como terminado
+    pthread_mutex_t cerrojo; //Varios trabajadores pueden responderle al mismo agente a la vez
+} Agente;
+
+// Variables globales externas
+//La hora de inicio y fin de cada dia y el maximo de personas de los parques que no lo indican con -a
+extern int hora_inicio, hora_fin, aforo_max;
+extern Calendario calendario; //Franjas, dias simulados y ventana (-m, -d, -v)
+extern atomic_int franja_actual; //Franja del calendario en curso, la cambia el hilo de eventos y la leen los trabajadores
+extern double seg_por_hora; //Segundos reales que dura una hora simulada (admite fracciones); cada franja dura su parte
+extern int reloj_virtual; //1 con -s virtual: la franja avanza cuando ya no queda nada por decidir
+extern int agentes_esperados; //Con reloj virtual, agentes que deben registrarse antes de avanzar (-n)
+extern char pipe_entrada[MAX_NOMBRE]; //Nombre del pipe
+extern Parque parques[MAX_PARQUES]; //Parques que atiende el controlador
+extern int num_parques; //Parques configurados (-a), 1 si no se indico
+extern int fd_pipe_entrada; //Descriptor del pipe (con -x shm, eventfd que marca el vigia; con -x unix, socket de escucha)
+extern int transporte; //TRANSPORTE_FIFO, TRANSPORTE_SHM o TRANSPORTE_UNIX
+extern AnilloShm* anillo_entrada; //Anillo de solicitudes con -x shm
+extern int num_trabajadores; //Hilos que deciden reservas en paralelo, repartidos entre los parques
+extern Agente agentes[MAX_AGENTES]; //Lista de los agentes
+extern atomic_int num_agentes; //Guarda cuantos agentes se han registrado, su id es la posicion en agentes
+extern char archivo_estadisticas[256]; //Archivo que se reescribe con las estadisticas (-e), vacio si no se pidio
+extern char archivo_bitacora[256]; //Nombre base de la bitacora (-b), vacio si no se pidio
+extern int recuperar; //1 con -r: el estado se reconstruye desde la bitacora antes de empezar
+extern int limite_cola; //Con -q, trabajos pendientes por parque desde los que se responde OCUPADO; 0 sin limite
+extern int admision_ms; //Con -l, milisegundos en que un trabajador junta solicitudes para decidirlas juntas; 0 las decide al llegar
+
+// Prototipos
+// Lee la lista de parques de -a ("aforo[:apertura-cierre],..."), retorna 0 o -1 si no es valida
+//Se llama con el calendario ya configurado: los horarios deben caber en el dia de -i y -f
+int configurar_parques(const char* texto);
+// Prepara las franjas, los dias, el indice y la cola de cada parque y le reparte los trabajadores
+void iniciar_parques(void);
+// Crea el epoll con el pipe de entrada, el temporizador del reloj y las senales de apagado
+void iniciar_eventos(void);
+// Bucle principal: atiende solicitudes, avanza el reloj y termina la simulacion
+void bucle_eventos(void);
+// Lee y procesa todas las tramas disponibles en el pipe de entrada
+void leer_solicitudes(void);
+// Lanza los hilos trabajadores que deciden las reservas
+void iniciar_trabajadores(void);
+// Espera a que los trabajadores terminen lo pendiente
+void detener_trabajadores(void);
+// Funcion ejecutada por cada hilo trabajador
+void* trabajador(void* arg);
+// Avanza la simulacion en una franja; al terminar un dia lo resume y recicla su lugar en la ventana
+void avanzar_hora(void);
+// Con reloj virtual, retorna 1 si todos los agentes esperados terminaron de enviar y no queda nada por decidir
+int hora_completa(void);
+// Lee las tramas de una conexion de agente (-x unix)
+void leer_conexion(int fd);
+// Procesa una trama completa recibida desde los agentes; fd_origen es la conexion con -x unix o -1
+void procesar_mensaje(const CabeceraTrama* cab, const uint8_t* cuerpo, int fd_origen);
+// Registra un nuevo agente en el sistema, retorna su id o -1 si no se pudo
+//Con una conexion (fd_conexion >= 0) se responde por ella y pipe_resp no se usa
+int registrar_agente(char* nombre, char* pipe_resp, int fd_conexion);
+// Busca un agente por nombre en la tabla hash, retorna su id o -1
+int buscar_agente(const char* nombre);
+// Envia una respuesta a un agente mediante su pipe especifico, retorna 0 si se escribio o se guardo para cuando lea
+int enviar_respuesta(Agente* agente, const uint8_t* trama, int len);
+// Cierra el pipe de un agente y lo marca como inactivo
+void desactivar_agente(Agente* agente);
+// Intenta reservar basado en la disponibilidad del parque; inicio es el minuto pedido. Retorna el codigo de la respuesta
+CodigoRespuesta intentar_reserva(Parque* p, char* familia, int inicio, int personas, uint32_t agente, MsgRespuesta* resp);
+// Reserva las franjas de DURACION_RESERVA desde una franja si todavia hay cupo, retorna 1 si lo logro
+//Si la logra le asigna a r su id
+int reservar_bloque(Parque* p, int franja, Reserva* r);
+// Cancela una reserva del agente que la pide si su estadia no ha empezado, retorna el codigo de la respuesta
+int cancelar_reserva(Parque* p, const MsgSolicitud* sol, MsgRespuesta* resp);
+// Mueve una reserva del agente a otro inicio o con otras personas, todo o nada; retorna el codigo de la respuesta
+int modificar_reserva(Parque* p, const MsgSolicitud* sol, MsgRespuesta* resp);
+// Busca un bloque libre el mismo dia desde una franja para reprogramar una reserva
+int buscar_bloque_libre(Parque* p, int personas, int desde, int* nueva_franja);
+// Igual que buscar_bloque_libre pero elige el inicio mas cercano a la franja pedida (en empate, el anterior)
+int buscar_bloque_cercano(Parque* p, int personas, int desde, int pedida, int* nueva_franja);
+// Suma delta a la ocupacion de las posiciones [desde, hasta] de la ventana y al indice, con sus cerrojos tomados
+void ajustar_ocupacion(Parque* p, int desde, int hasta, int delta);
+// Llena resp con las personas libres de cada franja abierta del rango consultado, sin tomar cerrojos
+void consultar_disponibilidad(Parque* p, const MsgConsulta* c, MsgDisponibilidad* resp);
+// Escribe las estadisticas actuales: contadores, profundidad de la cola, tiempos por etapa y solicitudes por agente
+void escribir_estadisticas(FILE* f);
+// Lanza el hilo que reescribe el archivo de estadisticas cada PERIODO_ESTADISTICAS segundos
+void iniciar_estadisticas(void);
+// Detiene ese hilo dejando el archivo con los valores finales
+void detener_estadisticas(void);
+// Reconstruye parques, agentes, contadores y reloj desde el ultimo punto de control y la cola del registro
+void recuperar_estado(void);
+// Con -b, guarda el estado de arranque y empieza a anotar cada cambio
+void iniciar_bitacora(void);
+// Lanza el escritor del diario con el nivel de detalle de -g
+void iniciar_diario(int nivel);
+//Muestra un reporte final de la simulacion
+void imprimir_reporte(void);
+//Le indica todos los agentes que se termino la simulacion
+void terminar_agentes(void);
+//limpia los recursos y borra el pipe del controlador
+void limpiar_recursos(void);
+
 #endif 
 
 /******************************************************
@@ -110,5 +233,5 @@ void limpiar_recursos(void);
 * controlador puede coordinar múltiples agentes, validar 
 * aforos, reprogramar reservas y mantener la consistencia 
 * del sistema en tiempo real.
-******************************************************/
-
+******************************************************/
+
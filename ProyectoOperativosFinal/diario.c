@@ -0,0 +1,239 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto diario.c
+*
+* Descripción:
+* Este archivo implementa los anillos del diario y su hilo escritor. Cada
+* anillo tiene un solo productor y un solo consumidor, asi que basta con
+* publicar la cabeza con memory_order_release. El escritor recorre los
+* anillos, formatea en bloques de 64 KB y los escribe juntos con writev.
+******************************************************/
+#include <stdio.h> //Libreria para fflush y perror
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <string.h> //Libreria para memcpy
+#include <errno.h> //Libreria para reintentar si una senal interrumpe writev
+#include <pthread.h> //Libreria para el hilo escritor
+#include <signal.h> //Libreria para que el escritor no reciba senales
+#include <time.h> //Libreria para nanosleep
+#include <unistd.h> //Libreria para STDOUT_FILENO
+#include <sys/uio.h> //Libreria para writev
+
+#include "diario.h"
+
+static AnilloDiario* anillos = NULL; //Un anillo por hilo
+static int num_anillos = 0; //Hilos con anillo
+static int nivel_diario = 0; //Mayor nivel de detalle que se escribe
+static FormatoDiario formatear = NULL; //Convierte los tipos propios del controlador en texto
+static _Thread_local AnilloDiario* propio = NULL; //Anillo del hilo que llama, NULL si no escribe en el diario
+static pthread_t hilo_escritor; //Formatea y escribe los registros
+static atomic_int fin_escritor = 0; //1 cuando diario_detener pide terminar
+static atomic_ullong escritos = 0; //Registros formateados, solo los suma el escritor
+
+static char bloques[BLOQUES_DIARIO][TAM_BLOQUE_DIARIO]; //Texto pendiente de escribir, solo lo usa el escritor
+static struct iovec partes[BLOQUES_DIARIO]; //Una parte por bloque usado
+static int bloque_actual = 0; //Bloque donde se esta formateando
+
+//Escribe todos los bloques con writev, reintentando las escrituras parciales, y los deja vacios
+static void escribir_bloques(void) {
+    int n = bloque_actual + 1;
+    struct iovec* p = partes;
+    for (int i = 0; i < n; i++) partes[i].iov_base = bloques[i];
+    while (n > 0) {
+        if (p->iov_len == 0) { p++; n--; continue; }
+        ssize_t w = writev(STDOUT_FILENO, p, n);
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            perror("writev diario"); //La salida se cerro: lo pendiente se pierde
+            break;
+        }
+        while (n > 0 && (size_t)w >= p->iov_len) { w -= (ssize_t)p->iov_len; p->iov_len = 0; p++; n--; }
+        if (n > 0) { p->iov_base = (char*)p->iov_base + w; p->iov_len -= (size_t)w; }
+    }
+    for (int i = 0; i < BLOQUES_DIARIO; i++) partes[i].iov_len = 0;
+    bloque_actual = 0;
+}
+
+//Formatea un registro al final del bloque actual; si ya no cabe pasa al siguiente o escribe todos
+static void agregar(const RegistroDiario* r) {
+    if (partes[bloque_actual].iov_len + MAX_FORMATO_DIARIO > TAM_BLOQUE_DIARIO) {
+        if (bloque_actual + 1 < BLOQUES_DIARIO) bloque_actual++;
+        else escribir_bloques();
+    }
+    char* destino = bloques[bloque_actual] + partes[bloque_actual].iov_len;
+    size_t n;
+    if (r->tipo == DIARIO_TEXTO) {
+        n = r->largo;
+        memcpy(destino, r->texto, n);
+    } else {
+        n = formatear(r, destino);
+    }
+    partes[bloque_actual].iov_len += n;
+}
+
+//Formatea todo lo publicado en los anillos, retorna cuantos registros encontro
+static uint64_t vaciar_anillos(void) {
+    uint64_t total = 0;
+    for (int i = 0; i < num_anillos; i++) {
+        AnilloDiario* a = &anillos[i];
+        uint64_t cola = atomic_load_explicit(&a->cola, memory_order_relaxed);
+        uint64_t cabeza = atomic_load_explicit(&a->cabeza, memory_order_acquire); //Los registros ya estan escritos
+        for (uint64_t k = cola; k < cabeza; k++) {
+            agregar(&a->registros[k & (CAPACIDAD_DIARIO - 1)]);
+            if ((k & (LIBERAR_DIARIO - 1)) == LIBERAR_DIARIO - 1) //En una rafaga el productor recupera espacio sin esperar la vuelta completa
+                atomic_store_explicit(&a->cola, k + 1, memory_order_release);
+        }
+        atomic_store_explicit(&a->cola, cabeza, memory_order_release); //El productor puede volver a usar esos espacios
+        total += cabeza - cola;
+    }
+    atomic_store_explicit(&escritos, atomic_load_explicit(&escritos, memory_order_relaxed) + total, memory_order_relaxed);
+    return total;
+}
+
+//Hilo escritor: vacia los anillos, escribe y duerme un momento si no habia nada
+static void* escritor(void* arg) {
+    (void)arg;
+    struct timespec espera = { 0, ESPERA_DIARIO_US * 1000L };
+    for (;;) {
+        int fin = atomic_load(&fin_escritor); //Se lee antes de vaciar: lo publicado antes del aviso se alcanza a escribir
+        uint64_t n = vaciar_anillos();
+        if (partes[0].iov_len > 0) escribir_bloques();
+        if (n == 0) {
+            if (fin) break;
+            nanosleep(&espera, NULL);
+        }
+    }
+    return NULL;
+}
+
+// Crea un anillo por hilo (el 0 es el de eventos) y lanza el escritor sin recibir senales, retorna 0 o -1
+int diario_iniciar(int num_hilos, int nivel, FormatoDiario formato) {
+    anillos = aligned_alloc(64, sizeof(AnilloDiario) * (size_t)num_hilos);
+    if (!anillos) return -1;
+    for (int i = 0; i < num_hilos; i++) {
+        atomic_init(&anillos[i].cabeza, 0);
+        atomic_init(&anillos[i].cola, 0);
+        atomic_init(&anillos[i].descartados, 0);
+        anillos[i].pendientes = 0;
+        anillos[i].registros = malloc(sizeof(RegistroDiario) * CAPACIDAD_DIARIO);
+        if (!anillos[i].registros) return -1;
+    }
+    num_anillos = num_hilos;
+    nivel_diario = nivel;
+    formatear = formato;
+    fflush(stdout); //Lo que ya se mostro con printf sale antes que lo del escritor
+    //El escritor nace con todas las senales bloqueadas: si no, el kernel puede entregarle un SIGINT que el
+    //proceso espera recibir por signalfd y el controlador termina sin reporte ni punto de control
+    sigset_t todas, anteriores;
+    sigfillset(&todas);
+    pthread_sigmask(SIG_BLOCK, &todas, &anteriores);
+    int creado = pthread_create(&hilo_escritor, NULL, escritor, NULL);
+    pthread_sigmask(SIG_SETMASK, &anteriores, NULL); //Quien llama conserva su mascara
+    if (creado != 0) return -1;
+    return 0;
+}
+
+// Indica que el hilo que llama escribe en el anillo de la posicion indice
+void diario_usar_hilo(int indice) {
+    propio = indice >= 0 && indice < num_anillos ? &anillos[indice] : NULL;
+}
+
+// Retorna 1 si el hilo que llama tiene anillo y el diario escribe ese nivel de detalle
+int diario_activo(int nivel) {
+    return propio != NULL && nivel <= nivel_diario && !atomic_load_explicit(&fin_escritor, memory_order_relaxed);
+}
+
+// Registros que todavia caben en el anillo del hilo
+int diario_libres(void) {
+    if (!propio) return 0;
+    uint64_t usados = atomic_load_explicit(&propio->cabeza, memory_order_relaxed) + propio->pendientes -
+                      atomic_load_explicit(&propio->cola, memory_order_acquire);
+    return (int)(CAPACIDAD_DIARIO - usados);
+}
+
+// Cuenta n registros como descartados sin intentar reservarlos
+void diario_descartar(int n) {
+    if (!propio) return;
+    atomic_store_explicit(&propio->descartados,
+                          atomic_load_explicit(&propio->descartados, memory_order_relaxed) + (uint64_t)n,
+                          memory_order_relaxed);
+}
+
+// Retorna 1 si caben n registros mas en el anillo del hilo; si no, los cuenta como descartados
+int diario_reservar(int n) {
+    if (n <= diario_libres()) return 1;
+    diario_descartar(n);
+    return 0;
+}
+
+// Pone un registro despues de los que ya se pusieron; debe haberse reservado
+void diario_poner(const RegistroDiario* r) {
+    uint64_t posicion = atomic_load_explicit(&propio->cabeza, memory_order_relaxed) + propio->pendientes++;
+    propio->registros[posicion & (CAPACIDAD_DIARIO - 1)] = *r;
+}
+
+// Deja que el escritor vea todo lo puesto desde la ultima publicacion, como un solo evento
+void diario_publicar(void) {
+    uint64_t cabeza = atomic_load_explicit(&propio->cabeza, memory_order_relaxed);
+    atomic_store_explicit(&propio->cabeza, cabeza + propio->pendientes, memory_order_release);
+    propio->pendientes = 0;
+}
+
+// Si el nivel esta activo, parte el texto en registros DIARIO_TEXTO y los publica como un solo evento
+void diario_texto(int nivel, const char* texto, size_t largo) {
+    if (!diario_activo(nivel)) return;
+    int n = (int)((largo + TAM_TEXTO_DIARIO - 1) / TAM_TEXTO_DIARIO);
+    if (!diario_reservar(n)) return;
+    RegistroDiario r = { .tipo = DIARIO_TEXTO };
+    for (size_t hecho = 0; hecho < largo; hecho += r.largo) {
+        r.largo = (uint8_t)(largo - hecho < TAM_TEXTO_DIARIO ? largo - hecho : TAM_TEXTO_DIARIO);
+        memcpy(r.texto, texto + hecho, r.largo);
+        diario_poner(&r);
+    }
+    diario_publicar();
+}
+
+// Escribe lo que quede en los anillos y detiene el escritor; desde ahi ningun hilo escribe en el diario
+void diario_detener(void) {
+    if (!anillos || atomic_load(&fin_escritor)) return;
+    atomic_store(&fin_escritor, 1);
+    pthread_join(hilo_escritor, NULL);
+}
+
+// Nivel de detalle configurado
+int diario_nivel(void) {
+    return nivel_diario;
+}
+
+// Registros que ya se escribieron
+uint64_t diario_escritos(void) {
+    return atomic_load_explicit(&escritos, memory_order_relaxed);
+}
+
+// Registros descartados por anillos llenos, sumando todos los hilos
+uint64_t diario_descartados(void) {
+    uint64_t total = 0;
+    for (int i = 0; i < num_anillos; i++)
+        total += atomic_load_explicit(&anillos[i].descartados, memory_order_relaxed);
+    return total;
+}
+
+// Libera los anillos
+void diario_destruir(void) {
+    for (int i = 0; i < num_anillos; i++) free(anillos[i].registros);
+    free(anillos);
+    anillos = NULL;
+    num_anillos = 0;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* El escritor es el unico que formatea, asi el texto de
+* un evento partido en varios registros sale seguido, y
+* los bloques de 64 KB hacen que una franja con miles de
+* familias cueste unas pocas llamadas a writev.
+******************************************************/
@@ -0,0 +1,100 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto diario.h
+*
+* Descripción:
+* Este archivo define el diario de eventos del controlador: lo que antes
+* se mostraba con printf en medio de cada solicitud o de cada avance del
+* reloj. Cada hilo deja registros binarios de tamano fijo en su propio
+* anillo, sin cerrojos, y un hilo escritor los convierte en texto y los
+* escribe en la salida estandar con writev. Si un anillo se llena, los
+* registros se descartan y se cuentan: el diario nunca frena a quien
+* decide reservas ni al reloj.
+******************************************************/
+#ifndef DIARIO_H
+#define DIARIO_H
+
+#include <stddef.h> //Libreria para size_t
+#include <stdint.h> //Libreria para enteros de tamano fijo
+#include <stdatomic.h> //Libreria para las posiciones de los anillos
+
+#define CAPACIDAD_DIARIO 65536 //Registros del anillo de cada hilo (potencia de 2); la memoria se toca solo al usarla
+#define LIBERAR_DIARIO 4096 //Registros formateados tras los que el escritor devuelve su espacio al anillo (potencia de 2)
+#define TAM_TEXTO_DIARIO 64 //Caracteres de texto de cada registro, alcanza para un nombre
+#define TAM_BLOQUE_DIARIO 65536 //Bytes de cada bloque de salida del escritor
+#define BLOQUES_DIARIO 8 //Bloques que junta el escritor en un solo writev
+#define MAX_FORMATO_DIARIO 512 //Mayor texto que puede producir un registro al formatearse
+#define ESPERA_DIARIO_US 1000 //Microsegundos que duerme el escritor cuando no encuentra nada
+#define DIARIO_TEXTO 0 //Tipo de los pedazos de texto libre de diario_texto; los demas los define quien formatea
+
+//Un evento o parte de uno; lo que significa cada campo depende del tipo
+typedef struct {
+    uint8_t tipo; //DIARIO_TEXTO o un tipo de quien usa el diario
+    uint8_t parque; //Parque del evento
+    uint8_t codigo; //Codigo de respuesta o marca del evento
+    uint8_t largo; //Caracteres usados de texto en un DIARIO_TEXTO
+    uint32_t agente; //Id del agente
+    int32_t minuto; //Instante del evento
+    int32_t personas; //Personas de la solicitud o del movimiento
+    int32_t cantidad; //Registros que siguen y forman parte del mismo evento
+    int32_t extra; //Dato adicional segun el tipo
+    char texto[TAM_TEXTO_DIARIO]; //Familia o pedazo de texto, sin terminar en '\0' si lo llena
+} RegistroDiario;
+
+//Convierte un registro en texto dentro de destino (con espacio para MAX_FORMATO_DIARIO), retorna los caracteres escritos
+//Solo la llama el hilo escritor, en el orden en que se publicaron los registros de cada anillo
+typedef size_t (*FormatoDiario)(const RegistroDiario* r, char* destino);
+
+//Anillo de un hilo: solo su hilo escribe cabeza y los registros, solo el escritor escribe cola
+typedef struct {
+    _Alignas(64) atomic_ullong cabeza; //Registros publicados
+    uint64_t pendientes; //Registros puestos pero todavia no publicados, solo los ve el propio hilo
+    atomic_ullong descartados; //Registros que no cupieron, solo los suma el propio hilo
+    _Alignas(64) atomic_ullong cola; //Registros que el escritor ya formateo
+    RegistroDiario* registros; //Arreglo circular de CAPACIDAD_DIARIO registros
+} AnilloDiario;
+
+// Crea un anillo por hilo (el 0 es el de eventos) y lanza el escritor sin recibir senales, retorna 0 o -1
+//nivel es el mayor nivel de detalle que se escribe; formato convierte los tipos propios en texto
+int diario_iniciar(int num_hilos, int nivel, FormatoDiario formato);
+// Indica que el hilo que llama escribe en el anillo de la posicion indice
+void diario_usar_hilo(int indice);
+// Retorna 1 si el hilo que llama tiene anillo y el diario escribe ese nivel de detalle
+int diario_activo(int nivel);
+// Retorna 1 si caben n registros mas en el anillo del hilo; si no, los cuenta como descartados
+int diario_reservar(int n);
+// Registros que todavia caben en el anillo del hilo
+int diario_libres(void);
+// Cuenta n registros como descartados sin intentar reservarlos
+void diario_descartar(int n);
+// Pone un registro despues de los que ya se pusieron; debe haberse reservado
+void diario_poner(const RegistroDiario* r);
+// Deja que el escritor vea todo lo puesto desde la ultima publicacion, como un solo evento
+void diario_publicar(void);
+// Si el nivel esta activo, parte el texto en registros DIARIO_TEXTO y los publica como un solo evento
+void diario_texto(int nivel, const char* texto, size_t largo);
+// Escribe lo que quede en los anillos y detiene el escritor; desde ahi ningun hilo escribe en el diario
+void diario_detener(void);
+// Nivel de detalle configurado
+int diario_nivel(void);
+// Registros que ya se escribieron
+uint64_t diario_escritos(void);
+// Registros descartados por anillos llenos, sumando todos los hilos
+uint64_t diario_descartados(void);
+// Libera los anillos
+void diario_destruir(void);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con un anillo por hilo, dejar un evento cuesta copiar
+* unos cuantos bytes y publicar una posicion; formatear y
+* escribir pasa a otro hilo, y una salida lenta solo hace
+* que se descarten registros, nunca que se esperen.
+******************************************************/
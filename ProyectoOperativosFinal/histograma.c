@@ -0,0 +1,75 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto histograma.c
+*
+* Descripción:
+* Este archivo implementa el histograma logaritmico-lineal de latencias.
+* Los valores menores a 128 tienen una cubeta cada uno; desde ahi, cada
+* potencia de 2 se reparte en 128 cubetas del mismo ancho, de modo que
+* el ancho de una cubeta nunca supera 1/128 de los valores que guarda.
+******************************************************/
+#include <string.h> //Libreria para memset
+
+#include "histograma.h"
+
+//Cubeta donde cae un valor
+static int cubeta(uint64_t v) {
+    if (v < SUBCUBETAS) return (int)v;
+    int e = 63 - __builtin_clzll(v); //Posicion del bit mas alto, al menos BITS_SUBCUBETA
+    uint64_t mantisa = v >> (e - BITS_SUBCUBETA); //Entre SUBCUBETAS y 2 * SUBCUBETAS - 1
+    return (e - BITS_SUBCUBETA + 1) * SUBCUBETAS + (int)(mantisa - SUBCUBETAS);
+}
+
+//Mayor valor que cae en la cubeta i
+static uint64_t tope_cubeta(int i) {
+    if (i < SUBCUBETAS) return (uint64_t)i;
+    int e = i / SUBCUBETAS + BITS_SUBCUBETA - 1;
+    uint64_t mantisa = (uint64_t)(i % SUBCUBETAS + SUBCUBETAS);
+    int corrimiento = e - BITS_SUBCUBETA;
+    return (mantisa << corrimiento) + ((1ULL << corrimiento) - 1);
+}
+
+void histograma_iniciar(Histograma* h) {
+    memset(h, 0, sizeof(*h));
+    h->minimo = UINT64_MAX;
+}
+
+void histograma_registrar(Histograma* h, uint64_t valor) {
+    histograma_registrar_varios(h, valor, 1);
+}
+
+void histograma_registrar_varios(Histograma* h, uint64_t valor, uint64_t cantidad) {
+    h->conteos[cubeta(valor)] += cantidad;
+    h->total += cantidad;
+    if (valor < h->minimo) h->minimo = valor;
+    if (valor > h->maximo) h->maximo = valor;
+}
+
+//Recorre las cubetas hasta juntar el rango pedido; el tope de la cubeta nunca pasa del maximo real
+uint64_t histograma_percentil(const Histograma* h, double p) {
+    if (h->total == 0) return 0;
+    uint64_t objetivo = (uint64_t)(p / 100.0 * (double)h->total + 0.5);
+    if (objetivo < 1) objetivo = 1;
+    if (objetivo > h->total) objetivo = h->total;
+    uint64_t acumulado = 0;
+    for (int i = 0; i < NUM_CUBETAS; i++) {
+        acumulado += h->conteos[i];
+        if (acumulado >= objetivo) {
+            uint64_t v = tope_cubeta(i);
+            return v > h->maximo ? h->maximo : v < h->minimo ? h->minimo : v;
+        }
+    }
+    return h->maximo;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con cubetas calculadas a partir del bit mas alto del valor,
+* registrar una latencia no depende de cuantas haya y el
+* resultado se puede reportar con precision fija.
+******************************************************/
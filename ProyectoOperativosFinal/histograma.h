@@ -0,0 +1,48 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto histograma.h
+*
+* Descripción:
+* Este archivo define un histograma de latencias al estilo HDR: los
+* valores se agrupan en cubetas cuyo ancho crece con cada potencia de 2,
+* y cada potencia se divide en 128 sub-cubetas iguales. Asi el error de
+* cualquier percentil es menor al 1% tanto para microsegundos como para
+* minutos, con un arreglo de tamano fijo y registro en tiempo constante.
+******************************************************/
+#ifndef HISTOGRAMA_H
+#define HISTOGRAMA_H
+
+#include <stdint.h> //Libreria para enteros de tamano fijo
+
+#define BITS_SUBCUBETA 7 //128 sub-cubetas por potencia de 2: error relativo menor a 1/128
+#define SUBCUBETAS (1 << BITS_SUBCUBETA)
+#define NUM_CUBETAS ((64 - BITS_SUBCUBETA + 1) * SUBCUBETAS) //Alcanza para cualquier uint64_t
+
+typedef struct {
+    uint64_t conteos[NUM_CUBETAS]; //Valores registrados en cada cubeta
+    uint64_t total; //Valores registrados en total
+    uint64_t minimo, maximo; //Extremos exactos
+} Histograma;
+
+// Deja el histograma vacio
+void histograma_iniciar(Histograma* h);
+// Registra un valor (por ejemplo, nanosegundos)
+void histograma_registrar(Histograma* h, uint64_t valor);
+// Registra cantidad veces el mismo valor
+void histograma_registrar_varios(Histograma* h, uint64_t valor, uint64_t cantidad);
+// Retorna el valor bajo el cual queda el percentil p (0 a 100), o 0 si esta vacio
+uint64_t histograma_percentil(const Histograma* h, double p);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* El histograma reemplaza ordenar todas las latencias: cada
+* medicion cuesta una suma y los percentiles se leen de un
+* arreglo fijo, sin importar cuantas solicitudes se midan.
+******************************************************/
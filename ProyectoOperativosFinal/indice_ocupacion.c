@@ -0,0 +1,169 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto indice_ocupacion.c
+*
+* Descripción:
+* Este archivo implementa el arbol de segmentos de ocupacion. Las sumas
+* por rango dejan una marca pendiente en los nodos que cubren el rango
+* completo y nunca la bajan a los hijos; las consultas acumulan las
+* marcas de los ancestros mientras descienden. Asi ninguna consulta
+* modifica el arbol y varias pueden correr a la vez con un cerrojo de
+* lectura.
+******************************************************/
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <limits.h> //Libreria para INT_MIN
+
+#include "indice_ocupacion.h"
+
+static int mayor(int a, int b) { return a > b ? a : b; }
+static int menor(int a, int b) { return a < b ? a : b; }
+
+// Crea un indice de n franjas en cero, retorna 0 o -1 si no hay memoria
+int indice_crear(IndiceOcupacion* ix, int n) {
+    ix->n = n;
+    ix->maximo = calloc(4 * (size_t)n, sizeof(int)); //Un arbol de n hojas cabe en 4n nodos
+    ix->minimo = calloc(4 * (size_t)n, sizeof(int));
+    ix->pendiente = calloc(4 * (size_t)n, sizeof(int));
+    pthread_rwlock_init(&ix->cerrojo, NULL);
+    if (!ix->maximo || !ix->minimo || !ix->pendiente) {
+        indice_destruir(ix);
+        return -1;
+    }
+    return 0;
+}
+
+// Libera la memoria del indice
+void indice_destruir(IndiceOcupacion* ix) {
+    free(ix->maximo);
+    free(ix->minimo);
+    free(ix->pendiente);
+    ix->maximo = ix->minimo = ix->pendiente = NULL;
+    pthread_rwlock_destroy(&ix->cerrojo);
+}
+
+static void sumar(IndiceOcupacion* ix, int nodo, int l, int r, int ql, int qr, int delta) {
+    if (qr < l || r < ql) return; //El rango no toca este nodo
+    if (ql <= l && r <= qr) { //El nodo queda cubierto: se marca y no se baja
+        ix->maximo[nodo] += delta;
+        ix->minimo[nodo] += delta;
+        ix->pendiente[nodo] += delta;
+        return;
+    }
+    int m = (l + r) / 2;
+    sumar(ix, 2 * nodo, l, m, ql, qr, delta);
+    sumar(ix, 2 * nodo + 1, m + 1, r, ql, qr, delta);
+    ix->maximo[nodo] = mayor(ix->maximo[2 * nodo], ix->maximo[2 * nodo + 1]) + ix->pendiente[nodo];
+    ix->minimo[nodo] = menor(ix->minimo[2 * nodo], ix->minimo[2 * nodo + 1]) + ix->pendiente[nodo];
+}
+
+static int maximo(IndiceOcupacion* ix, int nodo, int l, int r, int ql, int qr) {
+    if (qr < l || r < ql) return INT_MIN;
+    if (ql <= l && r <= qr) return ix->maximo[nodo];
+    int m = (l + r) / 2;
+    return mayor(maximo(ix, 2 * nodo, l, m, ql, qr), maximo(ix, 2 * nodo + 1, m + 1, r, ql, qr)) + ix->pendiente[nodo];
+}
+
+//Busca en [ql, qr] la primera (o ultima) franja cuyo valor cumple la condicion.
+//libre = 1 busca valor <= limite, libre = 0 busca valor > limite. 'acumulado' son las marcas de los ancestros.
+static int buscar(IndiceOcupacion* ix, int nodo, int l, int r, int ql, int qr,
+                  int limite, int libre, int desde_la_derecha, int acumulado) {
+    if (qr < l || r < ql) return -1;
+    //Si ninguna franja del subarbol puede cumplir, se poda
+    if (libre && ix->minimo[nodo] + acumulado > limite) return -1;
+    if (!libre && ix->maximo[nodo] + acumulado <= limite) return -1;
+    if (l == r) return l;
+    int m = (l + r) / 2;
+    acumulado += ix->pendiente[nodo];
+    int res;
+    if (desde_la_derecha) {
+        res = buscar(ix, 2 * nodo + 1, m + 1, r, ql, qr, limite, libre, 1, acumulado);
+        if (res == -1) res = buscar(ix, 2 * nodo, l, m, ql, qr, limite, libre, 1, acumulado);
+    } else {
+        res = buscar(ix, 2 * nodo, l, m, ql, qr, limite, libre, 0, acumulado);
+        if (res == -1) res = buscar(ix, 2 * nodo + 1, m + 1, r, ql, qr, limite, libre, 0, acumulado);
+    }
+    return res;
+}
+
+// Suma delta a todas las franjas del rango [desde, hasta]
+void indice_sumar(IndiceOcupacion* ix, int desde, int hasta, int delta) {
+    if (desde < 0) desde = 0;
+    if (hasta >= ix->n) hasta = ix->n - 1;
+    if (desde > hasta) return;
+    pthread_rwlock_wrlock(&ix->cerrojo);
+    sumar(ix, 1, 0, ix->n - 1, desde, hasta, delta);
+    pthread_rwlock_unlock(&ix->cerrojo);
+}
+
+// Retorna la ocupacion maxima del rango [desde, hasta]
+int indice_maximo(IndiceOcupacion* ix, int desde, int hasta) {
+    pthread_rwlock_rdlock(&ix->cerrojo);
+    int res = maximo(ix, 1, 0, ix->n - 1, desde, hasta);
+    pthread_rwlock_unlock(&ix->cerrojo);
+    return res;
+}
+
+//Primer inicio valido sin tomar el cerrojo. Cada vuelta salta una franja llena, por lo que
+//la cantidad de vueltas depende de los huecos encontrados y no del tamano del calendario
+static int primer_bloque(IndiceOcupacion* ix, int desde, int ultimo_inicio, int largo, int limite) {
+    int s = desde < 0 ? 0 : desde;
+    while (s <= ultimo_inicio) {
+        s = buscar(ix, 1, 0, ix->n - 1, s, ultimo_inicio, limite, 1, 0, 0); //Primera franja con cupo
+        if (s == -1) return -1;
+        int lleno = buscar(ix, 1, 0, ix->n - 1, s, s + largo - 1, limite, 0, 0, 0); //Primera franja sin cupo en la ventana
+        if (lleno == -1) return s;
+        s = lleno + 1; //Ninguna ventana que contenga esa franja sirve
+    }
+    return -1;
+}
+
+//Ultimo inicio valido en [desde, ultimo_inicio] sin tomar el cerrojo
+static int ultimo_bloque(IndiceOcupacion* ix, int desde, int ultimo_inicio, int largo, int limite) {
+    int e = ultimo_inicio;
+    if (desde < 0) desde = 0;
+    while (e >= desde) {
+        e = buscar(ix, 1, 0, ix->n - 1, desde, e, limite, 1, 1, 0); //Ultima franja con cupo
+        if (e == -1) return -1;
+        int lleno = buscar(ix, 1, 0, ix->n - 1, e, e + largo - 1, limite, 0, 1, 0); //Ultima franja sin cupo en la ventana
+        if (lleno == -1) return e;
+        e = lleno - largo; //La ventana debe terminar antes de esa franja
+    }
+    return -1;
+}
+
+// Primera franja de inicio en [desde, ultimo_inicio] cuyas 'largo' franjas tienen ocupacion <= limite, o -1
+int indice_primer_bloque(IndiceOcupacion* ix, int desde, int ultimo_inicio, int largo, int limite) {
+    if (ultimo_inicio + largo - 1 >= ix->n) ultimo_inicio = ix->n - largo;
+    if (limite < 0 || largo <= 0) return -1;
+    pthread_rwlock_rdlock(&ix->cerrojo);
+    int res = primer_bloque(ix, desde, ultimo_inicio, largo, limite);
+    pthread_rwlock_unlock(&ix->cerrojo);
+    return res;
+}
+
+// Igual que indice_primer_bloque pero elige el inicio mas cercano a 'pedido' (en empate, el anterior)
+int indice_bloque_cercano(IndiceOcupacion* ix, int desde, int ultimo_inicio, int pedido, int largo, int limite) {
+    if (ultimo_inicio + largo - 1 >= ix->n) ultimo_inicio = ix->n - largo;
+    if (limite < 0 || largo <= 0) return -1;
+    if (pedido < desde) pedido = desde;
+    if (pedido > ultimo_inicio) pedido = ultimo_inicio;
+    pthread_rwlock_rdlock(&ix->cerrojo);
+    int antes = ultimo_bloque(ix, desde, pedido, largo, limite); //Mejor opcion que no pasa de la hora pedida
+    int despues = pedido + 1 <= ultimo_inicio ? primer_bloque(ix, pedido + 1, ultimo_inicio, largo, limite) : -1;
+    pthread_rwlock_unlock(&ix->cerrojo);
+    if (antes == -1) return despues;
+    if (despues == -1) return antes;
+    return pedido - antes <= despues - pedido ? antes : despues;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Al no bajar las marcas pendientes, las consultas son de
+* solo lectura y no compiten entre si; solo las reservas
+* toman el cerrojo de escritura, y por muy poco tiempo.
+******************************************************/
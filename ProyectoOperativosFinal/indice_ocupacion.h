@@ -0,0 +1,51 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto indice_ocupacion.h
+*
+* Descripción:
+* Este archivo define un arbol de segmentos sobre la ocupacion de cada
+* franja del parque. Permite sumar personas a un rango de franjas y
+* consultar el maximo de un rango en tiempo logaritmico, y con eso
+* encontrar la primera ventana (o la mas cercana a una hora pedida)
+* donde cabe un grupo, sin recorrer todas las franjas una por una.
+******************************************************/
+#ifndef INDICE_OCUPACION_H
+#define INDICE_OCUPACION_H
+
+#include <pthread.h> // Libreria para el cerrojo de lectura/escritura
+
+typedef struct {
+    int n; //Cantidad de franjas que cubre el arbol
+    int* maximo; //Maximo de cada nodo, ya incluye la suma pendiente del propio nodo
+    int* minimo; //Minimo de cada nodo, ya incluye la suma pendiente del propio nodo
+    int* pendiente; //Suma que aplica a todo el subarbol y que no se baja a los hijos
+    pthread_rwlock_t cerrojo; //Las consultas solo leen, las sumas escriben
+} IndiceOcupacion;
+
+// Crea un indice de n franjas en cero, retorna 0 o -1 si no hay memoria
+int indice_crear(IndiceOcupacion* ix, int n);
+// Libera la memoria del indice
+void indice_destruir(IndiceOcupacion* ix);
+// Suma delta a todas las franjas del rango [desde, hasta]
+void indice_sumar(IndiceOcupacion* ix, int desde, int hasta, int delta);
+// Retorna la ocupacion maxima del rango [desde, hasta]
+int indice_maximo(IndiceOcupacion* ix, int desde, int hasta);
+// Primera franja de inicio en [desde, ultimo_inicio] cuyas 'largo' franjas tienen ocupacion <= limite, o -1
+int indice_primer_bloque(IndiceOcupacion* ix, int desde, int ultimo_inicio, int largo, int limite);
+// Igual que indice_primer_bloque pero elige el inicio mas cercano a 'pedido' (en empate, el anterior)
+int indice_bloque_cercano(IndiceOcupacion* ix, int desde, int ultimo_inicio, int pedido, int largo, int limite);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* El indice reemplaza los recorridos lineales sobre las
+* horas por consultas logaritmicas, lo que permite usar
+* calendarios mucho mas finos sin que buscar un bloque
+* libre se vuelva costoso.
+******************************************************/
@@ -0,0 +1,194 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto lector_csv.c
+*
+* Descripción:
+* Este archivo implementa el lector del archivo de solicitudes. El fin
+* de cada linea y las comas se buscan con memchr, que recorre la memoria
+* por bloques, y los numeros se convierten digito a digito con un tope
+* de digitos, asi ningun campo puede salirse de sus limites.
+******************************************************/
+#include <string.h> //libreria para memchr, memcmp y strlen
+#include <unistd.h> //Libreria para close
+#include <fcntl.h> // Libreria para open
+#include <sys/mman.h> //Libreria para mmap
+#include <sys/stat.h> //Libreria para fstat
+
+#include "lector_csv.h"
+
+int csv_abrir(LectorCsv* l, const char* archivo) {
+    l->datos = NULL;
+    l->largo = 0;
+    l->pos = 0;
+    l->linea = 0;
+    int fd = open(archivo, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) { //Un archivo vacio no se puede mapear, simplemente no tiene solicitudes
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL); //Se lee una sola vez de principio a fin
+        l->datos = p;
+        l->largo = (size_t)st.st_size;
+    }
+    close(fd); //El mapeo sigue valido sin el descriptor
+    return 0;
+}
+
+//Quita los espacios y tabuladores de los dos extremos de [*ini, *fin)
+static void recortar(const char** ini, const char** fin) {
+    while (*ini < *fin && (**ini == ' ' || **ini == '\t')) (*ini)++;
+    while (*fin > *ini && ((*fin)[-1] == ' ' || (*fin)[-1] == '\t')) (*fin)--;
+}
+
+//Convierte [ini, fin) en un entero entre 0 y maximo, retorna 0 o -1 si no es un numero valido
+static int leer_numero(const char* ini, const char* fin, int maximo, int* valor) {
+    recortar(&ini, &fin);
+    if (ini == fin || fin - ini > MAX_DIGITOS_CSV) return -1;
+    int v = 0;
+    for (const char* p = ini; p < fin; p++) {
+        if (*p < '0' || *p > '9') return -1;
+        v = v * 10 + (*p - '0');
+    }
+    if (v > maximo) return -1;
+    *valor = v;
+    return 0;
+}
+
+//Convierte [ini, fin) escrito como [dia/]hora[:minutos] en minutos desde las 00:00 del dia 0, retorna 0 o -1
+static int leer_instante(const char* ini, const char* fin, int* minuto) {
+    int dia = 0, hora, minutos = 0;
+    const char* barra = memchr(ini, '/', (size_t)(fin - ini));
+    if (barra) {
+        if (leer_numero(ini, barra, MAX_DIAS - 1, &dia) == -1) return -1;
+        ini = barra + 1;
+    }
+    const char* dos_puntos = memchr(ini, ':', (size_t)(fin - ini));
+    if (dos_puntos && leer_numero(dos_puntos + 1, fin, MAX_MINUTO_CSV, &minutos) == -1) return -1;
+    if (leer_numero(ini, dos_puntos ? dos_puntos : fin, MAX_HORA_CSV, &hora) == -1) return -1;
+    *minuto = dia * MINUTOS_DIA + hora * 60 + minutos;
+    return 0;
+}
+
+//Valida la familia de [ini, fin) y la deja en la fila, retorna 0 o -1 con el motivo en error
+static int leer_familia(const char* ini, const char* fin, FilaCsv* f, const char** error) {
+    recortar(&ini, &fin);
+    if (ini == fin) {
+        *error = "familia vacia";
+        return -1;
+    }
+    if (fin - ini > MAX_NOMBRE - 1) {
+        *error = "familia demasiado larga";
+        return -1;
+    }
+    f->familia = ini;
+    f->largo_familia = (int)(fin - ini);
+    return 0;
+}
+
+//Retorna 1 si [ini, fin), sin los espacios de los extremos, es exactamente la palabra
+static int es_palabra(const char* ini, const char* fin, const char* palabra) {
+    recortar(&ini, &fin);
+    size_t n = strlen(palabra);
+    return (size_t)(fin - ini) == n && memcmp(ini, palabra, n) == 0;
+}
+
+int csv_siguiente(LectorCsv* l, FilaCsv* f, const char** error) {
+    while (l->pos < l->largo) {
+        const char* ini = l->datos + l->pos;
+        const char* fin_archivo = l->datos + l->largo;
+        const char* fin = memchr(ini, '\n', (size_t)(fin_archivo - ini));
+        if (!fin) fin = fin_archivo; //Ultima linea sin salto
+        l->pos = (size_t)(fin - l->datos) + 1;
+        l->linea++;
+        if (fin > ini && fin[-1] == '\r') fin--; //Archivos con fin de linea de Windows
+
+        const char* p = ini;
+        const char* q = fin;
+        recortar(&p, &q);
+        if (p == q) continue; //Linea vacia
+
+        //Un cambio empieza con su verbo; lo que sigue tiene la misma forma que una solicitud
+        const char* coma0 = memchr(ini, ',', (size_t)(fin - ini));
+        f->operacion = MSG_SOLICITUD;
+        if (coma0 && es_palabra(ini, coma0, "CANCELAR")) f->operacion = MSG_CANCELAR;
+        else if (coma0 && es_palabra(ini, coma0, "MODIFICAR")) f->operacion = MSG_MODIFICAR;
+        else if (coma0 && es_palabra(ini, coma0, "DISPONIBILIDAD")) f->operacion = MSG_DISPONIBILIDAD;
+        if (f->operacion != MSG_SOLICITUD) ini = coma0 + 1;
+        f->inicio = f->hasta = f->personas = f->parque = 0;
+        if (f->operacion == MSG_CANCELAR) {
+            if (memchr(ini, ',', (size_t)(fin - ini))) {
+                *error = "se esperaban dos campos: CANCELAR,familia";
+                return -1;
+            }
+            return leer_familia(ini, fin, f, error) == 0 ? 1 : -1;
+        }
+
+        const char* coma1 = memchr(ini, ',', (size_t)(fin - ini));
+        const char* coma2 = coma1 ? memchr(coma1 + 1, ',', (size_t)(fin - coma1 - 1)) : NULL;
+        const char* coma3 = coma2 ? memchr(coma2 + 1, ',', (size_t)(fin - coma2 - 1)) : NULL; //Parque, opcional
+        if (!coma2 || (coma3 && memchr(coma3 + 1, ',', (size_t)(fin - coma3 - 1)))) {
+            *error = "se esperaban tres o cuatro campos: familia,hora,personas[,parque]";
+            return -1;
+        }
+        if (coma3 && f->operacion == MSG_MODIFICAR) { //El parque ya va en el id de la reserva
+            *error = "se esperaban cuatro campos: MODIFICAR,familia,hora,personas";
+            return -1;
+        }
+        const char* fin_personas = coma3 ? coma3 : fin;
+        if (f->operacion == MSG_DISPONIBILIDAD) { //En lugar de familia y hora van las dos horas del rango
+            f->familia = ini;
+            f->largo_familia = 0;
+            if (leer_instante(ini, coma1, &f->inicio) == -1 || leer_instante(coma1 + 1, coma2, &f->hasta) == -1 ||
+                f->hasta < f->inicio) {
+                *error = "rango de horas invalido";
+                return -1;
+            }
+        } else {
+            if (leer_familia(ini, coma1, f, error) == -1) return -1;
+            if (leer_instante(coma1 + 1, coma2, &f->inicio) == -1) {
+                *error = "hora invalida";
+                return -1;
+            }
+        }
+        //Una consulta puede ir sin grupo (0 personas): solo interesan los lugares libres
+        if (leer_numero(coma2 + 1, fin_personas, MAX_PERSONAS_CSV, &f->personas) == -1 ||
+            (f->personas == 0 && f->operacion != MSG_DISPONIBILIDAD)) {
+            *error = "cantidad de personas invalida";
+            return -1;
+        }
+        //Sin cuarto campo la solicitud va al primer parque
+        if (coma3 && leer_numero(coma3 + 1, fin, MAX_PARQUES - 1, &f->parque) == -1) {
+            *error = "parque invalido";
+            return -1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+void csv_cerrar(LectorCsv* l) {
+    if (l->datos) munmap((void*)l->datos, l->largo);
+    l->datos = NULL;
+    l->largo = 0;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Cada byte del archivo se toca una vez al buscar el fin de
+* linea y otra al separar los campos, sin copias ni llamadas
+* por linea, y una linea mal formada solo se reporta y se
+* salta en lugar de corromper la solicitud.
+******************************************************/
@@ -0,0 +1,67 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto lector_csv.h
+*
+* Descripción:
+* Este archivo define el lector del archivo de solicitudes del agente.
+* El archivo se mapea completo en memoria y cada linea
+* "familia,hora,personas[,parque]" se separa en su lugar, sin copiarla ni pedir
+* memoria: la familia queda como un puntero y una longitud dentro del
+* mapeo, y cada campo se valida con limites fijos antes de usarlo. Una
+* linea "CANCELAR,familia" o "MODIFICAR,familia,hora,personas" pide cambiar
+* la ultima reserva confirmada de esa familia, y una
+* "DISPONIBILIDAD,desde,hasta,personas[,parque]" pregunta que franjas
+* tienen lugar antes de pedir.
+******************************************************/
+#ifndef LECTOR_CSV_H
+#define LECTOR_CSV_H
+
+#include <stddef.h> //Libreria para size_t
+
+#include "protocolo.h" //MAX_NOMBRE, MAX_PARQUES, MAX_DIAS y MINUTOS_DIA
+
+#define MAX_DIGITOS_CSV 9 //Digitos maximos de un numero, asi nunca se desborda un int
+#define MAX_HORA_CSV 23 //Mayor hora que se puede pedir
+#define MAX_MINUTO_CSV 59 //Mayor minuto que se puede pedir
+#define MAX_PERSONAS_CSV 65535 //Mayor grupo que cabe en el campo de personas de la trama
+
+typedef struct {
+    const char* datos; //Archivo mapeado, NULL si esta vacio
+    size_t largo; //Bytes del archivo
+    size_t pos; //Inicio de la siguiente linea
+    long linea; //Numero de la ultima linea entregada
+} LectorCsv;
+
+//Una solicitud leida; la familia apunta dentro del archivo mapeado y no termina en '\0'
+typedef struct {
+    int operacion; //MSG_SOLICITUD, MSG_CANCELAR (sin hora ni personas), MSG_MODIFICAR (sin parque) o MSG_DISPONIBILIDAD
+    const char* familia; //En MSG_DISPONIBILIDAD no hay familia (largo 0)
+    int largo_familia; //Entre 1 y MAX_NOMBRE - 1
+    int inicio; //Minuto pedido desde las 00:00 del dia 0; en el archivo va como [dia/]hora[:minutos]
+    int hasta; //En MSG_DISPONIBILIDAD, ultimo minuto consultado (inicio es el primero)
+    int personas;
+    int parque; //0 si la linea no trae el cuarto campo
+} FilaCsv;
+
+// Mapea el archivo para leerlo, retorna 0 o -1 si no se pudo abrir
+int csv_abrir(LectorCsv* l, const char* archivo);
+// Entrega la siguiente fila: 1 si es valida, 0 al final del archivo, -1 si la linea esta mal y deja en error el motivo
+//Las lineas vacias se saltan sin avisar
+int csv_siguiente(LectorCsv* l, FilaCsv* f, const char** error);
+// Quita el mapeo del archivo
+void csv_cerrar(LectorCsv* l);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Leer el archivo sin copiarlo ni pasar por sscanf hace que
+* archivos de solicitudes de cualquier tamano se procesen a
+* la velocidad de la memoria, y los limites de cada campo
+* impiden que una familia larga desborde un buffer.
+******************************************************/
@@ -0,0 +1,128 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto metricas.c
+*
+* Descripción:
+* Este archivo implementa los contadores por hilo del controlador. Cada
+* etapa tiene un histograma logaritmico-lineal mas grueso que el de
+* histograma.c para que el bloque de cada hilo sea pequeno; al leerlos,
+* cada cubeta se pasa al histograma fino con su valor mas alto.
+******************************************************/
+#include <stdlib.h> //Libreria de memoria dinamica
+#include <time.h> //Libreria para clock_gettime
+
+#include "metricas.h"
+
+static MetricasHilo* bloques = NULL; //Un bloque por hilo
+static int num_bloques = 0; //Hilos con bloque
+static _Thread_local MetricasHilo* propio = NULL; //Bloque del hilo que llama, NULL si no mide
+
+//Cubeta de un tiempo, igual que en histograma.c pero con menos sub-cubetas
+static int cubeta_metrica(uint64_t v) {
+    if (v < (1u << BITS_SUBCUBETA_METRICA)) return (int)v;
+    int e = 63 - __builtin_clzll(v);
+    if (e >= MAX_BITS_METRICA) return NUM_CUBETAS_METRICA - 1;
+    uint64_t mantisa = v >> (e - BITS_SUBCUBETA_METRICA);
+    return ((e - BITS_SUBCUBETA_METRICA + 1) << BITS_SUBCUBETA_METRICA) + (int)(mantisa - (1u << BITS_SUBCUBETA_METRICA));
+}
+
+//Mayor tiempo que cae en la cubeta i
+static uint64_t tope_metrica(int i) {
+    if (i < (1 << BITS_SUBCUBETA_METRICA)) return (uint64_t)i;
+    int e = (i >> BITS_SUBCUBETA_METRICA) + BITS_SUBCUBETA_METRICA - 1;
+    uint64_t mantisa = (uint64_t)((i & ((1 << BITS_SUBCUBETA_METRICA) - 1)) + (1 << BITS_SUBCUBETA_METRICA));
+    int corrimiento = e - BITS_SUBCUBETA_METRICA;
+    return (mantisa << corrimiento) + ((1ULL << corrimiento) - 1);
+}
+
+int metricas_iniciar(int num_hilos) {
+    bloques = aligned_alloc(64, sizeof(MetricasHilo) * (size_t)num_hilos);
+    if (!bloques) return -1;
+    for (int i = 0; i < num_hilos; i++) {
+        for (int e = 0; e < NUM_ETAPAS; e++) {
+            for (int k = 0; k < NUM_CUBETAS_METRICA; k++) atomic_init(&bloques[i].conteos[e][k], 0);
+            atomic_init(&bloques[i].maximo[e], 0);
+        }
+        atomic_init(&bloques[i].solicitudes, 0);
+    }
+    num_bloques = num_hilos;
+    return 0;
+}
+
+void metricas_usar_hilo(int indice) {
+    propio = indice >= 0 && indice < num_bloques ? &bloques[indice] : NULL;
+}
+
+uint64_t metricas_ahora(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+void contador_sumar(atomic_ullong* c, uint64_t n) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+void metricas_registrar(EtapaMetrica etapa, uint64_t desde_ns) {
+    if (!propio) return;
+    uint64_t t = metricas_ahora() - desde_ns;
+    contador_sumar(&propio->conteos[etapa][cubeta_metrica(t)], 1);
+    if (t > atomic_load_explicit(&propio->maximo[etapa], memory_order_relaxed))
+        atomic_store_explicit(&propio->maximo[etapa], t, memory_order_relaxed);
+}
+
+void metricas_contar(uint64_t n) {
+    if (propio) contador_sumar(&propio->solicitudes, n);
+}
+
+//Las lecturas pueden ver un hilo a medio registrar; a lo sumo falta la ultima medicion
+void metricas_juntar(EtapaMetrica etapa, Histograma* h) {
+    uint64_t maximo = 0;
+    for (int i = 0; i < num_bloques; i++) {
+        for (int k = 0; k < NUM_CUBETAS_METRICA; k++) {
+            uint64_t n = atomic_load_explicit(&bloques[i].conteos[etapa][k], memory_order_relaxed);
+            if (n > 0) histograma_registrar_varios(h, tope_metrica(k), n);
+        }
+        uint64_t m = atomic_load_explicit(&bloques[i].maximo[etapa], memory_order_relaxed);
+        if (m > maximo) maximo = m;
+    }
+    if (h->total > 0) h->maximo = maximo; //El maximo exacto reemplaza al tope de la ultima cubeta
+}
+
+uint64_t metricas_solicitudes(int indice) {
+    return atomic_load_explicit(&bloques[indice].solicitudes, memory_order_relaxed);
+}
+
+int metricas_hilos(void) {
+    return num_bloques;
+}
+
+const char* nombre_etapa(EtapaMetrica etapa) {
+    switch (etapa) {
+        case ETAPA_LECTURA: return "lectura";
+        case ETAPA_DECODIFICACION: return "decodificacion";
+        case ETAPA_COLA: return "cola";
+        case ETAPA_DECISION: return "decision";
+        case ETAPA_RESPUESTA: return "respuesta";
+        case ETAPA_BITACORA: return "bitacora";
+        default: return "desconocida";
+    }
+}
+
+void metricas_destruir(void) {
+    free(bloques);
+    bloques = NULL;
+    num_bloques = 0;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Los hilos nunca esperan por las metricas: escriben en su
+* propio bloque y el lector solo suma lo que encuentra, asi
+* se puede consultar un controlador en plena carga.
+******************************************************/
@@ -0,0 +1,79 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto metricas.h
+*
+* Descripción:
+* Este archivo define las metricas que el controlador lleva mientras
+* corre: cuanto tarda cada etapa de una solicitud (lectura, decodificacion,
+* espera en la cola, decision y escritura de la respuesta). Cada hilo
+* escribe solo en su propio bloque de contadores, sin cerrojos, y
+* cualquier otro hilo puede leerlos en cualquier momento para armar los
+* histogramas sin detener al controlador.
+******************************************************/
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdint.h> //Libreria para enteros de tamano fijo
+#include <stdatomic.h> //Libreria para los contadores que leen otros hilos
+
+#include "histograma.h" //Histograma donde se juntan los contadores de todos los hilos
+
+#define BITS_SUBCUBETA_METRICA 5 //32 sub-cubetas por potencia de 2: error menor al 3%
+#define MAX_BITS_METRICA 40 //Tiempos hasta 2^40 ns (unos 18 minutos); lo mayor cae en la ultima cubeta
+#define NUM_CUBETAS_METRICA ((MAX_BITS_METRICA - BITS_SUBCUBETA_METRICA + 1) << BITS_SUBCUBETA_METRICA)
+
+//Etapas por las que pasa una solicitud dentro del controlador
+typedef enum {
+    ETAPA_LECTURA = 0, //Cada read/recv que trajo tramas (hilo de eventos)
+    ETAPA_DECODIFICACION, //Decodificar una trama de solicitud o lote (hilo de eventos)
+    ETAPA_COLA, //Desde que se encola hasta que un trabajador la saca
+    ETAPA_DECISION, //intentar_reserva de todas las solicitudes del trabajo
+    ETAPA_RESPUESTA, //Escribir la respuesta al agente
+    ETAPA_BITACORA, //Esperar a que la bitacora sincronice las decisiones (-b)
+    NUM_ETAPAS
+} EtapaMetrica;
+
+//Contadores de un hilo; solo ese hilo los escribe, por eso basta con load y store relajados
+typedef struct {
+    _Alignas(64) atomic_ullong conteos[NUM_ETAPAS][NUM_CUBETAS_METRICA]; //Histograma de cada etapa
+    atomic_ullong maximo[NUM_ETAPAS]; //Mayor tiempo visto en cada etapa
+    atomic_ullong solicitudes; //Solicitudes que paso este hilo (leidas o decididas)
+} MetricasHilo;
+
+// Reserva los contadores de num_hilos hilos (el 0 es el de eventos), retorna 0 o -1
+int metricas_iniciar(int num_hilos);
+// Indica que el hilo que llama usa los contadores de la posicion indice
+void metricas_usar_hilo(int indice);
+// Tiempo monotonico en nanosegundos
+uint64_t metricas_ahora(void);
+// Registra en la etapa el tiempo transcurrido desde desde_ns (de metricas_ahora)
+void metricas_registrar(EtapaMetrica etapa, uint64_t desde_ns);
+// Suma n a las solicitudes del hilo que llama
+void metricas_contar(uint64_t n);
+// Suma n a un contador que solo escribe un hilo, sin instruccion atomica de lectura-escritura
+void contador_sumar(atomic_ullong* c, uint64_t n);
+// Junta los contadores de la etapa de todos los hilos en h (que debe estar iniciado)
+void metricas_juntar(EtapaMetrica etapa, Histograma* h);
+// Solicitudes del hilo indice
+uint64_t metricas_solicitudes(int indice);
+// Cantidad de hilos con contadores
+int metricas_hilos(void);
+// Nombre corto de una etapa
+const char* nombre_etapa(EtapaMetrica etapa);
+// Libera los contadores
+void metricas_destruir(void);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Separar los contadores por hilo evita que las metricas se
+* conviertan en un punto de contencion: medir una etapa
+* cuesta dos lecturas del reloj y un par de escrituras en
+* memoria que ningun otro hilo modifica.
+******************************************************/
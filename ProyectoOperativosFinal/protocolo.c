@@ -0,0 +1,407 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto protocolo.c
+*
+* Descripción:
+* Este archivo implementa la codificacion y decodificacion de las tramas
+* binarias del protocolo, asi como el lector que separa las tramas
+* completas dentro de un bloque grande de bytes leido de un pipe. Los
+* enteros se guardan en el orden de la maquina porque agentes y
+* controlador siempre corren en el mismo equipo.
+******************************************************/
+#include <string.h> //libreria para cadenas de caracteres
+#include <unistd.h> //Libreria para read y write
+#include <errno.h> //Libreria para manejo de errores
+#include <stdio.h> //Libreria para snprintf
+
+#include "protocolo.h"
+
+//Cursor para escribir o leer campos dentro de un cuerpo
+typedef struct {
+    uint8_t* p; //Posicion actual
+    const uint8_t* fin; //Limite del buffer
+    int error; //Se pone en 1 si algun campo no cupo
+} Cursor;
+
+static void poner_u8(Cursor* c, uint8_t v) {
+    if (c->p + 1 > c->fin) { c->error = 1; return; }
+    *c->p++ = v;
+}
+
+static void poner_u16(Cursor* c, uint16_t v) {
+    if (c->p + 2 > c->fin) { c->error = 1; return; }
+    memcpy(c->p, &v, 2);
+    c->p += 2;
+}
+
+static void poner_u32(Cursor* c, uint32_t v) {
+    if (c->p + 4 > c->fin) { c->error = 1; return; }
+    memcpy(c->p, &v, 4);
+    c->p += 4;
+}
+
+//Las cadenas van con un byte de longitud y sin el '\0'
+static void poner_cadena(Cursor* c, const char* s) {
+    size_t n = strnlen(s, MAX_NOMBRE - 1);
+    poner_u8(c, (uint8_t)n);
+    if (c->p + n > c->fin) { c->error = 1; return; }
+    memcpy(c->p, s, n);
+    c->p += n;
+}
+
+static uint8_t sacar_u8(Cursor* c) {
+    if (c->p + 1 > c->fin) { c->error = 1; return 0; }
+    return *c->p++;
+}
+
+static uint16_t sacar_u16(Cursor* c) {
+    uint16_t v = 0;
+    if (c->p + 2 > c->fin) { c->error = 1; return 0; }
+    memcpy(&v, c->p, 2);
+    c->p += 2;
+    return v;
+}
+
+static uint32_t sacar_u32(Cursor* c) {
+    uint32_t v = 0;
+    if (c->p + 4 > c->fin) { c->error = 1; return 0; }
+    memcpy(&v, c->p, 4);
+    c->p += 4;
+    return v;
+}
+
+static void sacar_cadena(Cursor* c, char* s) {
+    size_t n = sacar_u8(c);
+    if (c->error || n >= MAX_NOMBRE || c->p + n > c->fin) { c->error = 1; s[0] = '\0'; return; }
+    memcpy(s, c->p, n);
+    s[n] = '\0';
+    c->p += n;
+}
+
+//Escribe la cabecera y deja el cursor listo para el cuerpo
+static Cursor empezar_trama(uint8_t* buf) {
+    Cursor c = { buf + TAM_CABECERA, buf + MAX_TRAMA, 0 };
+    return c;
+}
+
+//Completa la cabecera cuando ya se conoce la longitud del cuerpo
+static int cerrar_trama(uint8_t* buf, Cursor* c, uint16_t tipo, uint32_t id) {
+    if (c->error) return -1;
+    CabeceraTrama cab = { tipo, (uint16_t)(c->p - (buf + TAM_CABECERA)), id };
+    memcpy(buf, &cab.tipo, 2);
+    memcpy(buf + 2, &cab.longitud, 2);
+    memcpy(buf + 4, &cab.id_solicitud, 4);
+    return TAM_CABECERA + cab.longitud;
+}
+
+int codificar_registro(uint8_t* buf, uint32_t id, const MsgRegistro* m) {
+    Cursor c = empezar_trama(buf);
+    poner_cadena(&c, m->nombre);
+    poner_cadena(&c, m->pipe_respuesta);
+    return cerrar_trama(buf, &c, MSG_REGISTRO, id);
+}
+
+int codificar_solicitud(uint8_t* buf, uint32_t id, const MsgSolicitud* m) {
+    Cursor c = empezar_trama(buf);
+    poner_u32(&c, (uint32_t)m->inicio);
+    poner_u16(&c, (uint16_t)m->personas);
+    poner_u32(&c, m->id_agente);
+    poner_u8(&c, (uint8_t)m->parque);
+    poner_cadena(&c, m->familia);
+    return cerrar_trama(buf, &c, MSG_SOLICITUD, id);
+}
+
+int codificar_hora(uint8_t* buf, uint32_t id, int minuto, uint32_t id_agente) {
+    Cursor c = empezar_trama(buf);
+    poner_u32(&c, (uint32_t)minuto);
+    poner_u32(&c, id_agente);
+    return cerrar_trama(buf, &c, MSG_HORA, id);
+}
+
+int codificar_respuesta(uint8_t* buf, uint32_t id, const MsgRespuesta* m) {
+    Cursor c = empezar_trama(buf);
+    poner_u8(&c, (uint8_t)m->codigo);
+    poner_u32(&c, (uint32_t)m->inicio);
+    poner_u32(&c, m->reserva);
+    poner_cadena(&c, m->familia);
+    return cerrar_trama(buf, &c, MSG_RESPUESTA, id);
+}
+
+int codificar_vacio(uint8_t* buf, uint16_t tipo, uint32_t id) {
+    Cursor c = empezar_trama(buf);
+    return cerrar_trama(buf, &c, tipo, id);
+}
+
+//Solo lleva el id del agente, igual que sus solicitudes
+int codificar_fin_solicitudes(uint8_t* buf, uint32_t id_agente) {
+    Cursor c = empezar_trama(buf);
+    poner_u32(&c, id_agente);
+    return cerrar_trama(buf, &c, MSG_FIN_SOLICITUDES, 0);
+}
+
+//Un cambio no lleva familia ni parque: los dos se conocen por el id de la reserva
+int codificar_cambio(uint8_t* buf, uint16_t tipo, uint32_t id, const MsgSolicitud* m) {
+    if (tipo != MSG_CANCELAR && tipo != MSG_MODIFICAR) return -1;
+    Cursor c = empezar_trama(buf);
+    poner_u32(&c, m->id_agente);
+    poner_u32(&c, m->reserva);
+    if (tipo == MSG_MODIFICAR) {
+        poner_u32(&c, (uint32_t)m->inicio);
+        poner_u16(&c, (uint16_t)m->personas);
+    }
+    return cerrar_trama(buf, &c, tipo, id);
+}
+
+int codificar_consulta(uint8_t* buf, uint32_t id, const MsgConsulta* m) {
+    Cursor c = empezar_trama(buf);
+    poner_u32(&c, m->id_agente);
+    poner_u8(&c, (uint8_t)m->parque);
+    poner_u32(&c, (uint32_t)m->desde);
+    poner_u32(&c, (uint32_t)m->hasta);
+    poner_u16(&c, (uint16_t)m->personas);
+    return cerrar_trama(buf, &c, MSG_DISPONIBILIDAD, id);
+}
+
+//Cada franja va con su minuto: entre el cierre de un dia y la apertura del siguiente no hay franjas
+int codificar_disponibilidad(uint8_t* buf, uint32_t id, const MsgDisponibilidad* m) {
+    if (m->cantidad < 0 || m->cantidad > MAX_FRANJAS_CONSULTA) return -1;
+    Cursor c = empezar_trama(buf);
+    poner_u8(&c, (uint8_t)m->cantidad);
+    for (int i = 0; i < m->cantidad; i++) {
+        poner_u32(&c, (uint32_t)m->franjas[i].minuto);
+        poner_u32(&c, (uint32_t)m->franjas[i].libres);
+        poner_u8(&c, (uint8_t)m->franjas[i].cabe);
+    }
+    return cerrar_trama(buf, &c, MSG_RESPUESTA_DISPONIBILIDAD, id);
+}
+
+//El lote lleva el id del agente y el parque una vez y luego cada solicitud con su propio id
+int codificar_lote(uint8_t* buf, uint32_t id_agente, const MsgSolicitud* sols, const uint32_t* ids, int cantidad) {
+    if (cantidad < 1 || cantidad > MAX_LOTE) return -1;
+    for (int i = 1; i < cantidad; i++)
+        if (sols[i].parque != sols[0].parque) return -1; //Todo el lote lo decide el mismo parque
+    Cursor c = empezar_trama(buf);
+    poner_u32(&c, id_agente);
+    poner_u8(&c, (uint8_t)sols[0].parque);
+    poner_u8(&c, (uint8_t)cantidad);
+    for (int i = 0; i < cantidad; i++) {
+        poner_u32(&c, ids[i]);
+        poner_u32(&c, (uint32_t)sols[i].inicio);
+        poner_u16(&c, (uint16_t)sols[i].personas);
+        poner_cadena(&c, sols[i].familia);
+    }
+    return cerrar_trama(buf, &c, MSG_SOLICITUD_LOTE, 0);
+}
+
+//El agente arma los lotes contando TAM_FIJO_EN_LOTE por solicitud, lo que ocupa su respuesta, asi que siempre cabe
+int codificar_respuesta_lote(uint8_t* buf, const MsgRespuesta* resps, const uint32_t* ids, int cantidad) {
+    if (cantidad < 1 || cantidad > MAX_LOTE) return -1;
+    Cursor c = empezar_trama(buf);
+    poner_u8(&c, (uint8_t)cantidad);
+    for (int i = 0; i < cantidad; i++) {
+        poner_u32(&c, ids[i]);
+        poner_u8(&c, (uint8_t)resps[i].codigo);
+        poner_u32(&c, (uint32_t)resps[i].inicio);
+        poner_u32(&c, resps[i].reserva);
+        poner_cadena(&c, resps[i].familia);
+    }
+    return cerrar_trama(buf, &c, MSG_RESPUESTA_LOTE, 0);
+}
+
+//Prepara un cursor de lectura sobre el cuerpo recibido
+static Cursor leer_cuerpo(const uint8_t* cuerpo, uint16_t len) {
+    Cursor c = { (uint8_t*)cuerpo, cuerpo + len, 0 };
+    return c;
+}
+
+int decodificar_registro(const uint8_t* cuerpo, uint16_t len, MsgRegistro* m) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    sacar_cadena(&c, m->nombre);
+    sacar_cadena(&c, m->pipe_respuesta);
+    return c.error ? -1 : 0;
+}
+
+int decodificar_solicitud(const uint8_t* cuerpo, uint16_t len, MsgSolicitud* m) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    m->inicio = (int)sacar_u32(&c);
+    m->personas = sacar_u16(&c);
+    m->id_agente = sacar_u32(&c);
+    m->parque = sacar_u8(&c);
+    m->reserva = SIN_ID_RESERVA;
+    sacar_cadena(&c, m->familia);
+    return c.error ? -1 : 0;
+}
+
+int decodificar_hora(const uint8_t* cuerpo, uint16_t len, int* minuto, uint32_t* id_agente) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    *minuto = (int)sacar_u32(&c);
+    *id_agente = sacar_u32(&c);
+    return c.error ? -1 : 0;
+}
+
+int decodificar_respuesta(const uint8_t* cuerpo, uint16_t len, MsgRespuesta* m) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    m->codigo = sacar_u8(&c);
+    m->inicio = (int)sacar_u32(&c);
+    m->reserva = sacar_u32(&c);
+    sacar_cadena(&c, m->familia);
+    return c.error ? -1 : 0;
+}
+
+int decodificar_fin_solicitudes(const uint8_t* cuerpo, uint16_t len, uint32_t* id_agente) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    *id_agente = sacar_u32(&c);
+    return c.error ? -1 : 0;
+}
+
+int decodificar_cambio(const uint8_t* cuerpo, uint16_t len, uint16_t tipo, MsgSolicitud* m) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    m->id_agente = sacar_u32(&c);
+    m->reserva = sacar_u32(&c);
+    m->inicio = 0;
+    m->personas = 0;
+    if (tipo == MSG_MODIFICAR) {
+        m->inicio = (int)sacar_u32(&c);
+        m->personas = sacar_u16(&c);
+    }
+    m->parque = (int)(m->reserva & ((1u << BITS_PARQUE_RESERVA) - 1));
+    m->familia[0] = '\0';
+    return c.error || m->reserva == SIN_ID_RESERVA ? -1 : 0;
+}
+
+int decodificar_consulta(const uint8_t* cuerpo, uint16_t len, MsgConsulta* m) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    m->id_agente = sacar_u32(&c);
+    m->parque = sacar_u8(&c);
+    m->desde = (int)sacar_u32(&c);
+    m->hasta = (int)sacar_u32(&c);
+    m->personas = sacar_u16(&c);
+    return c.error ? -1 : 0;
+}
+
+int decodificar_disponibilidad(const uint8_t* cuerpo, uint16_t len, MsgDisponibilidad* m) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    m->cantidad = sacar_u8(&c);
+    if (m->cantidad > MAX_FRANJAS_CONSULTA) return -1;
+    for (int i = 0; i < m->cantidad && !c.error; i++) {
+        m->franjas[i].minuto = (int)sacar_u32(&c);
+        m->franjas[i].libres = (int)sacar_u32(&c);
+        m->franjas[i].cabe = sacar_u8(&c);
+    }
+    return c.error ? -1 : 0;
+}
+
+int decodificar_lote(const uint8_t* cuerpo, uint16_t len, MsgSolicitud* sols, uint32_t* ids) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    uint32_t id_agente = sacar_u32(&c);
+    int parque = sacar_u8(&c);
+    int cantidad = sacar_u8(&c);
+    if (cantidad < 1 || cantidad > MAX_LOTE) return -1;
+    for (int i = 0; i < cantidad && !c.error; i++) {
+        ids[i] = sacar_u32(&c);
+        sols[i].inicio = (int)sacar_u32(&c);
+        sols[i].personas = sacar_u16(&c);
+        sols[i].id_agente = id_agente;
+        sols[i].parque = parque;
+        sols[i].reserva = SIN_ID_RESERVA;
+        sacar_cadena(&c, sols[i].familia);
+    }
+    return c.error ? -1 : cantidad;
+}
+
+int decodificar_respuesta_lote(const uint8_t* cuerpo, uint16_t len, MsgRespuesta* resps, uint32_t* ids) {
+    Cursor c = leer_cuerpo(cuerpo, len);
+    int cantidad = sacar_u8(&c);
+    if (cantidad < 1 || cantidad > MAX_LOTE) return -1;
+    for (int i = 0; i < cantidad && !c.error; i++) {
+        ids[i] = sacar_u32(&c);
+        resps[i].codigo = sacar_u8(&c);
+        resps[i].inicio = (int)sacar_u32(&c);
+        resps[i].reserva = sacar_u32(&c);
+        sacar_cadena(&c, resps[i].familia);
+    }
+    return c.error ? -1 : cantidad;
+}
+
+const char* nombre_respuesta(int codigo) {
+    switch (codigo) {
+        case RESP_OK: return "OK";
+        case RESP_REPROGRAMADA: return "REPROGRAMADA";
+        case RESP_NEGADA_EXT: return "NEGADA_EXT";
+        case RESP_NEGADA: return "NEGADA";
+        case RESP_CANCELADA: return "CANCELADA";
+        case RESP_OCUPADO: return "OCUPADO";
+        default: return "DESCONOCIDA";
+    }
+}
+
+void texto_instante(int minuto, char* buf, size_t tam) {
+    int dia = minuto / MINUTOS_DIA, hora = minuto % MINUTOS_DIA / 60, minutos = minuto % 60;
+    if (dia > 0) snprintf(buf, tam, "%d/%d:%02d", dia, hora, minutos);
+    else if (minutos > 0) snprintf(buf, tam, "%d:%02d", hora, minutos);
+    else snprintf(buf, tam, "%d", hora); //Una hora en punto del primer dia se ve igual que antes
+}
+
+void lector_iniciar(LectorTramas* l) {
+    l->inicio = 0;
+    l->fin = 0;
+}
+
+ssize_t lector_llenar(LectorTramas* l, int fd) {
+    //Si lo pendiente esta al final del buffer lo corre al inicio para dejar espacio
+    if (l->inicio > 0) {
+        memmove(l->datos, l->datos + l->inicio, l->fin - l->inicio);
+        l->fin -= l->inicio;
+        l->inicio = 0;
+    }
+    ssize_t n = read(fd, l->datos + l->fin, sizeof(l->datos) - l->fin);
+    if (n > 0) l->fin += (size_t)n;
+    return n;
+}
+
+int transporte_desde_texto(const char* texto) {
+    if (strcmp(texto, "fifo") == 0) return TRANSPORTE_FIFO;
+    if (strcmp(texto, "shm") == 0) return TRANSPORTE_SHM;
+    if (strcmp(texto, "unix") == 0) return TRANSPORTE_UNIX;
+    return -1;
+}
+
+int trama_abrir(const uint8_t* buf, size_t disponibles, CabeceraTrama* cab, const uint8_t** cuerpo) {
+    if (disponibles < TAM_CABECERA) return 0; //Aun no llega la cabecera completa
+    memcpy(&cab->tipo, buf, 2);
+    memcpy(&cab->longitud, buf + 2, 2);
+    memcpy(&cab->id_solicitud, buf + 4, 4);
+    if (cab->tipo < MSG_REGISTRO || cab->tipo > MSG_RESPUESTA_DISPONIBILIDAD || cab->longitud > MAX_CUERPO) return -1;
+    if (disponibles < (size_t)TAM_CABECERA + cab->longitud) return 0; //Falta parte del cuerpo
+    *cuerpo = buf + TAM_CABECERA;
+    return 1;
+}
+
+int lector_siguiente(LectorTramas* l, CabeceraTrama* cab, const uint8_t** cuerpo) {
+    int r = trama_abrir(l->datos + l->inicio, l->fin - l->inicio, cab, cuerpo);
+    if (r == -1) l->inicio = l->fin = 0; //No se puede resincronizar un flujo corrupto, se descarta
+    if (r == 1) l->inicio += TAM_CABECERA + cab->longitud;
+    return r;
+}
+
+int escribir_trama(int fd, const uint8_t* buf, int len) {
+    ssize_t n;
+    do {
+        n = write(fd, buf, (size_t)len); //Menos de PIPE_BUF bytes: se escribe todo o nada
+    } while (n == -1 && errno == EINTR);
+    return n == len ? 0 : -1;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con estas funciones ambos programas hablan el mismo
+* formato sin depender de separadores de texto. El lector
+* procesa bloques grandes de una sola vez, por lo que una
+* lectura del pipe puede entregar decenas de solicitudes
+* completas al controlador.
+******************************************************/
@@ -0,0 +1,198 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto protocolo.h
+*
+* Descripción:
+* Este archivo define el formato binario de los mensajes que viajan
+* entre los agentes y el controlador. Cada mensaje es una trama con una
+* cabecera fija (tipo, longitud del cuerpo e identificador de solicitud)
+* seguida de un cuerpo compacto. Como las tramas tienen longitud
+* conocida, el lector puede separar varios mensajes que llegan juntos en
+* una sola lectura del pipe, o esperar el resto de uno que llego cortado.
+******************************************************/
+#ifndef PROTOCOLO_H
+#define PROTOCOLO_H
+
+#include <stdint.h> //Libreria para enteros de tamano fijo
+#include <stddef.h> //Libreria para size_t
+#include <limits.h> //Libreria para PIPE_BUF
+#include <sys/types.h> //Libreria para ssize_t
+
+#define MAX_NOMBRE 50 //Cantidad maxima de caracteres en un nombre
+#define TAM_CABECERA 8 //Bytes que ocupa la cabecera de cada trama
+#define MAX_CUERPO 504 //Bytes maximos del cuerpo de una trama
+#define MAX_TRAMA (TAM_CABECERA + MAX_CUERPO) //Tamano maximo de una trama completa
+#define TAM_LECTOR 65536 //Tamano del buffer de lectura (capacidad tipica de un pipe)
+#define MAX_LOTE 32 //Solicitudes maximas en una trama de lote
+#define MAX_PARQUES 32 //Parques que puede atender un controlador, el id viaja en un byte
+#define TAM_BASE_LOTE (TAM_CABECERA + 6) //Trama de lote sin solicitudes: cabecera, id del agente, parque y cantidad
+#define TAM_FIJO_EN_LOTE 14 //Bytes de cada solicitud del lote ademas de su familia: id, inicio, personas y largo
+                            //Se cuenta lo que ocupa su respuesta (id, codigo, inicio, reserva y largo), que es mas
+#define MINUTOS_DIA 1440 //Minutos de un dia; los instantes se cuentan desde las 00:00 del dia 0
+#define MAX_DIAS 3660 //Dias que se pueden pedir o simular (unos diez anos)
+#define TAM_INSTANTE 24 //Caracteres para mostrar un instante ("dia/hora:minutos")
+#define BITS_PARQUE_RESERVA 5 //Bits bajos del id de una reserva que dicen su parque
+#define SIN_ID_RESERVA 0 //Id de reserva de una respuesta que no dejo ninguna
+#define MAX_FRANJAS_CONSULTA 48 //Franjas que trae como maximo una respuesta de disponibilidad (9 bytes cada una)
+
+#if MAX_TRAMA > PIPE_BUF
+#error "MAX_TRAMA debe caber en PIPE_BUF para que cada write sea atomico"
+#endif
+#if MAX_PARQUES > (1 << BITS_PARQUE_RESERVA)
+#error "El parque de cada reserva debe caber en los bits bajos de su id"
+#endif
+#if 1 + 9 * MAX_FRANJAS_CONSULTA > MAX_CUERPO
+#error "La respuesta de disponibilidad debe caber en una trama"
+#endif
+
+//Tipos de mensaje que se pueden enviar
+typedef enum {
+    MSG_REGISTRO = 1, //Agente -> controlador: nombre y pipe de respuesta
+    MSG_SOLICITUD = 2, //Agente -> controlador: familia, inicio pedido, personas y parque
+    MSG_HORA = 3, //Controlador -> agente: confirma el registro con el instante actual y el id asignado
+    MSG_RESPUESTA = 4, //Controlador -> agente: resultado de una solicitud
+    MSG_TERMINAR = 5, //Controlador -> agente: fin de la simulacion
+    MSG_SOLICITUD_LOTE = 6, //Agente -> controlador: varias solicitudes en una sola trama
+    MSG_RESPUESTA_LOTE = 7, //Controlador -> agente: las respuestas de un lote en una sola trama
+    MSG_FIN_SOLICITUDES = 8, //Agente -> controlador: ya envio todas sus solicitudes (lo usa el reloj virtual)
+    MSG_CANCELAR = 9, //Agente -> controlador: libera una reserva que el mismo hizo, por su id
+    MSG_MODIFICAR = 10, //Agente -> controlador: mueve una reserva suya a otro inicio o con otra cantidad de personas
+    MSG_DISPONIBILIDAD = 11, //Agente -> controlador: pregunta cuantas personas caben en cada franja de un rango
+    MSG_RESPUESTA_DISPONIBILIDAD = 12 //Controlador -> agente: personas libres de cada franja consultada
+} TipoMensaje;
+
+//Mecanismo por el que viajan las tramas, se elige con -x en ambos programas
+typedef enum {
+    TRANSPORTE_FIFO = 0, //Pipes FIFO (por defecto)
+    TRANSPORTE_SHM = 1, //Anillos en memoria compartida (transporte_shm.h)
+    TRANSPORTE_UNIX = 2 //Una conexion SOCK_SEQPACKET por agente (transporte_unix.h)
+} TipoTransporte;
+
+//Resultado de una solicitud; intentar_reserva retorna el mismo que deja en la respuesta
+typedef enum {
+    RESP_OK = 1, //Aceptada en la hora pedida
+    RESP_REPROGRAMADA = 2, //Aceptada en otra hora
+    RESP_NEGADA_EXT = 3, //La hora ya paso y no habia otro bloque
+    RESP_NEGADA = 4, //No hay cupo o esta fuera del horario (en un cambio, la reserva queda como estaba)
+    RESP_CANCELADA = 5, //La reserva se cancelo y sus franjas quedaron libres
+    RESP_OCUPADO = 6 //El controlador esta saturado y no la encolo: se reintenta despues de los ms que trae en inicio
+} CodigoRespuesta;
+
+typedef struct {
+    uint16_t tipo; //Uno de TipoMensaje
+    uint16_t longitud; //Bytes del cuerpo que siguen a la cabecera
+    uint32_t id_solicitud; //Identificador que el agente pone y el controlador devuelve
+} CabeceraTrama;
+
+typedef struct {
+    char nombre[MAX_NOMBRE]; //Nombre del agente
+    char pipe_respuesta[MAX_NOMBRE]; //Pipe donde quiere recibir las respuestas
+} MsgRegistro;
+
+typedef struct {
+    char familia[MAX_NOMBRE]; //Familia que hace la reserva
+    int inicio; //Minuto pedido, contado desde las 00:00 del dia 0
+    int personas; //Cantidad de personas
+    uint32_t id_agente; //Id que el controlador le asigno al agente al registrarlo
+    int parque; //Parque al que va la solicitud (0 si el controlador atiende uno solo)
+    uint32_t reserva; //En MSG_CANCELAR y MSG_MODIFICAR, id de la reserva que se cambia; SIN_ID_RESERVA en una nueva
+} MsgSolicitud;
+
+typedef struct {
+    int codigo; //Uno de CodigoRespuesta
+    int inicio; //Minuto asignado (si aplica), contado igual que el pedido; en RESP_OCUPADO, ms antes de reintentar
+    uint32_t reserva; //Id de la reserva que quedo o que se cancelo, SIN_ID_RESERVA si no hay
+    char familia[MAX_NOMBRE]; //Familia a la que corresponde la respuesta
+} MsgRespuesta;
+
+typedef struct {
+    uint32_t id_agente; //Id que el controlador le asigno al agente al registrarlo
+    int parque; //Parque consultado
+    int desde, hasta; //Primer y ultimo minuto en que pueden empezar las franjas consultadas
+    int personas; //Tamano del grupo para el que se dice si cabe una estadia, 0 si no interesa
+} MsgConsulta;
+
+//Una franja consultada
+typedef struct {
+    int minuto; //Minuto en que empieza la franja
+    int libres; //Personas que todavia caben en ella
+    int cabe; //1 si una estadia de las personas consultadas puede empezar en ella
+} FranjaLibre;
+
+typedef struct {
+    int cantidad; //Franjas abiertas del rango que estan en la ventana, hasta MAX_FRANJAS_CONSULTA
+    FranjaLibre franjas[MAX_FRANJAS_CONSULTA]; //En orden de minuto
+} MsgDisponibilidad;
+
+//Acumula los bytes leidos de un descriptor y entrega las tramas completas
+typedef struct {
+    uint8_t datos[TAM_LECTOR]; //Bytes pendientes
+    size_t inicio; //Primer byte sin consumir
+    size_t fin; //Siguiente posicion libre
+} LectorTramas;
+
+// Codifica una trama completa en buf, retorna su tamano total o -1 si no cabe
+int codificar_registro(uint8_t* buf, uint32_t id, const MsgRegistro* m);
+int codificar_solicitud(uint8_t* buf, uint32_t id, const MsgSolicitud* m);
+int codificar_hora(uint8_t* buf, uint32_t id, int minuto, uint32_t id_agente);
+int codificar_respuesta(uint8_t* buf, uint32_t id, const MsgRespuesta* m);
+int codificar_vacio(uint8_t* buf, uint16_t tipo, uint32_t id);
+int codificar_fin_solicitudes(uint8_t* buf, uint32_t id_agente);
+// MSG_CANCELAR (usa id_agente y reserva) o MSG_MODIFICAR (ademas inicio y personas), segun tipo
+int codificar_cambio(uint8_t* buf, uint16_t tipo, uint32_t id, const MsgSolicitud* m);
+int codificar_consulta(uint8_t* buf, uint32_t id, const MsgConsulta* m);
+int codificar_disponibilidad(uint8_t* buf, uint32_t id, const MsgDisponibilidad* m);
+// Codifican un lote de cantidad solicitudes o respuestas, cada una con su id; retornan -1 si no cabe en una trama
+//Todas las solicitudes de un lote deben ser del mismo parque
+int codificar_lote(uint8_t* buf, uint32_t id_agente, const MsgSolicitud* sols, const uint32_t* ids, int cantidad);
+int codificar_respuesta_lote(uint8_t* buf, const MsgRespuesta* resps, const uint32_t* ids, int cantidad);
+
+// Decodifican el cuerpo de una trama, retornan 0 si es valido o -1 si esta mal formado
+int decodificar_registro(const uint8_t* cuerpo, uint16_t len, MsgRegistro* m);
+int decodificar_solicitud(const uint8_t* cuerpo, uint16_t len, MsgSolicitud* m);
+int decodificar_hora(const uint8_t* cuerpo, uint16_t len, int* minuto, uint32_t* id_agente);
+int decodificar_respuesta(const uint8_t* cuerpo, uint16_t len, MsgRespuesta* m);
+int decodificar_fin_solicitudes(const uint8_t* cuerpo, uint16_t len, uint32_t* id_agente);
+//El parque sale de los bits bajos del id de la reserva y la familia queda vacia: la conoce el controlador
+int decodificar_cambio(const uint8_t* cuerpo, uint16_t len, uint16_t tipo, MsgSolicitud* m);
+int decodificar_consulta(const uint8_t* cuerpo, uint16_t len, MsgConsulta* m);
+int decodificar_disponibilidad(const uint8_t* cuerpo, uint16_t len, MsgDisponibilidad* m);
+// Decodifican un lote en arreglos de MAX_LOTE posiciones, retornan la cantidad o -1 si esta mal formado
+int decodificar_lote(const uint8_t* cuerpo, uint16_t len, MsgSolicitud* sols, uint32_t* ids);
+int decodificar_respuesta_lote(const uint8_t* cuerpo, uint16_t len, MsgRespuesta* resps, uint32_t* ids);
+
+// Texto legible de un codigo de respuesta (OK, REPROGRAMADA, ...)
+const char* nombre_respuesta(int codigo);
+// Escribe un instante como "hora", "hora:minutos" o "dia/hora:minutos" (el dia 0 y los minutos en cero se omiten)
+//Es la misma forma en que se escriben las horas en el archivo de solicitudes
+void texto_instante(int minuto, char* buf, size_t tam);
+
+// Retorna el transporte que corresponde a un texto de -x ("fifo", "shm" o "unix"), o -1 si no existe
+int transporte_desde_texto(const char* texto);
+
+// Revisa la trama que empieza en buf: 1 si esta completa, 0 si faltan bytes, -1 si la cabecera es invalida
+int trama_abrir(const uint8_t* buf, size_t disponibles, CabeceraTrama* cab, const uint8_t** cuerpo);
+// Prepara un lector vacio
+void lector_iniciar(LectorTramas* l);
+// Lee todo lo que quepa desde fd, retorna lo mismo que read
+ssize_t lector_llenar(LectorTramas* l, int fd);
+// Entrega la siguiente trama completa: 1 si hay una, 0 si falta informacion, -1 si los datos son invalidos
+int lector_siguiente(LectorTramas* l, CabeceraTrama* cab, const uint8_t** cuerpo);
+// Escribe una trama completa con una sola llamada a write
+int escribir_trama(int fd, const uint8_t* buf, int len);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Este archivo fija el contrato de comunicacion entre los
+* procesos del sistema. Al tener una cabecera de tamano fijo
+* y un cuerpo de longitud conocida, ningun mensaje se pierde
+* ni se mezcla con otro aunque varios agentes escriban al
+* mismo tiempo sobre el pipe del controlador.
+******************************************************/
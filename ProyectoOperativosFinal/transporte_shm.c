@@ -0,0 +1,234 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto transporte_shm.c
+*
+* Descripción:
+* Este archivo implementa los anillos en memoria compartida. Cada ranura
+* lleva un numero de secuencia: los productores reservan una posicion
+* con una comparacion atomica sobre la cola y publican la trama
+* cambiando la secuencia de la ranura; el unico consumidor lee en orden
+* y devuelve la ranura sumandole la capacidad. Para dormir y despertar
+* se usa un futex compartido entre procesos sobre el contador timbre.
+******************************************************/
+#include <stdio.h> //Libreria para snprintf
+#include <string.h> //libreria para memcpy
+#include <unistd.h> //Libreria para ftruncate, close y write
+#include <fcntl.h> // Libreria para constantes de shm_open
+#include <errno.h> //Libreria para manejo de errores
+#include <limits.h> //Libreria para INT_MAX
+#include <sys/mman.h> //Libreria para shm_open y mmap
+#include <sys/stat.h> //Libreria para fstat
+#include <sys/syscall.h> //Libreria para SYS_futex
+#include <linux/futex.h> //Libreria para FUTEX_WAIT y FUTEX_WAKE
+
+#include "transporte_shm.h"
+
+//Los nombres de shm_open empiezan con '/' y no pueden tener otra
+static void nombre_shm(const char* nombre, char* salida) {
+    snprintf(salida, MAX_NOMBRE + 2, "/%s", nombre);
+    for (char* p = salida + 1; *p; p++)
+        if (*p == '/') *p = '_';
+}
+
+static size_t tamano_anillo(uint32_t capacidad) {
+    return sizeof(AnilloShm) + (size_t)capacidad * sizeof(RanuraAnillo);
+}
+
+//Sin FUTEX_PRIVATE_FLAG: la palabra esta en memoria compartida entre procesos
+static void futex_esperar(atomic_uint* palabra, unsigned valor) {
+    syscall(SYS_futex, palabra, FUTEX_WAIT, valor, NULL, NULL, 0);
+}
+
+static void futex_despertar(atomic_uint* palabra) {
+    syscall(SYS_futex, palabra, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Crea (o reemplaza) el objeto compartido de un canal y lo deja vacio, retorna NULL si falla
+AnilloShm* anillo_crear(const char* nombre, uint32_t capacidad) {
+    char nombre_obj[MAX_NOMBRE + 2];
+    nombre_shm(nombre, nombre_obj);
+    shm_unlink(nombre_obj); //Un canal viejo de una ejecucion anterior no se reutiliza
+    int fd = shm_open(nombre_obj, O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd == -1) return NULL;
+    size_t tam = tamano_anillo(capacidad);
+    if (ftruncate(fd, (off_t)tam) == -1) {
+        close(fd);
+        shm_unlink(nombre_obj);
+        return NULL;
+    }
+    AnilloShm* a = mmap(NULL, tam, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); //El mapeo sigue valido sin el descriptor
+    if (a == MAP_FAILED) {
+        shm_unlink(nombre_obj);
+        return NULL;
+    }
+    a->capacidad = capacidad;
+    atomic_init(&a->cola, 0);
+    atomic_init(&a->cabeza, 0);
+    atomic_init(&a->timbre, 0);
+    atomic_init(&a->esperando, 0);
+    atomic_init(&a->cerrado, 0);
+    for (uint32_t i = 0; i < capacidad; i++) //Cada ranura empieza libre para su posicion
+        atomic_init(&a->ranuras[i].secuencia, i);
+    return a;
+}
+
+// Abre el canal que creo otro proceso, retorna NULL si no existe
+AnilloShm* anillo_abrir(const char* nombre) {
+    char nombre_obj[MAX_NOMBRE + 2];
+    nombre_shm(nombre, nombre_obj);
+    int fd = shm_open(nombre_obj, O_RDWR, 0);
+    if (fd == -1) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(AnilloShm)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    AnilloShm* a = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (a == MAP_FAILED) return NULL;
+    if (tamano_anillo(a->capacidad) != (size_t)st.st_size) { //No es un anillo de este programa
+        munmap(a, (size_t)st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+    return a;
+}
+
+// Quita el anillo del espacio de memoria del proceso
+void anillo_liberar(AnilloShm* a) {
+    if (a) munmap(a, tamano_anillo(a->capacidad));
+}
+
+// Borra el nombre del objeto compartido
+void anillo_borrar(const char* nombre) {
+    char nombre_obj[MAX_NOMBRE + 2];
+    nombre_shm(nombre, nombre_obj);
+    shm_unlink(nombre_obj);
+}
+
+//Copia la trama en la ranura reservada, la publica y despierta al consumidor si duerme
+static void publicar(AnilloShm* a, RanuraAnillo* r, unsigned pos, const uint8_t* trama, int len) {
+    memcpy(r->datos, trama, (size_t)len);
+    r->longitud = (uint16_t)len;
+    atomic_store_explicit(&r->secuencia, pos + 1, memory_order_release);
+    atomic_fetch_add(&a->timbre, 1);
+    if (atomic_load(&a->esperando)) futex_despertar(&a->timbre);
+}
+
+// Publica una trama con varios productores posibles; 0, o -1 con errno EAGAIN (lleno) o EPIPE (cerrado)
+int anillo_meter(AnilloShm* a, const uint8_t* trama, int len) {
+    if (len <= 0 || len > MAX_TRAMA) { errno = EINVAL; return -1; }
+    if (atomic_load(&a->cerrado)) { errno = EPIPE; return -1; }
+    unsigned pos = atomic_load_explicit(&a->cola, memory_order_relaxed);
+    for (;;) {
+        RanuraAnillo* r = &a->ranuras[pos & (a->capacidad - 1)];
+        unsigned sec = atomic_load_explicit(&r->secuencia, memory_order_acquire);
+        int dif = (int)(sec - pos);
+        if (dif == 0) { //La ranura esta libre: se intenta reservar la posicion
+            if (atomic_compare_exchange_weak_explicit(&a->cola, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                publicar(a, r, pos, trama, len);
+                return 0;
+            } //Si falla, pos ya quedo con el valor actual de la cola
+        } else if (dif < 0) { //La ranura todavia tiene la trama de una vuelta anterior
+            errno = EAGAIN;
+            return -1;
+        } else { //Otro productor gano esta posicion
+            pos = atomic_load_explicit(&a->cola, memory_order_relaxed);
+        }
+    }
+}
+
+// Igual que anillo_meter pero para un solo productor (o productores serializados por un cerrojo)
+int anillo_meter_unico(AnilloShm* a, const uint8_t* trama, int len) {
+    if (len <= 0 || len > MAX_TRAMA) { errno = EINVAL; return -1; }
+    if (atomic_load(&a->cerrado)) { errno = EPIPE; return -1; }
+    unsigned pos = atomic_load_explicit(&a->cola, memory_order_relaxed);
+    RanuraAnillo* r = &a->ranuras[pos & (a->capacidad - 1)];
+    if (atomic_load_explicit(&r->secuencia, memory_order_acquire) != pos) { //El consumidor no ha liberado la ranura
+        errno = EAGAIN;
+        return -1;
+    }
+    atomic_store_explicit(&a->cola, pos + 1, memory_order_relaxed); //Nadie mas escribe la cola
+    publicar(a, r, pos, trama, len);
+    return 0;
+}
+
+// Deja en trama la primera trama sin copiarla, retorna su longitud o 0 si esta vacio
+int anillo_frente(AnilloShm* a, const uint8_t** trama) {
+    unsigned pos = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+    RanuraAnillo* r = &a->ranuras[pos & (a->capacidad - 1)];
+    if (atomic_load_explicit(&r->secuencia, memory_order_acquire) != pos + 1) return 0; //Aun no se publica
+    *trama = r->datos;
+    return r->longitud;
+}
+
+// Libera la ranura de la trama que entrego anillo_frente
+void anillo_avanzar(AnilloShm* a) {
+    unsigned pos = atomic_load_explicit(&a->cabeza, memory_order_relaxed);
+    RanuraAnillo* r = &a->ranuras[pos & (a->capacidad - 1)];
+    atomic_store_explicit(&a->cabeza, pos + 1, memory_order_relaxed);
+    atomic_store_explicit(&r->secuencia, pos + a->capacidad, memory_order_release); //Libre para la siguiente vuelta
+}
+
+// Como anillo_frente pero duerme hasta que llegue una trama; retorna 0 si el canal se cerro vacio
+int anillo_esperar(AnilloShm* a, const uint8_t** trama) {
+    for (;;) {
+        int len = anillo_frente(a, trama);
+        if (len > 0) return len;
+        if (atomic_load(&a->cerrado)) return 0;
+        //Se anuncia que va a dormir antes de revisar otra vez, asi ningun productor se lo salta
+        atomic_store(&a->esperando, 1);
+        unsigned visto = atomic_load(&a->timbre);
+        len = anillo_frente(a, trama);
+        if (len == 0 && !atomic_load(&a->cerrado))
+            futex_esperar(&a->timbre, visto); //Vuelve si el timbre ya cambio
+        atomic_store(&a->esperando, 0);
+        if (len > 0) return len;
+    }
+}
+
+// Marca el canal como cerrado y despierta a quien este esperando
+void anillo_cerrar(AnilloShm* a) {
+    atomic_store(&a->cerrado, 1);
+    atomic_fetch_add(&a->timbre, 1);
+    futex_despertar(&a->timbre);
+}
+
+// Hilo que duerme en el futex del anillo y escribe en el eventfd cada vez que llegan tramas
+//Asi el bucle epoll del controlador atiende el anillo igual que un pipe
+void* anillo_vigilar(void* arg) {
+    VigiaAnillo* v = arg;
+    AnilloShm* a = v->anillo;
+    unsigned avisado = 0; //Ultimo valor del timbre que ya se aviso
+    while (!atomic_load(&a->cerrado)) {
+        unsigned t = atomic_load(&a->timbre);
+        if (t != avisado) { //Llegaron tramas nuevas
+            avisado = t;
+            uint64_t uno = 1;
+            if (write(v->fd_evento, &uno, sizeof(uno)) == -1 && errno != EAGAIN) break;
+            continue;
+        }
+        atomic_store(&a->esperando, 1);
+        if (atomic_load(&a->timbre) == avisado && !atomic_load(&a->cerrado))
+            futex_esperar(&a->timbre, avisado);
+        atomic_store(&a->esperando, 0);
+    }
+    return NULL;
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* El anillo usa solo operaciones atomicas sobre memoria
+* compartida: ningun productor bloquea a otro y el
+* consumidor nunca toma un cerrojo. El hilo vigia permite
+* que el controlador siga teniendo un unico bucle de
+* eventos sin importar el transporte elegido.
+******************************************************/
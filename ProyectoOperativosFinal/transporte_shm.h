@@ -0,0 +1,87 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto transporte_shm.h
+*
+* Descripción:
+* Este archivo define el transporte por memoria compartida, alternativo
+* a los pipes FIFO. Cada canal es un anillo de ranuras de tamano fijo
+* dentro de un objeto shm_open: el del controlador admite varios
+* productores (los agentes) y un solo consumidor, y el de cada agente
+* tiene un solo productor (el controlador) y un solo consumidor. Cada
+* ranura guarda una trama completa del mismo formato que viaja por los
+* pipes, asi los dos transportes llevan exactamente los mismos mensajes.
+* Quien consume duerme en un futex sobre el contador del anillo.
+******************************************************/
+#ifndef TRANSPORTE_SHM_H
+#define TRANSPORTE_SHM_H
+
+#include <stdint.h> //Libreria para enteros de tamano fijo
+#include <stdatomic.h> //Libreria para los indices compartidos entre procesos
+
+#include "protocolo.h" //MAX_TRAMA
+
+#define RANURAS_ENTRADA 4096 //Ranuras del anillo de solicitudes del controlador (potencia de 2)
+#define RANURAS_RESPUESTA 256 //Ranuras del anillo de respuestas de cada agente (potencia de 2)
+#define LINEA_CACHE 64 //Separa los indices de productores y consumidor en lineas distintas
+
+//Una ranura guarda una trama; su secuencia dice si esta libre o lista para leerse
+typedef struct {
+    atomic_uint secuencia; //Igual a la posicion si esta libre, posicion + 1 si tiene una trama
+    uint16_t longitud; //Bytes de la trama
+    uint8_t datos[MAX_TRAMA]; //Trama completa con su cabecera
+} RanuraAnillo;
+
+typedef struct {
+    uint32_t capacidad; //Cantidad de ranuras (potencia de 2)
+    _Alignas(LINEA_CACHE) atomic_uint cola; //Siguiente posicion a escribir, la avanzan los productores
+    _Alignas(LINEA_CACHE) atomic_uint cabeza; //Siguiente posicion a leer, solo la avanza el consumidor
+    _Alignas(LINEA_CACHE) atomic_uint timbre; //Palabra del futex: aumenta con cada trama publicada
+    atomic_int esperando; //1 mientras el consumidor duerme en el futex
+    atomic_int cerrado; //1 cuando el consumidor o el dueno cierran el canal
+    RanuraAnillo ranuras[]; //Ranuras del anillo
+} AnilloShm;
+
+//Argumento del hilo que traduce el futex del anillo a un eventfd para epoll
+typedef struct {
+    AnilloShm* anillo; //Anillo vigilado
+    int fd_evento; //eventfd que se marca cuando llegan tramas
+} VigiaAnillo;
+
+// Crea (o reemplaza) el objeto compartido de un canal y lo deja vacio, retorna NULL si falla
+AnilloShm* anillo_crear(const char* nombre, uint32_t capacidad);
+// Abre el canal que creo otro proceso, retorna NULL si no existe
+AnilloShm* anillo_abrir(const char* nombre);
+// Quita el anillo del espacio de memoria del proceso
+void anillo_liberar(AnilloShm* a);
+// Borra el nombre del objeto compartido
+void anillo_borrar(const char* nombre);
+
+// Publica una trama con varios productores posibles; 0, o -1 con errno EAGAIN (lleno) o EPIPE (cerrado)
+int anillo_meter(AnilloShm* a, const uint8_t* trama, int len);
+// Igual que anillo_meter pero para un solo productor (o productores serializados por un cerrojo)
+int anillo_meter_unico(AnilloShm* a, const uint8_t* trama, int len);
+// Deja en trama la primera trama sin copiarla, retorna su longitud o 0 si esta vacio
+int anillo_frente(AnilloShm* a, const uint8_t** trama);
+// Libera la ranura de la trama que entrego anillo_frente
+void anillo_avanzar(AnilloShm* a);
+// Como anillo_frente pero duerme hasta que llegue una trama; retorna 0 si el canal se cerro vacio
+int anillo_esperar(AnilloShm* a, const uint8_t** trama);
+// Marca el canal como cerrado y despierta a quien este esperando
+void anillo_cerrar(AnilloShm* a);
+// Hilo que duerme en el futex del anillo y escribe en el eventfd cada vez que llegan tramas
+void* anillo_vigilar(void* arg);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con los anillos en memoria compartida una trama llega al
+* otro proceso sin pasar por el kernel: solo se hace una
+* llamada al sistema cuando el consumidor estaba dormido y
+* hay que despertarlo.
+******************************************************/
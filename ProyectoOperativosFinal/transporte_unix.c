@@ -0,0 +1,77 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto transporte_unix.c
+*
+* Descripción:
+* Este archivo implementa la creacion del socket de escucha del
+* controlador y la conexion de los agentes. Los nombres que empiezan
+* con '@' van al espacio abstracto de Linux, que no deja archivos en
+* el disco; los demas son rutas normales.
+******************************************************/
+#include <string.h> //libreria para cadenas de caracteres
+#include <unistd.h> //Libreria para close y unlink
+#include <stddef.h> //Libreria para offsetof
+#include <sys/socket.h> //Libreria para sockets
+#include <sys/un.h> //Libreria para sockaddr_un
+
+#include "transporte_unix.h"
+
+//Llena la direccion del socket, retorna su longitud o 0 si el nombre no cabe
+static socklen_t direccion(const char* nombre, struct sockaddr_un* dir) {
+    size_t n = strlen(nombre);
+    if (n == 0 || n >= sizeof(dir->sun_path)) return 0;
+    memset(dir, 0, sizeof(*dir));
+    dir->sun_family = AF_UNIX;
+    memcpy(dir->sun_path, nombre, n);
+    if (nombre[0] == '@') { //Abstracto: el primer byte es '\0' y la longitud no incluye un terminador
+        dir->sun_path[0] = '\0';
+        return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + n);
+    }
+    return (socklen_t)sizeof(*dir);
+}
+
+// Crea el socket de escucha no bloqueante; un nombre que empieza con '@' usa el espacio abstracto
+int unix_escuchar(const char* nombre) {
+    struct sockaddr_un dir;
+    socklen_t largo = direccion(nombre, &dir);
+    if (largo == 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+    unix_borrar(nombre); //Un socket viejo de una ejecucion anterior impide el bind
+    if (bind(fd, (struct sockaddr*)&dir, largo) == -1 || listen(fd, COLA_CONEXIONES) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Se conecta al controlador, retorna el descriptor o -1
+int unix_conectar(const char* nombre) {
+    struct sockaddr_un dir;
+    socklen_t largo = direccion(nombre, &dir);
+    if (largo == 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd == -1) return -1;
+    if (connect(fd, (struct sockaddr*)&dir, largo) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Borra el archivo del socket si no es abstracto
+void unix_borrar(const char* nombre) {
+    if (nombre[0] != '@') unlink(nombre);
+}
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Estas funciones esconden los detalles de las direcciones
+* Unix, asi el controlador y el agente solo manejan un
+* descriptor por conexion igual que con los pipes.
+******************************************************/
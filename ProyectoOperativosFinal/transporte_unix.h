@@ -0,0 +1,37 @@
+/******************************************************
+* Fecha 11/11/2025
+* Pontificia Universidad Javeriana
+* Profesor: J. Corredor, PhD
+* Autor(es): Alejandro Beltran, Mauricio Beltran & Andres Diaz
+* Materia: Sistemas opertivos
+* Temas: Proyecto transporte_unix.h
+*
+* Descripción:
+* Este archivo define el transporte por sockets Unix de tipo
+* SOCK_SEQPACKET. El controlador escucha en un socket con el nombre
+* dado en -p y cada agente se conecta una sola vez; la misma conexion
+* lleva las solicitudes y las respuestas. Como cada envio es un
+* registro completo, los limites de las tramas se conservan y el
+* controlador sabe de que agente viene cada una.
+******************************************************/
+#ifndef TRANSPORTE_UNIX_H
+#define TRANSPORTE_UNIX_H
+
+#define COLA_CONEXIONES 4096 //Conexiones pendientes que admite listen
+
+// Crea el socket de escucha no bloqueante; un nombre que empieza con '@' usa el espacio abstracto
+int unix_escuchar(const char* nombre);
+// Se conecta al controlador, retorna el descriptor o -1
+int unix_conectar(const char* nombre);
+// Borra el archivo del socket si no es abstracto
+void unix_borrar(const char* nombre);
+
+#endif
+
+/******************************************************
+* CONCLUSIÓN
+*
+* Con una conexion por agente ya no hace falta un pipe de
+* respuesta por cada uno: el registro y las respuestas usan
+* el mismo descriptor que abrio el agente al conectarse.
+******************************************************/